@@ -0,0 +1,111 @@
+/*
+    SonatinaTag
+    Copyright (C) 2026 Lawrence Sebald
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License version 2.1 as published by the Free Software Foundation.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+*/
+
+#ifndef SonatinaTag__Allocator_h
+#define SonatinaTag__Allocator_h
+
+#include <SonatinaTag/cdefs.h>
+
+ST_BEGIN_DECLS
+
+#include <stddef.h>
+#include <SonatinaTag/Error.h>
+
+/* A set of memory allocation functions for the library to use in place of
+   malloc, realloc and free. Each of them is passed ctx as its first argument.
+   resize must act like realloc does when ptr is NULL, and release must accept
+   a NULL pointer. */
+typedef struct ST_Allocator_struct {
+    void *(*alloc)(void *ctx, size_t size);
+    void *(*resize)(void *ctx, void *ptr, size_t size);
+    void (*release)(void *ctx, void *ptr);
+    void *ctx;
+} ST_Allocator;
+
+/* Set the allocator used by the whole library. The allocator is copied, so it
+   doesn't need to stay around after this returns. Pass NULL to go back to the
+   standard C library functions. Only change this when no tags (or anything
+   else from the library) are alive, since everything must be freed by the
+   allocator that allocated it. */
+ST_FUNC ST_Error ST_setAllocator(const ST_Allocator *a);
+
+/* Override the library-wide allocator for the calling thread only, until this
+   is called again with NULL. The allocator is not copied, so it has to stay
+   around until then. Returns the override that was in place before (NULL if
+   there wasn't one), so that overrides can be nested. Anything allocated while
+   the override is in place must also be freed while it is. Pictures and items
+   whose data is read in when it's first asked for keep using the allocator
+   they were made with, so it has to stay around until they're freed. */
+ST_FUNC const ST_Allocator *ST_useAllocator(const ST_Allocator *a);
+
+/* The allocator currently in effect for the calling thread. */
+ST_FUNC const ST_Allocator *ST_currentAllocator(void);
+
+/* Allocate and free memory with the current allocator. Buffers handed to the
+   library with own_buf set are freed with ST_free, so they must come from
+   ST_malloc too. */
+ST_FUNC void *ST_malloc(size_t size);
+ST_FUNC void *ST_calloc(size_t count, size_t size);
+ST_FUNC void *ST_realloc(void *ptr, size_t size);
+ST_FUNC void ST_free(void *ptr);
+ST_FUNC char *ST_strdup(const char *s);
+
+/* Counts kept by a counting allocator. */
+typedef struct ST_AllocStats_struct {
+    size_t allocs;              /* Number of blocks allocated */
+    size_t reallocs;            /* Number of blocks resized */
+    size_t frees;               /* Number of blocks freed */
+    size_t failures;            /* Number of requests that failed */
+    size_t in_use;              /* Bytes currently allocated */
+    size_t peak;                /* Most bytes ever allocated at once */
+    size_t total;               /* Bytes allocated over all time */
+} ST_AllocStats;
+
+/* Set up an allocator that uses the standard C library functions, but keeps
+   count of what it does in stats. The counts are zeroed first. stats must stay
+   around as long as the allocator is in use, and is not locked, so only use
+   one from one thread at a time. */
+ST_FUNC void ST_AllocStats_allocator(ST_AllocStats *stats, ST_Allocator *a);
+
+/* Opaque arena. An arena hands out memory from a few large chunks, and frees
+   all of it at once, no matter how many blocks were allocated from it. */
+struct ST_Arena_struct;
+typedef struct ST_Arena_struct ST_Arena;
+
+/* Create an arena, taking its chunks (of chunk_size bytes, or a default size if
+   that is 0) from the allocator in effect right now. */
+ST_FUNC ST_Arena *ST_Arena_create(size_t chunk_size);
+
+/* Free an arena along with everything allocated from it. */
+ST_FUNC void ST_Arena_free(ST_Arena *a);
+
+/* Throw away everything allocated from an arena, keeping one chunk around to
+   be used again. */
+ST_FUNC void ST_Arena_reset(ST_Arena *a);
+
+/* The allocator that allocates from an arena, for use with ST_useAllocator.
+   Freeing a block from it only gives the memory back if it was the last block
+   allocated or was too big to share a chunk. */
+ST_FUNC const ST_Allocator *ST_Arena_allocator(ST_Arena *a);
+
+/* How many bytes the arena has taken for its chunks. */
+ST_FUNC size_t ST_Arena_footprint(const ST_Arena *a);
+
+ST_END_DECLS
+
+#endif /* !SonatinaTag__Allocator_h */
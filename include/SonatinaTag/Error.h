@@ -37,7 +37,13 @@ typedef enum ST_Error_e {
     ST_Error_InvalidArgument = -2,
     ST_Error_Unknown = -3,
     ST_Error_NotFound = -4,
-    ST_Error_InvalidEncoding = -5
+    ST_Error_InvalidEncoding = -5,
+    ST_Error_TooLarge = -6,
+    ST_Error_Unsupported = -7,
+
+    /* Something that was left in a file to be read later couldn't be, because
+       the file has been changed or replaced since it was parsed. */
+    ST_Error_FileChanged = -8
 } ST_Error;
 
 ST_END_DECLS
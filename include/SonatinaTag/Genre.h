@@ -0,0 +1,58 @@
+/*
+    SonatinaTag
+    Copyright (C) 2026 Lawrence Sebald
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License version 2.1 as published by the Free Software Foundation.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+*/
+
+#ifndef SonatinaTag__Genre_h
+#define SonatinaTag__Genre_h
+
+#include <SonatinaTag/cdefs.h>
+
+ST_BEGIN_DECLS
+
+#include <stddef.h>
+#include <stdint.h>
+
+/* Genres from every type of tag get normalized to the same set of IDs, which
+   are the ID3v1 genre codes (including the Winamp extensions). So, the values
+   of ST_ID3v1_GenreCode can be used to check the results. Anything that isn't
+   one of those comes back as one of these instead. */
+#define ST_Genre_None       -1      /* No genre at all (or a bad tag) */
+#define ST_Genre_Other      -2      /* Only free text, no known genre */
+
+/* Normalize a UTF-8 genre string, as found in any type of tag. This handles
+   ID3v1 numbers ("13"), ID3v2.3 references ("(13)", "(13)Pop", "(RX)",
+   "(CR)"), and plain names, which are matched without regard to case, spacing
+   or punctuation ("hip hop" matches "Hip-Hop"). Only the first of several
+   NUL separated values is looked at.
+
+   If buf is not NULL, the text of the genre is copied into it, as UTF-8 with a
+   NUL terminator: the standard name for a known genre, or the text itself for
+   anything else. Returns the genre ID, ST_Genre_Other, or ST_Genre_None. */
+ST_FUNC int ST_Genre_normalize(const uint8_t *s, size_t s_len, uint8_t *buf,
+                               size_t len);
+
+/* Look up the ID of a genre by its name, as ST_Genre_normalize does (but
+   without handling numbers or references). This takes constant time. Returns
+   ST_Genre_Other if the name isn't one of the known genres. */
+ST_FUNC int ST_Genre_lookup(const uint8_t *s, size_t s_len);
+
+/* Get the standard name of a genre ID, or NULL if it isn't valid. */
+ST_FUNC const char *ST_Genre_name(int id);
+
+ST_END_DECLS
+
+#endif /* !SonatinaTag__Genre_h */
@@ -0,0 +1,70 @@
+/*
+    SonatinaTag
+    Copyright (C) 2026 Lawrence Sebald
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License version 2.1 as published by the Free Software Foundation.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+*/
+
+#ifndef SonatinaTag__ParserContext_h
+#define SonatinaTag__ParserContext_h
+
+#include <SonatinaTag/cdefs.h>
+
+ST_BEGIN_DECLS
+
+#include <stddef.h>
+#include <SonatinaTag/SonatinaTag.h>
+#include <SonatinaTag/Tags/Merged.h>
+
+/* Opaque parser context. A context holds on to the memory used to parse a
+   file (the tag itself, its dictionaries and the scratch space used to read
+   the file) and reuses it for the next file, so that parsing one file after
+   another doesn't have to go to the heap once things are warmed up. A context
+   may only be used by one thread at a time. */
+struct ST_ParserContext_struct;
+typedef struct ST_ParserContext_struct ST_ParserContext;
+
+/* Create a parser context. chunk_size is how much memory to set aside at a
+   time, or 0 for a default that fits the tags of most files in one go. */
+ST_FUNC ST_ParserContext *ST_ParserContext_create(size_t chunk_size);
+
+/* Free a parser context, along with the last tag parsed with it. */
+ST_FUNC void ST_ParserContext_free(ST_ParserContext *ctx);
+
+/* Throw away the last tag parsed with a context, keeping the memory it used
+   around for the next one. Parsing a file does this first, so it is only
+   needed to release the tag early. */
+ST_FUNC void ST_ParserContext_reset(ST_ParserContext *ctx);
+
+/* Read the tag from a file, like ST_Tag_createFromFile does. The tag belongs
+   to the context and is only valid until the next file is parsed or the
+   context is reset or freed. Don't free it or change it. Returns NULL if the
+   file has no tag. */
+ST_FUNC const ST_Tag *ST_ParserContext_parse(ST_ParserContext *ctx,
+                                             const char *fn);
+
+/* Read every tag in a file, like ST_Merged_createFromFile does. The same
+   rules apply as for ST_ParserContext_parse. */
+ST_FUNC const ST_Merged *ST_ParserContext_parseMerged(ST_ParserContext *ctx,
+                                                      const char *fn);
+
+/* Fill in a record from the last tag parsed, with its text kept in the
+   context. The record is valid as long as the tag is. Returns
+   ST_Error_NotFound if there is no tag. */
+ST_FUNC ST_Error ST_ParserContext_record(ST_ParserContext *ctx,
+                                         ST_TagRecord *rec);
+
+ST_END_DECLS
+
+#endif /* !SonatinaTag__ParserContext_h */
@@ -63,7 +63,17 @@ ST_FUNC ST_Picture *ST_Picture_create(void);
 /* Free a picture */
 ST_FUNC void ST_Picture_free(ST_Picture *p);
 
-/* Accessors */
+/* Read in the data of a picture that was left in the file it came from (like
+   cover art in an APE tag), if it hasn't been already. ST_Picture_data does
+   this on its own the first time it's called, but only as long as the file
+   hasn't been changed since it was parsed (ST_Error_FileChanged otherwise).
+   Calling this first means nothing more will be read from the file. */
+ST_FUNC ST_Error ST_Picture_load(ST_Picture *p);
+
+/* Accessors. ST_Picture_data may read the data in from the file, and returns
+   NULL if that doesn't work. With POSIX threads, it can be called from several
+   threads at once, but not while the picture is being changed or loaded with
+   ST_Picture_load. */
 ST_FUNC uint32_t ST_Picture_width(const ST_Picture *p);
 ST_FUNC uint32_t ST_Picture_height(const ST_Picture *p);
 ST_FUNC uint32_t ST_Picture_bitDepth(const ST_Picture *p);
@@ -24,9 +24,12 @@
 ST_BEGIN_DECLS
 
 #include <stddef.h>
+#include <stdint.h>
 #include <SonatinaTag/basedefs.h>
 #include <SonatinaTag/Error.h>
 #include <SonatinaTag/Picture.h>
+#include <SonatinaTag/Genre.h>
+#include <SonatinaTag/Allocator.h>
 
 /* Opaque tag type. All tags are "subclasses" of this type. */
 struct ST_Tag_struct;
@@ -36,17 +39,92 @@ typedef struct ST_Tag_struct ST_Tag;
 ST_FUNC ST_TagType ST_Tag_type(const ST_Tag *tag);
 
 /* Create a tag from a file. This will attempt to automatically determine the
-   "best" type of tag to use for the file. */
+   "best" type of tag to use for the file, going by the extension of the file or
+   (if that doesn't help) the first few bytes of it. */
 ST_FUNC ST_Tag *ST_Tag_createFromFile(const char *fn);
 
 ST_FUNC void ST_Tag_free(ST_Tag *tag);
 
+/* Create a tag from a file as ST_Tag_createFromFile does, but put the tag and
+   everything in it in an arena of its own. Freeing the tag then just frees the
+   arena, which takes the same time no matter how much is in the tag. A tag made
+   this way must not be changed. */
+ST_FUNC ST_Tag *ST_Tag_createFromFileInArena(const char *fn);
+
+/* Hand an arena over to a tag that was made entirely in it (with the arena's
+   allocator in effect), so that freeing the tag frees the arena. This works for
+   any type of tag, including merged ones. The same rules apply as for
+   ST_Tag_createFromFileInArena. */
+ST_FUNC ST_Error ST_Tag_adoptArena(ST_Tag *tag, ST_Arena *a);
+
 ST_FUNC int ST_Tag_track(const ST_Tag *tag);
 ST_FUNC int ST_Tag_disc(const ST_Tag *tag);
 
+/* The total number of tracks or discs. Returns -1 if not set. */
+ST_FUNC int ST_Tag_trackCount(const ST_Tag *tag);
+ST_FUNC int ST_Tag_discCount(const ST_Tag *tag);
+
+/* The length of the audio in milliseconds, if the tag (or the file it came
+   from) says what it is. Returns 0 if not. */
+ST_FUNC uint64_t ST_Tag_durationMs(const ST_Tag *tag);
+
 ST_FUNC const ST_Picture *ST_Tag_picture(const ST_Tag *tag, ST_PictureType pt,
                                          int index);
 
+/* Get the genre of the tag as one of the standard genre IDs, whatever type of
+   tag it is. See ST_Genre_normalize for the details. */
+ST_FUNC int ST_Tag_normalizedGenre(const ST_Tag *tag, uint8_t *buf,
+                                   size_t len);
+
+/* Get a field from the tag as UTF-8, whatever type of tag it is and whatever
+   encoding the tag uses. The value is copied into buf and is always NUL
+   terminated, being cut short (on a character boundary) if it doesn't fit. If
+   the field has several values, only the first is returned. Genres come back
+   normalized, as ST_Tag_normalizedGenre does.
+
+   Returns ST_Error_NotFound if the tag doesn't have the field (or its type of
+   tag can't hold it), in which case buf is set to an empty string. If the
+   value had to be cut short, buf holds as much of it as fit and
+   ST_Error_TooLarge is returned. */
+ST_FUNC ST_Error ST_Tag_get(const ST_Tag *tag, ST_Field field, uint8_t *buf,
+                            size_t len);
+
+/* The fields that are usually wanted out of every tag, gathered up into one
+   structure by ST_Tag_extractRecord. */
+typedef struct ST_TagRecord_struct {
+    /* Every field that ST_Tag_get can read, indexed by ST_Field. These point
+       into the buffer given to ST_Tag_extractRecord, and are NULL if the tag
+       doesn't have the field. */
+    const char *text[ST_Field_Count];
+
+    ST_TagType type;
+    int genre;                  /* As from ST_Tag_normalizedGenre */
+    int track;                  /* Numbers are 0 if not set */
+    int track_count;
+    int disc;
+    int disc_count;
+    uint64_t duration_ms;       /* 0 if unknown */
+    int has_picture;
+    int truncated;              /* Not all the text fit in the buffer */
+} ST_TagRecord;
+
+/* Big enough for the text of just about any tag. */
+#define ST_TagRecord_BufferSize     4096
+
+/* Fill in a record from a tag, whatever type it is. All of the text goes into
+   buf, one NUL terminated UTF-8 string after another, so nothing gets
+   allocated. If buf fills up, the remaining fields are left out (or cut short)
+   and truncated is set in the record. The record is only valid as long as buf
+   is. */
+ST_FUNC ST_Error ST_Tag_extractRecord(const ST_Tag *tag, ST_TagRecord *rec,
+                                      char *buf, size_t len);
+
+/* Make a read-only copy of a tag's fields in one block of memory, with no
+   pointers in it, for keeping a lot of tags around. All of the functions above
+   work on the copy, except that pictures aren't kept (but has_picture is still
+   set in records). The original tag is left alone. */
+ST_FUNC ST_Tag *ST_Tag_freeze(const ST_Tag *tag);
+
 #ifdef ST_HAVE_COREFOUNDATION
 /* CoreFoundation-based accessors. These functions will create CFStringRef
    objects for the given data. These accessors follow the "Create Rule" with
@@ -25,6 +25,7 @@ ST_BEGIN_DECLS
 
 #include <stdint.h>
 #include <SonatinaTag/basedefs.h>
+#include <SonatinaTag/Picture.h>
 #include <SonatinaTag/Dictionary.h>
 
 /* Opaque APE tag structure */
@@ -42,7 +43,11 @@ ST_FUNC size_t ST_APE_item_length(const ST_APE_item *c);
 ST_FUNC uint32_t ST_APE_item_flags(const ST_APE_item *c);
 
 /* Get the data from a APE tag item. You must not change the value returned by
-   this function! */
+   this function! Binary items from a file are read in the first time this is
+   called on them, which only works if the file hasn't been changed since the
+   tag was read from it (NULL is returned if it has). With POSIX threads, this
+   is safe to call from several threads at once, as long as nothing is changing
+   the tag. */
 ST_FUNC const uint8_t *ST_APE_item_data(const ST_APE_item *c);
 
 /* Create a new blank APE tag. */
@@ -54,6 +59,18 @@ ST_FUNC void ST_APE_free(ST_APE *tag);
 /* Create a new APE tag, reading from a file. */
 ST_FUNC ST_APE *ST_APE_createFromFile(const char *fn);
 
+/* Read in all of the binary items and cover art of a tag that were left in the
+   file it came from, so that nothing more will be read from the file after
+   this. Returns ST_Error_FileChanged if the file has been changed since the tag
+   was read from it. */
+ST_FUNC ST_Error ST_APE_loadItems(ST_APE *tag);
+
+/* Write an APE tag to the end of the specified file, replacing any APE tag that
+   is already there. An ID3v1 tag at the end of the file is kept after the new
+   tag. Only the end of the file is changed, so this never needs to copy the
+   audio data. */
+ST_FUNC ST_Error ST_APE_writeToFile(const ST_APE *tag, const char *fn);
+
 /* Retrieve the value of an arbitrary item from the tag. */
 ST_FUNC ST_Error ST_APE_itemForKey(const ST_APE *tag, const char *key,
                                    uint8_t *buf, size_t len);
@@ -107,9 +124,30 @@ ST_FUNC ST_Error ST_APE_comment(const ST_APE *tag, uint8_t *buf, size_t len);
 ST_FUNC ST_Error ST_APE_date(const ST_APE *tag, uint8_t *buf, size_t len);
 ST_FUNC ST_Error ST_APE_genre(const ST_APE *tag, uint8_t *buf, size_t len);
 
+/* Get the genre of the tag, normalized as ST_Genre_normalize does. */
+ST_FUNC int ST_APE_normalizedGenre(const ST_APE *tag, uint8_t *buf,
+                                   size_t len);
+
+/* Get a field as a NUL terminated UTF-8 string, as ST_Tag_get does. Only the
+   first of several values in an item is returned. */
+ST_FUNC ST_Error ST_APE_get(const ST_APE *tag, ST_Field field, uint8_t *buf,
+                            size_t len);
+
 ST_FUNC int ST_APE_track(const ST_APE *tag);
 ST_FUNC int ST_APE_disc(const ST_APE *tag);
 
+/* The total number of tracks or discs, from the "n/total" form of the Track or
+   Disc item. Returns -1 if not set. */
+ST_FUNC int ST_APE_trackCount(const ST_APE *tag);
+ST_FUNC int ST_APE_discCount(const ST_APE *tag);
+
+/* Retrieve a picture from the "Cover Art (...)" items of the tag. The type of
+   the picture comes from the key of the item, and the description is the
+   filename stored with it. The picture data isn't read from the file until it
+   is asked for, or until ST_APE_loadItems is called. */
+ST_FUNC const ST_Picture *ST_APE_picture(const ST_APE *tag, ST_PictureType pt,
+                                         int index);
+
 #ifdef ST_HAVE_COREFOUNDATION
 /* CoreFoundation-based accessors. These functions will create CFStringRef
    objects for the given data. These accessors follow the "Create Rule" with
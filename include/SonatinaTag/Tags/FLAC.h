@@ -35,6 +35,25 @@ typedef struct ST_FLAC_struct ST_FLAC;
 struct ST_FLAC_vcomment_struct;
 typedef struct ST_FLAC_vcomment_struct ST_FLAC_vcomment;
 
+/* FLAC metadata block types. */
+typedef enum ST_FLAC_BlockType_e {
+    ST_FLAC_BlockType_StreamInfo        = 0,
+    ST_FLAC_BlockType_Padding           = 1,
+    ST_FLAC_BlockType_Application       = 2,
+    ST_FLAC_BlockType_SeekTable         = 3,
+    ST_FLAC_BlockType_VorbisComment     = 4,
+    ST_FLAC_BlockType_Cuesheet          = 5,
+    ST_FLAC_BlockType_Picture           = 6,
+    ST_FLAC_BlockType_Invalid           = 127
+} ST_FLAC_BlockType;
+
+/* Flags that can be passed to ST_FLAC_createFromFileWithFlags. */
+#define ST_FLAC_Flag_VerifyFrames       0x00000001
+
+/* Opaque FLAC metadata block table structure */
+struct ST_FLAC_BlockTable_struct;
+typedef struct ST_FLAC_BlockTable_struct ST_FLAC_BlockTable;
+
 /* Get the length of data in a FLAC comment. */
 ST_FUNC size_t ST_FLAC_vcomment_length(const ST_FLAC_vcomment *c);
 
@@ -51,6 +70,49 @@ ST_FUNC void ST_FLAC_free(ST_FLAC *tag);
 /* Create a new FLAC tag, reading from a file. */
 ST_FUNC ST_FLAC *ST_FLAC_createFromFile(const char *fn);
 
+/* Read a FLAC tag, as above. If ST_FLAC_Flag_VerifyFrames is given, every audio
+   frame in the file is also checked against its CRCs after the metadata has
+   been read. This is much slower than just reading the tag. */
+ST_FUNC ST_FLAC *ST_FLAC_createFromFileWithFlags(const char *fn,
+                                                 uint32_t flags);
+
+/* Retrieve the offset of the first frame that failed its CRC check (or was cut
+   short). This is 0 if all frames were fine or if the frames were not checked
+   when the tag was read. */
+ST_FUNC uint64_t ST_FLAC_badFrameOffset(const ST_FLAC *tag);
+
+/* Scan the metadata block headers of a FLAC file, without reading any of the
+   block contents. You are responsible for freeing the returned table. */
+ST_FUNC ST_FLAC_BlockTable *ST_FLAC_BlockTable_createFromFile(const char *fn);
+
+/* Free a metadata block table created by the function above. */
+ST_FUNC void ST_FLAC_BlockTable_free(ST_FLAC_BlockTable *t);
+
+/* Retrieve the metadata block table that was recorded while reading the tag
+   from a file (it is empty for tags that were not read from a file). The table
+   belongs to the tag, so you must not free it. */
+ST_FUNC const ST_FLAC_BlockTable *ST_FLAC_blockTable(const ST_FLAC *tag);
+
+/* Accessors for the entries in a block table. Offsets are from the start of
+   the file, and point at the 4-byte block header. Lengths do not include the
+   block header. */
+ST_FUNC int ST_FLAC_BlockTable_count(const ST_FLAC_BlockTable *t);
+ST_FUNC ST_FLAC_BlockType ST_FLAC_BlockTable_type(const ST_FLAC_BlockTable *t,
+                                                  int index);
+ST_FUNC uint64_t ST_FLAC_BlockTable_offset(const ST_FLAC_BlockTable *t,
+                                           int index);
+ST_FUNC uint32_t ST_FLAC_BlockTable_length(const ST_FLAC_BlockTable *t,
+                                           int index);
+ST_FUNC int ST_FLAC_BlockTable_isLast(const ST_FLAC_BlockTable *t, int index);
+
+/* Total number of bytes of PADDING block data in the table (not counting the
+   block headers). */
+ST_FUNC uint64_t ST_FLAC_BlockTable_paddingLength(const ST_FLAC_BlockTable *t);
+
+/* Offset of the first audio frame (the byte after the last metadata block), or
+   (uint64_t)-1 if the table does not end with the last metadata block. */
+ST_FUNC uint64_t ST_FLAC_BlockTable_audioOffset(const ST_FLAC_BlockTable *t);
+
 /* Retrieve the value of an arbitrary Vorbis comment from the tag. */
 ST_FUNC ST_Error ST_FLAC_commentForKey(const ST_FLAC *tag, const char *key,
                                        int index, uint8_t *buf, size_t len);
@@ -109,9 +171,30 @@ ST_FUNC ST_Error ST_FLAC_comment(const ST_FLAC *tag, uint8_t *buf, size_t len);
 ST_FUNC ST_Error ST_FLAC_date(const ST_FLAC *tag, uint8_t *buf, size_t len);
 ST_FUNC ST_Error ST_FLAC_genre(const ST_FLAC *tag, uint8_t *buf, size_t len);
 
+/* Get the genre of the tag, normalized as ST_Genre_normalize does. */
+ST_FUNC int ST_FLAC_normalizedGenre(const ST_FLAC *tag, uint8_t *buf,
+                                    size_t len);
+
+/* Get a field as a NUL terminated UTF-8 string, as ST_Tag_get does. */
+ST_FUNC ST_Error ST_FLAC_get(const ST_FLAC *tag, ST_Field field, uint8_t *buf,
+                             size_t len);
+
 ST_FUNC int ST_FLAC_track(const ST_FLAC *tag);
 ST_FUNC int ST_FLAC_disc(const ST_FLAC *tag);
 
+/* The total number of tracks or discs, from the TRACKTOTAL or DISCTOTAL
+   comment, or the "n/total" form of the number. Returns -1 if not set. */
+ST_FUNC int ST_FLAC_trackCount(const ST_FLAC *tag);
+ST_FUNC int ST_FLAC_discCount(const ST_FLAC *tag);
+
+/* Audio properties, from the STREAMINFO block. These return 0 if the file
+   didn't say (or the tag wasn't read from a file). */
+ST_FUNC uint32_t ST_FLAC_sampleRate(const ST_FLAC *tag);
+ST_FUNC uint64_t ST_FLAC_totalSamples(const ST_FLAC *tag);
+
+/* The length of the audio, in milliseconds. */
+ST_FUNC uint64_t ST_FLAC_durationMs(const ST_FLAC *tag);
+
 ST_FUNC const ST_Picture *ST_FLAC_picture(const ST_FLAC *tag, ST_PictureType pt,
                                           int index);
 
@@ -0,0 +1,68 @@
+/*
+    SonatinaTag
+    Copyright (C) 2026 Lawrence Sebald
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License version 2.1 as published by the Free Software Foundation.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+*/
+
+#ifndef SonatinaTag__Tags__Frozen_h
+#define SonatinaTag__Tags__Frozen_h
+
+#include <SonatinaTag/cdefs.h>
+
+ST_BEGIN_DECLS
+
+#include <stddef.h>
+#include <stdint.h>
+#include <SonatinaTag/basedefs.h>
+#include <SonatinaTag/Error.h>
+#include <SonatinaTag/SonatinaTag.h>
+
+/* Opaque frozen tag structure. A frozen tag is a read-only copy of the fields
+   of another tag (the ones ST_Tag_get can read, along with the numbers), kept
+   in one block of memory with no pointers in it. The block can be copied
+   around with memcpy, using ST_Frozen_size for its length. Pictures and
+   anything specific to the type of the original tag are left behind. A frozen
+   tag can be used as an ST_Tag with all of the ST_Tag functions. */
+struct ST_Frozen_struct;
+typedef struct ST_Frozen_struct ST_Frozen;
+
+/* Make a frozen copy of a tag. The original tag is left alone. */
+ST_FUNC ST_Frozen *ST_Frozen_create(const ST_Tag *tag);
+
+ST_FUNC void ST_Frozen_free(ST_Frozen *tag);
+
+/* The size of the block holding the frozen tag, in bytes. */
+ST_FUNC size_t ST_Frozen_size(const ST_Frozen *tag);
+
+/* The type of the tag that was frozen. */
+ST_FUNC ST_TagType ST_Frozen_sourceType(const ST_Frozen *tag);
+
+/* Whether the tag that was frozen had a picture in it. */
+ST_FUNC int ST_Frozen_hasPicture(const ST_Frozen *tag);
+
+/* Accessors. These give back the same thing the tag that was frozen did. */
+ST_FUNC ST_Error ST_Frozen_get(const ST_Frozen *tag, ST_Field field,
+                               uint8_t *buf, size_t len);
+ST_FUNC int ST_Frozen_normalizedGenre(const ST_Frozen *tag, uint8_t *buf,
+                                      size_t len);
+ST_FUNC int ST_Frozen_track(const ST_Frozen *tag);
+ST_FUNC int ST_Frozen_disc(const ST_Frozen *tag);
+ST_FUNC int ST_Frozen_trackCount(const ST_Frozen *tag);
+ST_FUNC int ST_Frozen_discCount(const ST_Frozen *tag);
+ST_FUNC uint64_t ST_Frozen_durationMs(const ST_Frozen *tag);
+
+ST_END_DECLS
+
+#endif /* !SonatinaTag__Tags__Frozen_h */
@@ -200,6 +200,38 @@ ST_FUNC ST_ID3v1 *ST_ID3v1_createFromFile(const char *fn);
    end of the file, overwriting any existing ID3v1 tags that may be there. */
 ST_FUNC ST_Error ST_ID3v1_writeToFile(const ST_ID3v1 *tag, const char *fn);
 
+/* Longest strings that can be in an ST_ID3v1_Record, not counting the NUL
+   terminator. The title, artist, and album can be longer than the 30 bytes that
+   fit in the tag itself if the file has an Enhanced TAG+ block. */
+#define ST_ID3v1_TextMax        90
+#define ST_ID3v1_CommentMax     30
+#define ST_ID3v1_YearMax        4
+
+/* The contents of an ID3v1 tag, as a plain structure that you can put wherever
+   you want. All strings are NUL terminated ISO-8859-1, and empty if unset. */
+typedef struct ST_ID3v1_Record_struct {
+    char title[ST_ID3v1_TextMax + 1];
+    char artist[ST_ID3v1_TextMax + 1];
+    char album[ST_ID3v1_TextMax + 1];
+    char comment[ST_ID3v1_CommentMax + 1];
+    char year[ST_ID3v1_YearMax + 1];
+    uint8_t genre;
+    uint8_t track;
+} ST_ID3v1_Record;
+
+/* Read the ID3v1 tag from a file straight into a record, without allocating
+   anything along the way. Returns ST_Error_NotFound if there is no tag. */
+ST_FUNC ST_Error ST_ID3v1_readRecord(const char *fn, ST_ID3v1_Record *rec);
+
+/* Read the ID3v1 tags from a list of files into an array of records. If errs
+   is not NULL, the result of ST_ID3v1_readRecord for each file is stored in it.
+   Files without a tag get an empty record. Returns the number of tags read. */
+ST_FUNC size_t ST_ID3v1_readRecords(const char *const *fns, size_t count,
+                                    ST_ID3v1_Record *recs, ST_Error *errs);
+
+/* Get at the record behind a tag. This is valid until the tag is freed. */
+ST_FUNC const ST_ID3v1_Record *ST_ID3v1_record(const ST_ID3v1 *tag);
+
 /* Accessors. You must provide a buffer to copy the string into and the length
    of that buffer. If the length of the actual string is greater than the size
    of the buffer, the string WILL NOT be NUL terminated. Also, all strings in
@@ -212,8 +244,17 @@ ST_FUNC ST_Error ST_ID3v1_comment(const ST_ID3v1 *tag, uint8_t *buf,
 ST_FUNC ST_Error ST_ID3v1_year(const ST_ID3v1 *tag, uint8_t *buf, size_t len);
 
 ST_FUNC ST_ID3v1_GenreCode ST_ID3v1_genre(const ST_ID3v1 *tag);
+
+/* Get the genre of the tag, normalized as ST_Genre_normalize does. */
+ST_FUNC int ST_ID3v1_normalizedGenre(const ST_ID3v1 *tag, uint8_t *buf,
+                                     size_t len);
 ST_FUNC int ST_ID3v1_track(const ST_ID3v1 *tag);
 
+/* Get a field as a NUL terminated UTF-8 string, as ST_Tag_get does. The year
+   is used for ST_Field_Date. */
+ST_FUNC ST_Error ST_ID3v1_get(const ST_ID3v1 *tag, ST_Field field,
+                              uint8_t *buf, size_t len);
+
 #ifdef ST_HAVE_COREFOUNDATION
 /* CoreFoundation-based accessors. These functions will create CFStringRef
    objects for the given data. These accessors follow the "Create Rule" with
@@ -82,9 +82,31 @@ ST_FUNC ST_Error ST_ID3v2_comment(const ST_ID3v2 *tag, uint8_t *buf,
 ST_FUNC ST_Error ST_ID3v2_date(const ST_ID3v2 *tag, uint8_t *buf, size_t len);
 ST_FUNC ST_Error ST_ID3v2_genre(const ST_ID3v2 *tag, uint8_t *buf, size_t len);
 
+/* Get the genre of the tag, normalized as ST_Genre_normalize does, converting
+   it to UTF-8 along the way. */
+ST_FUNC int ST_ID3v2_normalizedGenre(const ST_ID3v2 *tag, uint8_t *buf,
+                                     size_t len);
+
+/* Get a field as a NUL terminated UTF-8 string, as ST_Tag_get does. The date
+   comes from the TDRC frame, or TYER if there isn't one. ReplayGain values and
+   most MusicBrainz IDs come from TXXX frames (with the descriptions that
+   foobar2000 and MusicBrainz Picard use), and the MusicBrainz track ID comes
+   from the UFID frame. */
+ST_FUNC ST_Error ST_ID3v2_get(const ST_ID3v2 *tag, ST_Field field,
+                              uint8_t *buf, size_t len);
+
 ST_FUNC int ST_ID3v2_track(const ST_ID3v2 *tag);
 ST_FUNC int ST_ID3v2_disc(const ST_ID3v2 *tag);
 
+/* The total number of tracks or discs, from the "n/total" form of the TRCK or
+   TPOS frame. Returns -1 if not set. */
+ST_FUNC int ST_ID3v2_trackCount(const ST_ID3v2 *tag);
+ST_FUNC int ST_ID3v2_discCount(const ST_ID3v2 *tag);
+
+/* The length of the audio in milliseconds, from the TLEN frame. Returns 0 if
+   the tag doesn't have one. */
+ST_FUNC uint64_t ST_ID3v2_durationMs(const ST_ID3v2 *tag);
+
 ST_FUNC const ST_Picture *ST_ID3v2_picture(const ST_ID3v2 *tag,
                                            ST_PictureType pt, int index);
 
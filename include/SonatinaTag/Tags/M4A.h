@@ -78,9 +78,24 @@ typedef enum ST_M4A_AtomCode_e {
     ST_AtomFileType             = ST_4CC('f', 't', 'y', 'p'),
     ST_AtomMetadata             = ST_4CC('m', 'e', 't', 'a'),
     ST_AtomMeaning              = ST_4CC('m', 'e', 'a', 'n'),
-    ST_AtomName                 = ST_4CC('n', 'a', 'm', 'e')
+    ST_AtomName                 = ST_4CC('n', 'a', 'm', 'e'),
+    ST_AtomMediaData            = ST_4CC('m', 'd', 'a', 't'),
+    ST_AtomSkip                 = ST_4CC('s', 'k', 'i', 'p'),
+    ST_AtomWide                 = ST_4CC('w', 'i', 'd', 'e')
 } ST_M4A_AtomCode;
 
+/* Type indicators for the data stored in an atom. */
+typedef enum ST_M4A_DataType_e {
+    ST_M4A_DataType_Implicit    = 0,
+    ST_M4A_DataType_UTF8        = 1,
+    ST_M4A_DataType_UTF16       = 2,
+    ST_M4A_DataType_JPEG        = 13,
+    ST_M4A_DataType_PNG         = 14,
+    ST_M4A_DataType_SignedInt   = 21,
+    ST_M4A_DataType_UnsignedInt = 22,
+    ST_M4A_DataType_BMP         = 27
+} ST_M4A_DataType;
+
 /* Opaque M4A tag structure */
 struct ST_M4A_struct;
 typedef struct ST_M4A_struct ST_M4A;
@@ -94,9 +109,21 @@ ST_FUNC ST_M4A *ST_M4A_create(void);
 /* Free a M4A tag. */
 ST_FUNC void ST_M4A_free(ST_M4A *tag);
 
-/* Create a new M4A tag, reading from a file. */
+/* Create a new M4A tag, reading from a file. Any ISO base media file (M4A, M4B,
+   M4V, MP4, QuickTime and the like) with iTunes-style metadata can be read. */
 ST_FUNC ST_M4A *ST_M4A_createFromFile(const char *fn);
 
+/* Write a M4A tag to the specified file, replacing the ilst atom that is
+   already there. If the new tag doesn't fit in the space of the old one (plus
+   any free atoms next to it), everything after the moov atom is moved down to
+   make room and the chunk offsets of the tracks are updated to match. Tracks
+   that use 32-bit chunk offsets (stco atoms) can't point past 4GB, so if moving
+   things down would push any of their chunks that far, ST_Error_TooLarge is
+   returned and the file is left alone. Moving things isn't supported at all in
+   fragmented files (ones with an mvex atom), so ST_Error_Unsupported is
+   returned if the new tag doesn't fit in one of those. */
+ST_FUNC ST_Error ST_M4A_writeToFile(const ST_M4A *tag, const char *fn);
+
 /* Retrieve the value of an arbitrary atom from the tag. Cover art atoms are
    only accessible with the special function for them (ST_M4A_picture). */
 ST_FUNC ST_Error ST_M4A_atomForKey(const ST_M4A *tag, ST_M4A_AtomCode code,
@@ -160,11 +187,62 @@ ST_FUNC ST_Error ST_M4A_comment(const ST_M4A *tag, uint8_t *buf, size_t len);
 ST_FUNC ST_Error ST_M4A_date(const ST_M4A *tag, uint8_t *buf, size_t len);
 ST_FUNC ST_Error ST_M4A_genre(const ST_M4A *tag, uint8_t *buf, size_t len);
 
+/* Integer items. These are decoded when the tag is read (or the item is
+   changed), and return -1 if the tag doesn't have the item. */
 ST_FUNC int ST_M4A_track(const ST_M4A *tag);
+ST_FUNC int ST_M4A_trackCount(const ST_M4A *tag);
 ST_FUNC int ST_M4A_disc(const ST_M4A *tag);
+ST_FUNC int ST_M4A_discCount(const ST_M4A *tag);
+ST_FUNC int ST_M4A_genreID(const ST_M4A *tag);
+ST_FUNC int ST_M4A_tempo(const ST_M4A *tag);
+ST_FUNC int ST_M4A_compilation(const ST_M4A *tag);
+ST_FUNC int ST_M4A_rating(const ST_M4A *tag);
+
+/* Get the genre of the tag, normalized as ST_Genre_normalize does. This comes
+   from the gnre item if the tag has one, or the \251gen item if not. */
+ST_FUNC int ST_M4A_normalizedGenre(const ST_M4A *tag, uint8_t *buf,
+                                   size_t len);
+
+/* Get a field as a NUL terminated UTF-8 string, as ST_Tag_get does. ReplayGain
+   values and MusicBrainz IDs come from the '----' items that iTunes-style
+   taggers (like foobar2000 and MusicBrainz Picard) write. */
+ST_FUNC ST_Error ST_M4A_get(const ST_M4A *tag, ST_Field field, uint8_t *buf,
+                            size_t len);
 
 ST_FUNC const ST_Picture *ST_M4A_picture(const ST_M4A *tag, int index);
 
+/* Audio properties, read from the moov when the tag is read from a file. These
+   return 0 if the file didn't have the value. The timescale and duration come
+   from the mvhd, and the audio timescale and duration from the mdhd of the
+   first sound track (durations are in units of the matching timescale). The
+   bitrate is in bits per second. */
+ST_FUNC uint32_t ST_M4A_timescale(const ST_M4A *tag);
+ST_FUNC uint64_t ST_M4A_duration(const ST_M4A *tag);
+ST_FUNC uint32_t ST_M4A_audioTimescale(const ST_M4A *tag);
+ST_FUNC uint64_t ST_M4A_audioDuration(const ST_M4A *tag);
+ST_FUNC uint32_t ST_M4A_sampleRate(const ST_M4A *tag);
+ST_FUNC uint32_t ST_M4A_channels(const ST_M4A *tag);
+ST_FUNC uint32_t ST_M4A_bitsPerSample(const ST_M4A *tag);
+ST_FUNC uint32_t ST_M4A_bitrate(const ST_M4A *tag);
+
+/* The length of the audio, in milliseconds. */
+ST_FUNC uint64_t ST_M4A_durationMs(const ST_M4A *tag);
+
+/* Chapters, from a QuickTime chapter track or a Nero chpl atom. Start times
+   are in milliseconds and titles are UTF-8. Titles from a chapter track are
+   only read from the file when they are first asked for, so the file needs to
+   still be there, unchanged, at that point (NULL is returned if it isn't).
+   With POSIX threads, ST_M4A_chapterTitle can be called from several threads
+   at once, as long as nothing is changing the tag. */
+ST_FUNC int ST_M4A_chapterCount(const ST_M4A *tag);
+ST_FUNC uint64_t ST_M4A_chapterStart(const ST_M4A *tag, int index);
+ST_FUNC const char *ST_M4A_chapterTitle(const ST_M4A *tag, int index);
+
+/* Read in all of the chapter titles that are still in the file, so that
+   nothing more will be read from it after this. Returns ST_Error_FileChanged if
+   the file has been changed since the tag was read from it. */
+ST_FUNC ST_Error ST_M4A_loadChapterTitles(ST_M4A *tag);
+
 #ifdef ST_HAVE_COREFOUNDATION
 /* CoreFoundation-based accessors. These functions will create CFStringRef
    objects for the given data. These accessors follow the "Create Rule" with
@@ -230,6 +308,11 @@ ST_FUNC const char *ST_M4A_Atom_longName(const ST_M4A_Atom *atom);
 ST_FUNC const uint8_t *ST_M4A_Atom_data(const ST_M4A_Atom *atom);
 ST_FUNC size_t ST_M4A_Atom_length(const ST_M4A_Atom *atom);
 
+/* The type indicator of the data in the atom (one of the ST_M4A_DataType values
+   for the types we know about). Atoms added to a tag by hand get the type that
+   iTunes normally uses for that atom. */
+ST_FUNC uint32_t ST_M4A_Atom_type(const ST_M4A_Atom *atom);
+
 #ifdef ST_HAVE_COREFOUNDATION
 /* CoreFoundation-based accessor for M4A Atom data. This assumes the atom
    actually contains UTF-8 string data. */
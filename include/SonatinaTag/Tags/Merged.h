@@ -0,0 +1,91 @@
+/*
+    SonatinaTag
+    Copyright (C) 2026 Lawrence Sebald
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License version 2.1 as published by the Free Software Foundation.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+*/
+
+#ifndef SonatinaTag__Tags__Merged_h
+#define SonatinaTag__Tags__Merged_h
+
+#include <SonatinaTag/cdefs.h>
+
+ST_BEGIN_DECLS
+
+#include <stddef.h>
+#include <stdint.h>
+#include <SonatinaTag/basedefs.h>
+#include <SonatinaTag/Error.h>
+#include <SonatinaTag/Picture.h>
+#include <SonatinaTag/SonatinaTag.h>
+
+/* Opaque merged tag structure. A merged tag holds every tag found in a file
+   (ID3v2 at the start, APEv2 and ID3v1 at the end) and answers for each field
+   from whichever of them has it, in order of precedence. It can be used as an
+   ST_Tag with all of the ST_Tag functions. */
+struct ST_Merged_struct;
+typedef struct ST_Merged_struct ST_Merged;
+
+/* The most tags a merged tag can hold. */
+#define ST_MERGED_MAX_TAGS      3
+
+/* Read every tag in a file, opening it only once. Returns NULL if the file
+   doesn't have any tags in it. By default, ID3v2 takes precedence over APEv2,
+   which takes precedence over ID3v1. */
+ST_FUNC ST_Merged *ST_Merged_createFromFile(const char *fn);
+
+/* Free a merged tag, along with all of the tags in it. */
+ST_FUNC void ST_Merged_free(ST_Merged *tag);
+
+/* How many tags were found in the file. */
+ST_FUNC int ST_Merged_tagCount(const ST_Merged *tag);
+
+/* Get one of the tags that was found, by type. Returns NULL if the file didn't
+   have that type of tag. The tag belongs to the merged tag, so don't free it or
+   change it. */
+ST_FUNC const ST_Tag *ST_Merged_tag(const ST_Merged *tag, ST_TagType type);
+
+/* Set the order tags are looked at in, for every field. The first type in order
+   wins over the rest. Types that aren't in order are never looked at. */
+ST_FUNC ST_Error ST_Merged_setPrecedence(ST_Merged *tag,
+                                         const ST_TagType *order, int count);
+
+/* Set the order tags are looked at in for only one field, as above. */
+ST_FUNC ST_Error ST_Merged_setFieldPrecedence(ST_Merged *tag, ST_Field field,
+                                              const ST_TagType *order,
+                                              int count);
+
+/* Figure out which tag a field comes from. Returns the type of tag that
+   ST_Merged_get would take the field from, or ST_TagType_Invalid if none of
+   them have it. */
+ST_FUNC ST_TagType ST_Merged_source(const ST_Merged *tag, ST_Field field);
+
+/* Accessors. These work just like ST_Tag_get and friends, taking each value
+   from the first tag (in order of precedence) that has it. The numbers and the
+   picture use the order set with ST_Merged_setPrecedence. */
+ST_FUNC ST_Error ST_Merged_get(const ST_Merged *tag, ST_Field field,
+                               uint8_t *buf, size_t len);
+ST_FUNC int ST_Merged_normalizedGenre(const ST_Merged *tag, uint8_t *buf,
+                                      size_t len);
+ST_FUNC int ST_Merged_track(const ST_Merged *tag);
+ST_FUNC int ST_Merged_disc(const ST_Merged *tag);
+ST_FUNC int ST_Merged_trackCount(const ST_Merged *tag);
+ST_FUNC int ST_Merged_discCount(const ST_Merged *tag);
+ST_FUNC uint64_t ST_Merged_durationMs(const ST_Merged *tag);
+ST_FUNC const ST_Picture *ST_Merged_picture(const ST_Merged *tag,
+                                            ST_PictureType pt, int index);
+
+ST_END_DECLS
+
+#endif /* !SonatinaTag__Tags__Merged_h */
@@ -26,7 +26,9 @@ typedef enum ST_TagType_e {
     ST_TagType_ID3v2            = 2,
     ST_TagType_FLAC             = 3,
     ST_TagType_M4A              = 4,
-    ST_TagType_APE              = 5
+    ST_TagType_APE              = 5,
+    ST_TagType_Merged           = 6,
+    ST_TagType_Frozen           = 7
 } ST_TagType;
 
 /* Valid Encoding types */
@@ -38,6 +40,29 @@ typedef enum ST_TextEncoding_e {
     ST_TextEncoding_UTF8        = 3
 } ST_TextEncoding;
 
+/* Fields that can be read out of any type of tag as UTF-8 (see ST_Tag_get).
+   Not every type of tag can hold every field. */
+typedef enum ST_Field_e {
+    ST_Field_Title              = 0,
+    ST_Field_Artist             = 1,
+    ST_Field_Album              = 2,
+    ST_Field_AlbumArtist        = 3,
+    ST_Field_Comment            = 4,
+    ST_Field_Date               = 5,
+    ST_Field_Genre              = 6,
+    ST_Field_Composer           = 7,
+    ST_Field_RGTrackGain        = 8,
+    ST_Field_RGTrackPeak        = 9,
+    ST_Field_RGAlbumGain        = 10,
+    ST_Field_RGAlbumPeak        = 11,
+    ST_Field_MBTrackID          = 12,
+    ST_Field_MBAlbumID          = 13,
+    ST_Field_MBArtistID         = 14,
+    ST_Field_MBAlbumArtistID    = 15,
+    ST_Field_MBReleaseGroupID   = 16,
+    ST_Field_Count
+} ST_Field;
+
 #define ST_4CC(a, b, c, d) (((a) << 24) | ((b) << 16) | ((c) << 8) | (d))
 
 #endif /* !SonatinaTag__basedefs_h */
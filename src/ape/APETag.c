@@ -25,22 +25,45 @@
 #include <string.h>
 #include <stdlib.h>
 #include <stdint.h>
+#include <unistd.h>
+#include <sys/types.h>
 
 #include "SonatinaTag/SonatinaTag.h"
 #include "SonatinaTag/Tags/APE.h"
+#include "SonatinaTag/Allocator.h"
 #include "../base/Tag.h"
+#include "../utils/Lazy.h"
+#include "../utils/Picture.h"
+#include "../utils/Tail.h"
+#include "../utils/Text.h"
 
 struct ST_APE_struct {
     ST_Tag base;
     ST_Dict *tags;
     uint32_t ver;
     uint32_t flags;
+    char *filename;
+    ST_FileStamp stamp;
+
+    /* First item for each of the well-known fields. These point at items owned
+       by the tags dictionary. */
+    const ST_APE_item *fields[ST_Field_Count];
 };
 
 struct ST_APE_item_struct {
     size_t length;
     uint32_t flags;
     uint8_t *data;
+    char *key;
+
+    /* Binary items read from a file aren't read in until they're needed. Cover
+       art items also get a picture made for them. The filename and stamp belong
+       to the tag. */
+    const char *fn;
+    const ST_FileStamp *stamp;
+    off_t offset;
+    const ST_Allocator *alloc;
+    ST_Picture *pic;
 };
 
 #ifdef MIN
@@ -49,40 +72,129 @@ struct ST_APE_item_struct {
 
 #define MIN(x, y) ((x < y) ? x : y)
 
+/* Flags in the header and footer of the tag. */
+#define APE_FLAG_HAS_HEADER     0x80000000
+#define APE_FLAG_NO_FOOTER      0x40000000
+#define APE_FLAG_IS_HEADER      0x20000000
+#define APE_FLAG_READ_ONLY      0x00000001
+
+/* The type of data in an item is in bits 1 and 2 of its flags. */
+#define APE_ITEM_TYPE(f)        (((f) >> 1) & 3)
+#define APE_ITEM_BINARY         1
+
+/* The longest an item key can be, and how much of the start of a cover art
+   item to read to get its filename and figure out what kind of image it is. */
+#define APE_KEY_MAX             255
+#define APE_SNIFF_LEN           1024
+
+/* Keys of the cover art items, in the same order as ST_PictureType. */
+static const char *cover_keys[ST_PictureType_MAX + 1] = {
+    "cover art (other)",
+    "cover art (png icon)",
+    "cover art (icon)",
+    "cover art (front)",
+    "cover art (back)",
+    "cover art (leaflet)",
+    "cover art (media)",
+    "cover art (lead artist)",
+    "cover art (artist)",
+    "cover art (conductor)",
+    "cover art (band)",
+    "cover art (composer)",
+    "cover art (lyricist)",
+    "cover art (recording location)",
+    "cover art (during recording)",
+    "cover art (during performance)",
+    "cover art (video capture)",
+    "cover art (a bright coloured fish)",
+    "cover art (illustration)",
+    "cover art (band logotype)",
+    "cover art (publisher logotype)"
+};
+
 static ST_APE_item *make_item(const uint8_t *buf, size_t length,
                               uint32_t flags) {
     ST_APE_item *rv;
 
-    if((rv = (ST_APE_item *)malloc(sizeof(ST_APE_item)))) {
-        if((rv->data = (uint8_t *)malloc(length))) {
+    if((rv = (ST_APE_item *)ST_malloc(sizeof(ST_APE_item)))) {
+        if((rv->data = (uint8_t *)ST_malloc(length))) {
             memcpy(rv->data, buf, length);
             rv->length = length;
             rv->flags = flags;
+            rv->key = NULL;
+            rv->fn = NULL;
+            rv->stamp = NULL;
+            rv->offset = 0;
+            rv->alloc = ST_currentAllocator();
+            rv->pic = NULL;
             return rv;
         }
 
-        free(rv);
+        ST_free(rv);
     }
 
     return NULL;
 }
 
-static ST_APE_item *make_item_nc(uint8_t *buf, size_t length, uint32_t flags) {
+/* Make an item whose data will be read from the file later on. */
+static ST_APE_item *make_item_ref(const char *fn, const ST_FileStamp *st,
+                                  off_t offset, size_t length, uint32_t flags) {
     ST_APE_item *rv;
 
-    if((rv = (ST_APE_item *)malloc(sizeof(ST_APE_item)))) {
-        rv->data = buf;
+    if((rv = (ST_APE_item *)ST_malloc(sizeof(ST_APE_item)))) {
+        rv->data = NULL;
         rv->length = length;
         rv->flags = flags;
-        return rv;
+        rv->key = NULL;
+        rv->fn = fn;
+        rv->stamp = st;
+        rv->offset = offset;
+        rv->alloc = ST_currentAllocator();
+        rv->pic = NULL;
     }
 
-    return NULL;
+    return rv;
+}
+
+/* Read in the data of an item made with make_item_ref. Where it came from is
+   left alone, since other threads may be looking at it. */
+static ST_Error load_item(ST_APE_item *c) {
+    const ST_Allocator *prev;
+    ST_Error rv;
+
+    if(c->data || !c->fn || !c->length)
+        return ST_Error_None;
+
+    /* The data gets freed along with the item, so allocate it the same way. */
+    prev = ST_useAllocator(c->alloc);
+    rv = ST_Lazy_read(c->fn, c->stamp, c->offset, c->length, &c->data);
+    ST_useAllocator(prev);
+
+    return rv;
+}
+
+/* Read in everything of an item that's still in the file, its picture's data
+   included, so that nothing more needs to be read from the file for it. Only
+   for when nothing else can be looking at the item. */
+static ST_Error load_item_all(ST_APE_item *c) {
+    ST_Error rv;
+
+    if((rv = load_item(c)) != ST_Error_None)
+        return rv;
+
+    c->fn = NULL;
+
+    if(c->pic)
+        return ST_Picture_load(c->pic);
+
+    return ST_Error_None;
 }
 
 static void free_item(ST_APE_item *c) {
-    free(c->data);
-    free(c);
+    ST_Picture_free(c->pic);
+    ST_free(c->key);
+    ST_free(c->data);
+    ST_free(c);
 }
 
 ST_FUNC size_t ST_APE_item_length(const ST_APE_item *c) {
@@ -103,21 +215,34 @@ ST_FUNC const uint8_t *ST_APE_item_data(const ST_APE_item *c) {
     if(!c)
         return NULL;
 
+    /* Binary items might not have been read in yet. The filename is only
+       cleared by ST_APE_loadItems, so it's safe to check without the lock. */
+    if(c->fn) {
+        ST_Lazy_lock();
+        load_item((ST_APE_item *)c);
+        ST_Lazy_unlock();
+    }
+
     return c->data;
 }
 
 ST_FUNC ST_APE *ST_APE_create(void) {
-    ST_APE *rv = (ST_APE *)malloc(sizeof(ST_APE));
+    ST_APE *rv = (ST_APE *)ST_malloc(sizeof(ST_APE));
     void (*f)(void *);
 
     if(rv) {
         f = (void (*)(void *))free_item;
         if(!(rv->tags = ST_Dict_createString(10, f))) {
-            free(rv);
+            ST_free(rv);
             return NULL;
         }
 
+        rv->ver = 2000;
+        rv->flags = 0;
+        rv->filename = NULL;
+        memset(rv->fields, 0, sizeof(rv->fields));
         rv->base.type = ST_TagType_APE;
+        rv->base.arena = NULL;
     }
 
     return rv;
@@ -127,182 +252,407 @@ ST_FUNC void ST_APE_free(ST_APE *tag) {
     if(!tag || tag->base.type != ST_TagType_APE)
         return;
 
+    if(tag->base.arena) {
+        ST_Arena_free(tag->base.arena);
+        return;
+    }
+
     /* Clean up the dictionaries. This will free all the values in them too. */
     ST_Dict_free(tag->tags);
 
-    free(tag);
+    ST_free(tag->filename);
+    ST_free(tag);
 }
 
-ST_FUNC ST_APE *ST_APE_createFromFile(const char *fn) {
-    FILE *fp;
-    uint8_t buf[8];
-    uint32_t sz, count;
-    long lsz;
-    ST_APE *rv = ST_APE_create();
-    uint32_t isz, flags, has_id3v1 = 0, i;
-    int key_len;
-    char *key;
-    uint8_t *val;
-    ST_APE_item *item;
+/* Keys that each of the well-known fields can be found under, in order of
+   preference. These get resolved when items are added or removed, so that
+   ST_APE_get doesn't have to go through the dictionary every time. */
+static const char *field_keys[ST_Field_Count][2] = {
+    { "title", NULL },
+    { "artist", NULL },
+    { "album", NULL },
+    { "album artist", "albumartist" },
+    { "comment", NULL },
+    { "year", "date" },
+    { "genre", NULL },
+    { "composer", NULL },
+    { "replaygain_track_gain", NULL },
+    { "replaygain_track_peak", NULL },
+    { "replaygain_album_gain", NULL },
+    { "replaygain_album_peak", NULL },
+    { "musicbrainz_trackid", NULL },
+    { "musicbrainz_albumid", NULL },
+    { "musicbrainz_artistid", NULL },
+    { "musicbrainz_albumartistid", NULL },
+    { "musicbrainz_releasegroupid", NULL }
+};
 
-    if(!rv)
-        return NULL;
+static void resolve_field(ST_APE *tag, int id) {
+    const void **value;
+    int i, count;
 
-    /* Open up the file for reading */
-    fp = fopen(fn, "rb");
-    if(!fp)
-        goto out_free;
+    tag->fields[id] = NULL;
 
-    /* Look for the APE Tag footer... */
-    if(fseek(fp, -32, SEEK_END))
-        goto out_close;
+    for(i = 0; i < 2 && field_keys[id][i]; ++i) {
+        if((value = ST_Dict_find(tag->tags, field_keys[id][i], &count)) &&
+           count) {
+            tag->fields[id] = (const ST_APE_item *)value[0];
+            return;
+        }
+    }
+}
 
-    if(fread(buf, 1, 8, fp) != 8)
-        goto out_close;
+/* Re-resolve any well-known fields that use the given key, after items with
+   that key have been added or removed. */
+static void update_field(ST_APE *tag, const char *key) {
+    int i, j;
 
-    if(memcmp("APETAGEX", buf, 8)) {
-        /* Skip any ID3v1 tag and try again... */
-        if(fseek(fp, -128, SEEK_END))
-            goto out_close;
+    for(i = 0; i < ST_Field_Count; ++i) {
+        for(j = 0; j < 2 && field_keys[i][j]; ++j) {
+            if(!strcasecmp(key, field_keys[i][j]))
+                resolve_field(tag, i);
+        }
+    }
+}
 
-        if(fread(buf, 1, 3, fp) != 3)
-            goto out_close;
+static uint32_t get_u32(const uint8_t *buf) {
+    return buf[0] | (buf[1] << 8) | (buf[2] << 16) | ((uint32_t)buf[3] << 24);
+}
 
-        if(memcmp("TAG", buf, 3))
-            goto out_close;
+/* Which picture type a key is for, or -1 if it isn't a cover art key. */
+static int cover_type(const char *key) {
+    int i;
 
-        if(fseek(fp, -160, SEEK_END))
-            goto out_close;
+    if(strncmp(key, "cover art (", 11))
+        return -1;
 
-        if(fread(buf, 1, 8, fp) != 8)
-            goto out_close;
+    for(i = 0; i <= ST_PictureType_MAX; ++i) {
+        if(!strcmp(key, cover_keys[i]))
+            return i;
+    }
 
-        if(memcmp("APETAGEX", buf, 8))
-            goto out_close;
+    return -1;
+}
 
-        has_id3v1 = 1;
+/* Figure out the MIME type of a picture from its data, or failing that, the
+   extension on its filename. */
+static const char *sniff_mime(const uint8_t *d, size_t len, const uint8_t *fn,
+                              size_t fnlen) {
+    char ext[6];
+    size_t i;
+
+    if(len >= 3 && d[0] == 0xFF && d[1] == 0xD8 && d[2] == 0xFF)
+        return "image/jpeg";
+    else if(len >= 4 && !memcmp(d, "\211PNG", 4))
+        return "image/png";
+    else if(len >= 4 && !memcmp(d, "GIF8", 4))
+        return "image/gif";
+    else if(len >= 2 && !memcmp(d, "BM", 2))
+        return "image/bmp";
+    else if(len >= 12 && !memcmp(d, "RIFF", 4) && !memcmp(d + 8, "WEBP", 4))
+        return "image/webp";
+
+    for(i = 0; i < fnlen && i < sizeof(ext) - 1; ++i) {
+        ext[i] = tolower(fn[fnlen - i - 1]);
+
+        if(ext[i] == '.')
+            break;
     }
 
-    /* Make sure we support the version of the tag */
-    if(fread(buf, 1, 4, fp) != 4)
-        goto out_close;
+    if(i == fnlen || i == sizeof(ext) - 1)
+        return NULL;
 
-    rv->ver = buf[0] | (buf[1] << 8) | (buf[2] << 16) | (buf[3] << 24);
-    if(rv->ver != 2000)
-        goto out_close;
+    /* The extension is backwards in ext, dot and all. */
+    ext[i + 1] = 0;
+
+    if(!strcmp(ext, "gpj.") || !strcmp(ext, "gepj."))
+        return "image/jpeg";
+    else if(!strcmp(ext, "gnp."))
+        return "image/png";
+    else if(!strcmp(ext, "fig."))
+        return "image/gif";
+    else if(!strcmp(ext, "pmb."))
+        return "image/bmp";
+
+    return NULL;
+}
+
+/* Make a picture out of the value of a cover art item. The value is the
+   filename of the picture, a NUL, and then the picture data, len bytes in all.
+   If fn is given, buf only needs to hold the first avail bytes of it (enough
+   for the filename and the start of the data), and the data will be read from
+   the file at the given offset when it's needed. Otherwise it is copied out of
+   buf, which has to hold all of it. */
+static ST_Picture *make_picture(const uint8_t *buf, size_t avail, size_t len,
+                                int type, const char *fn,
+                                const ST_FileStamp *st, off_t offset) {
+    ST_Picture *pic;
+    const uint8_t *end;
+    const char *mime;
+    size_t nlen = 0;
+
+    if(len > UINT32_MAX || !(pic = ST_Picture_create()))
+        return NULL;
 
-    /* Grab the size of the tag and the flags */
-    if(fread(buf, 1, 4, fp) != 4)
-        goto out_close;
+    if((end = (const uint8_t *)memchr(buf, 0, avail))) {
+        nlen = end - buf;
 
-    lsz = sz = buf[0] | (buf[1] << 8) | (buf[2] << 16) | (buf[3] << 24);
+        if(nlen && ST_Picture_setDescription(pic, buf, (uint32_t)nlen,
+                                             ST_TextEncoding_UTF8))
+            goto out_free;
 
-    if(fread(buf, 1, 4, fp) != 4)
-        goto out_close;
+        ++nlen;
+    }
 
-    count = buf[0] | (buf[1] << 8) | (buf[2] << 16) | (buf[3] << 24);
+    ST_Picture_setType(pic, (ST_PictureType)type);
 
-    if(fread(buf, 1, 4, fp) != 4)
-        goto out_close;
+    if((mime = sniff_mime(buf + nlen, avail - nlen, buf, end ? nlen - 1 : 0)) &&
+       ST_Picture_setMimeType(pic, mime))
+        goto out_free;
 
-    rv->flags = buf[0] | (buf[1] << 8) | (buf[2] << 16) | (buf[3] << 24);
+    if(len == nlen)
+        return pic;
 
-    /* Seek to the beginning of the tag (excluding any header, if present) */
-    if(!has_id3v1) {
-        if(fseek(fp, -lsz, SEEK_END))
-            goto out_close;
+    if(fn) {
+        if(ST_Picture_setDataSource(pic, fn, st, offset + (off_t)nlen,
+                                    (uint32_t)(len - nlen)))
+            goto out_free;
     }
-    else {
-        if(fseek(fp, -(lsz + 128), SEEK_END))
-            goto out_close;
+    else if(ST_Picture_setData(pic, (uint8_t *)buf + nlen,
+                               (uint32_t)(len - nlen), 0)) {
+        goto out_free;
     }
 
-    /* Go through all the items in the tag. */
-    while(sz > 32) {
-        /* Read the length and flags of the item. */
-        if(fread(buf, 1, 8, fp) != 8)
-            goto out_close;
+    return pic;
 
-        isz = buf[0] | (buf[1] << 8) | (buf[2] << 16) | (buf[3] << 24);
-        flags = buf[4] | (buf[5] << 8) | (buf[6] << 16) | (buf[7] << 24);
-        key_len = 0;
+out_free:
+    ST_Picture_free(pic);
+    return NULL;
+}
 
-        /* Figure out how long the key is */
-        do {
-            if(fread(buf, 1, 1, fp) != 1)
-                goto out_close;
+/* Make an item out of a value in the file, straight out of what the probe read
+   in if it's there. */
+static ST_APE_item *read_item(const ST_Tail *t, FILE *fp, off_t offset,
+                              uint32_t len, uint32_t flags) {
+    const uint8_t *d;
+    ST_APE_item *rv;
 
-            ++key_len;
-        } while(buf[0] != 0);
+    if((d = ST_Tail_bytes(t, offset, len)))
+        return make_item(d, len, flags);
 
-        /* Sanity check. */
-        if(key_len < 2 || (sz - 8 - key_len - isz) < 32)
-            goto out_close;
+    if(!(rv = make_item_ref(NULL, NULL, offset, len, flags)))
+        return NULL;
 
-        /* Read in the key */
-        if(!(key = (char *)malloc(key_len)))
-            goto out_close;
+    if(!(rv->data = (uint8_t *)ST_malloc(len ? len : 1)) ||
+       ST_Tail_read(t, fp, offset, rv->data, len)) {
+        free_item(rv);
+        return NULL;
+    }
 
-        if(fseek(fp, -key_len, SEEK_CUR)) {
-            free(key);
-            goto out_close;
-        }
+    return rv;
+}
 
-        if(fread(key, 1, key_len, fp) != key_len) {
-            free(key);
-            goto out_close;
-        }
+/* Parse the items of a tag, which take up len bytes of the file starting at
+   start. Only the item headers and text values are read. Binary items are left
+   in the file until they're needed, and cover art only has enough of the start
+   of it read to set up the picture. */
+static int parse_items(ST_APE *tag, const ST_Tail *t, FILE *fp, off_t start,
+                       uint32_t len, uint32_t count) {
+    uint8_t head[8 + APE_KEY_MAX + 1], pre[APE_SNIFF_LEN];
+    uint32_t isz, flags, pos = 0, i, n;
+    uint8_t *end;
+    char *key;
+    size_t key_len, j;
+    ST_APE_item *item;
+    int type;
 
-        /* Convert the whole key to lower-case. */
-        for(i = 0; i < key_len; ++i) {
-            key[i] = tolower(key[i]);
-        }
+    for(i = 0; i < count && pos < len; ++i) {
+        /* Read the length and flags of the item, and its key, which is a NUL
+           terminated string right after them. */
+        n = MIN(len - pos, (uint32_t)sizeof(head));
+
+        if(n < 8 || ST_Tail_read(t, fp, start + pos, head, n))
+            return -1;
 
-        /* Read in the value */
-        if(!(val = (uint8_t *)malloc(isz))) {
-            free(key);
-            goto out_close;
+        isz = get_u32(head);
+        flags = get_u32(head + 4);
+        key = (char *)head + 8;
+
+        if(!(end = (uint8_t *)memchr(key, 0, n - 8)))
+            return -1;
+
+        key_len = end - (uint8_t *)key;
+        pos += 8 + key_len + 1;
+
+        /* Sanity check. */
+        if(key_len < 1 || isz > len - pos)
+            return -1;
+
+        if(APE_ITEM_TYPE(flags) == APE_ITEM_BINARY && tag->filename)
+            item = make_item_ref(tag->filename, &tag->stamp, start + pos, isz,
+                                 flags);
+        else
+            item = read_item(t, fp, start + pos, isz, flags);
+
+        if(!item)
+            return -1;
+
+        /* Keep the key as it was in the file for when the tag gets written back
+           out, then convert the whole key to lower-case for looking it up. */
+        if(!(item->key = ST_strdup(key))) {
+            free_item(item);
+            return -1;
         }
 
-        if(fread(val, 1, isz, fp) != isz) {
-            free(val);
-            free(key);
-            goto out_close;
+        for(j = 0; j < key_len; ++j) {
+            key[j] = tolower(key[j]);
         }
 
-        if(!(item = make_item_nc(val, isz, flags))) {
-            free(val);
-            free(key);
-            goto out_close;
+        /* Cover art gets its picture set up now, while the filename and the
+           start of the data are handy. */
+        if((type = cover_type(key)) != -1) {
+            if(item->data) {
+                item->pic = make_picture(item->data, isz, isz, type, NULL,
+                                         NULL, 0);
+            }
+            else {
+                n = MIN(isz, (uint32_t)sizeof(pre));
+
+                if(!ST_Tail_read(t, fp, start + pos, pre, n))
+                    item->pic = make_picture(pre, n, isz, type, tag->filename,
+                                             &tag->stamp, start + pos);
+            }
+
+            if(!item->pic) {
+                free_item(item);
+                return -1;
+            }
         }
 
         /* Add the item to our list. */
-        if(ST_Dict_add(rv->tags, key, item) != ST_Error_None) {
+        if(ST_Dict_add(tag->tags, key, item) != ST_Error_None) {
             free_item(item);
-            free(key);
-            goto out_close;
+            return -1;
         }
 
-        /* Clean up... */
-        free(key);
-        sz -= 8 + key_len + isz;
+        update_field(tag, key);
+
+        pos += isz;
     }
 
-    /* We're done, so clean up. */
-    fclose(fp);
+    return 0;
+}
+
+ST_LOCAL ST_APE *ST_APE_createFromTail(const char *fn, FILE *fp,
+                                       const ST_Tail *t) {
+    uint8_t head[32];
+    const uint8_t *ftr;
+    uint32_t sz, count, len;
+    off_t start;
+    ST_APE *rv = ST_APE_create();
+
+    if(!rv)
+        return NULL;
+
+    /* The size in the footer covers the items and the footer, but not the
+       header. */
+    if(t->ape != -1) {
+        ftr = t->ape_footer;
+        sz = get_u32(ftr + 12);
+        start = t->ape_items;
+        len = sz - 32;
+    }
+    else {
+        /* Some files (mostly Monkey's Audio and WavPack ones written by older
+           tools) have the tag at the start of the file instead, with a header
+           in front of it. The size in the header works the same way, but there
+           might not be a footer at all. */
+        if(fseeko(fp, 0, SEEK_SET) || fread(head, 1, 32, fp) != 32 ||
+           memcmp("APETAGEX", head, 8) ||
+           !(get_u32(head + 20) & APE_FLAG_IS_HEADER))
+            goto out;
+
+        ftr = head;
+        sz = get_u32(ftr + 12);
+        start = 32;
+        len = (get_u32(ftr + 20) & APE_FLAG_NO_FOOTER) ? sz : sz - 32;
+    }
+
+    /* Make sure we support the version of the tag */
+    rv->ver = get_u32(ftr + 8);
+    if(rv->ver != 2000)
+        goto out;
+
+    /* Grab the item count and the flags */
+    count = get_u32(ftr + 16);
+    rv->flags = get_u32(ftr + 20);
+
+    if(len > sz || (off_t)sz > t->file_size || start < 0 ||
+       start + (off_t)len > t->file_size)
+        goto out;
+
+    /* Binary items get read from the file later, so keep its name around, and
+       enough about it to tell if it changes before then. */
+    if(!(rv->filename = ST_strdup(fn)) || ST_FileStamp_take(&rv->stamp, fp))
+        goto out;
+
+    /* Walk through the items, reading them out of what the probe already read
+       where possible. */
+    if(parse_items(rv, t, fp, start, len, count))
+        goto out;
 
     return rv;
 
-out_close:
-    fclose(fp);
-out_free:
+out:
     ST_APE_free(rv);
     return NULL;
 }
 
+static void load_each(const ST_Dict *d, void *data, const void *key,
+                      const void *v) {
+    ST_Error *err = (ST_Error *)data;
+    ST_Error rv;
+
+    (void)d;
+    (void)key;
+
+    if((rv = load_item_all((ST_APE_item *)v)) != ST_Error_None &&
+       *err == ST_Error_None)
+        *err = rv;
+}
+
+ST_FUNC ST_Error ST_APE_loadItems(ST_APE *tag) {
+    ST_Error rv = ST_Error_None;
+
+    if(!tag || tag->base.type != ST_TagType_APE)
+        return ST_Error_InvalidArgument;
+
+    ST_Dict_foreach(tag->tags, &rv, &load_each);
+    return rv;
+}
+
+ST_FUNC ST_APE *ST_APE_createFromFile(const char *fn) {
+    FILE *fp;
+    ST_Tail t;
+    ST_APE *rv = NULL;
+
+    /* Open up the file for reading */
+    if(!(fp = fopen(fn, "rb")))
+        return NULL;
+
+    if(!ST_Tail_probe(fp, &t)) {
+        rv = ST_APE_createFromTail(fn, fp, &t);
+        ST_Tail_release(&t);
+    }
+
+    fclose(fp);
+    return rv;
+}
+
 ST_FUNC ST_Error ST_APE_itemForKey(const ST_APE *tag, const char *key,
                                    uint8_t *buf, size_t len) {
     const void **value;
+    const uint8_t *data;
     int count;
     ST_APE_item *val;
 
@@ -312,8 +662,13 @@ ST_FUNC ST_Error ST_APE_itemForKey(const ST_APE *tag, const char *key,
     if((value = ST_Dict_find(tag->tags, key, &count))) {
         if(count) {
             val = (ST_APE_item *)value[0];
+
+            /* Binary items might not have been read in yet. */
+            if(!(data = ST_APE_item_data(val)) && val->length)
+                return ST_Error_errno;
+
             memset(buf, 0, len);
-            memcpy(buf, val->data, MIN(len, val->length));
+            memcpy(buf, data, MIN(len, val->length));
             return ST_Error_None;
         }
     }
@@ -341,7 +696,8 @@ ST_FUNC CFStringRef ST_APE_copyItemForKey(const ST_APE *tag, const char *key,
             if(err)
                 *err = ST_Error_None;
 
-            return CFStringCreateWithBytes(kCFAllocatorDefault, val->data,
+            return CFStringCreateWithBytes(kCFAllocatorDefault,
+                                           ST_APE_item_data(val),
                                            val->length, kCFStringEncodingUTF8,
                                            false);
         }
@@ -414,6 +770,51 @@ ST_FUNC ST_Error ST_APE_genre(const ST_APE *tag, uint8_t *buf, size_t len) {
     return ST_APE_itemForKey(tag, "genre", buf, len);
 }
 
+ST_FUNC int ST_APE_normalizedGenre(const ST_APE *tag, uint8_t *buf,
+                                   size_t len) {
+    const ST_APE_item *item;
+    const uint8_t *data;
+
+    if(buf && len)
+        buf[0] = 0;
+
+    if(!tag || tag->base.type != ST_TagType_APE)
+        return ST_Genre_None;
+
+    if(!(item = tag->fields[ST_Field_Genre]) ||
+       !(data = ST_APE_item_data(item)))
+        return ST_Genre_None;
+
+    return ST_Genre_normalize(data, item->length, buf, len);
+}
+
+ST_FUNC ST_Error ST_APE_get(const ST_APE *tag, ST_Field field, uint8_t *buf,
+                            size_t len) {
+    const ST_APE_item *item;
+    const uint8_t *data;
+    size_t n;
+
+    if(!tag || tag->base.type != ST_TagType_APE || !buf || !len ||
+       field < 0 || field >= ST_Field_Count)
+        return ST_Error_InvalidArgument;
+
+    buf[0] = 0;
+
+    if(field == ST_Field_Genre) {
+        return ST_Tag_getGenre((const ST_Tag *)tag, buf, len);
+    }
+
+    if(!(item = tag->fields[field]) ||
+       APE_ITEM_TYPE(item->flags) == APE_ITEM_BINARY ||
+       !(data = ST_APE_item_data(item)))
+        return ST_Error_NotFound;
+
+    if(!(n = ST_Text_firstLength(data, item->length, ST_TextEncoding_UTF8)))
+        return ST_Error_NotFound;
+
+    return ST_Text_getUTF8(data, n, ST_TextEncoding_UTF8, buf, len);
+}
+
 #ifdef ST_HAVE_COREFOUNDATION
 ST_FUNC CFStringRef ST_APE_copyTitle(const ST_APE *tag, ST_Error *err) {
     if(!tag || tag->base.type != ST_TagType_APE) {
@@ -494,7 +895,7 @@ ST_FUNC int ST_APE_track(const ST_APE *tag) {
 ST_FUNC int ST_APE_disc(const ST_APE *tag) {
     uint8_t tmp[32];
 
-    if(!tag || tag->base.type != ST_TagType_FLAC)
+    if(!tag || tag->base.type != ST_TagType_APE)
         return -1;
 
     if(ST_APE_itemForKey(tag, "disc", tmp, 32) != ST_Error_None) {
@@ -506,6 +907,75 @@ ST_FUNC int ST_APE_disc(const ST_APE *tag) {
     return atoi((const char *)tmp);
 }
 
+/* Get the total out of an item of the form "number/total". */
+static int item_total(const ST_APE *tag, const char *key, const char *key2) {
+    uint8_t tmp[32];
+    const char *slash;
+
+    if(!tag || tag->base.type != ST_TagType_APE)
+        return -1;
+
+    if(ST_APE_itemForKey(tag, key, tmp, 32) != ST_Error_None) {
+        if(ST_APE_itemForKey(tag, key2, tmp, 32) != ST_Error_None)
+            return -1;
+    }
+
+    tmp[31] = 0;
+
+    if(!(slash = strchr((const char *)tmp, '/')))
+        return -1;
+
+    return atoi(slash + 1);
+}
+
+ST_FUNC int ST_APE_trackCount(const ST_APE *tag) {
+    return item_total(tag, "track", "tracknumber");
+}
+
+ST_FUNC int ST_APE_discCount(const ST_APE *tag) {
+    return item_total(tag, "disc", "discnumber");
+}
+
+ST_FUNC const ST_Picture *ST_APE_picture(const ST_APE *tag, ST_PictureType pt,
+                                         int index) {
+    const void **values;
+    const ST_Picture *pic;
+    int i, first, last, count;
+
+    if(!tag || tag->base.type != ST_TagType_APE || index < 0)
+        return NULL;
+
+    if(pt == ST_PictureType_Any) {
+        first = 0;
+        last = ST_PictureType_MAX;
+    }
+    else if(pt >= 0 && pt <= ST_PictureType_MAX) {
+        first = last = pt;
+    }
+    else {
+        return NULL;
+    }
+
+    /* Count through the cover art items of the type(s) asked for until we get
+       to the index that was requested. */
+    for(; first <= last; ++first) {
+        if(!(values = ST_Dict_find(tag->tags, cover_keys[first], &count)))
+            continue;
+
+        for(i = 0; i < count; ++i) {
+            if(!(pic = ((const ST_APE_item *)values[i])->pic))
+                continue;
+
+            if(!index)
+                return pic;
+
+            --index;
+        }
+    }
+
+    return NULL;
+}
+
 ST_FUNC size_t ST_APE_titleLength(const ST_APE *tag) {
     return ST_APE_itemLengthForKey(tag, "title");
 }
@@ -549,6 +1019,8 @@ static ST_Error replace_tag(ST_APE *tag, const char *k, const uint8_t *v,
 
     if(rv != ST_Error_None)
         free_item(c);
+    else
+        update_field(tag, k);
 
     return rv;
 }
@@ -609,34 +1081,38 @@ static ST_APE_item *make_item_str(CFStringRef s, uint32_t flags) {
     slen = CFStringGetLength(s);
     len = CFStringGetMaximumSizeForEncoding(CFStringGetLength(s),
                                             kCFStringEncodingUTF8);
-    if(!(tmp = (uint8_t *)malloc(len)))
+    if(!(tmp = (uint8_t *)ST_malloc(len)))
         return NULL;
 
     if(CFStringGetBytes(s, CFRangeMake(0, slen), kCFStringEncodingUTF8, 0,
                         false, (UInt8 *)tmp, len, &clen) != len) {
-        free(tmp);
+        ST_free(tmp);
         errno = EILSEQ;
         return NULL;
     }
 
     /* Trim the buffer down to the smallest it can be, since we allocated the
        maximum length it could've been up above. */
-    if(!(stmp = (uint8_t *)realloc(tmp, clen))) {
-        free(tmp);
+    if(!(stmp = (uint8_t *)ST_realloc(tmp, clen))) {
+        ST_free(tmp);
         return NULL;
     }
 
-    free(tmp);
+    ST_free(tmp);
 
     /* Make the comment structure and return it! */
-    if((rv = (ST_APE_item *)malloc(sizeof(ST_APE_item)))) {
+    if((rv = (ST_APE_item *)ST_malloc(sizeof(ST_APE_item)))) {
         rv->data = stmp;
         rv->length = clen;
         rv->flags = flags;
+        rv->key = NULL;
+        rv->fn = NULL;
+        rv->offset = 0;
+        rv->pic = NULL;
         return rv;
     }
 
-    free(stmp);
+    ST_free(stmp);
     return NULL;
 }
 
@@ -658,6 +1134,8 @@ static ST_Error replace_tag_str(ST_APE *tag, const char *k, CFStringRef s,
 
     if(rv != ST_Error_None)
         free_item(c);
+    else
+        update_field(tag, k);
 
     return rv;
 }
@@ -709,7 +1187,7 @@ static void dfunc(const ST_Dict *d, void *data, const void *key,
         return;
 
     value = CFStringCreateWithBytes(kCFAllocatorDefault,
-                                    (const UInt8 *)comment->data,
+                                    ST_APE_item_data(comment),
                                     comment->length, kCFStringEncodingUTF8,
                                     false);
     if(!value) {
@@ -757,6 +1235,7 @@ ST_FUNC ST_Error ST_APE_addItem(ST_APE *tag, const char *key,
                                 uint32_t flags) {
     ST_APE_item *tmp;
     ST_Error rv;
+    int type;
 
     if(!tag || !key || !value || tag->base.type != ST_TagType_APE)
         return ST_Error_InvalidArgument;
@@ -764,8 +1243,16 @@ ST_FUNC ST_Error ST_APE_addItem(ST_APE *tag, const char *key,
     if(!(tmp = make_item(value, len, flags)))
         return ST_Error_errno;
 
+    /* Cover art gets its picture made now, rather than when it's first asked
+       for, so that ST_APE_picture doesn't have to change the tag. */
+    if(APE_ITEM_TYPE(flags) == APE_ITEM_BINARY &&
+       (type = cover_type(key)) != -1)
+        tmp->pic = make_picture(value, len, len, type, NULL, NULL, 0);
+
     if((rv = ST_Dict_add(tag->tags, key, tmp)) != ST_Error_None)
-        free(tmp);
+        free_item(tmp);
+    else
+        update_field(tag, key);
 
     return rv;
 }
@@ -783,15 +1270,197 @@ ST_FUNC ST_Error ST_APE_addItemStr(ST_APE *tag, const char *key,
         return ST_Error_errno;
 
     if((rv = ST_Dict_add(tag->tags, key, tmp)) != ST_Error_None)
-        free(tmp);
+        ST_free(tmp);
+    else
+        update_field(tag, key);
 
     return rv;
 }
 #endif
 
 ST_FUNC ST_Error ST_APE_removeItem(ST_APE *tag, const char *key) {
+    ST_Error rv;
+
     if(!tag || !key || tag->base.type != ST_TagType_APE)
         return ST_Error_InvalidArgument;
 
-    return ST_Dict_remove(tag->tags, key, 0);
+    if((rv = ST_Dict_remove(tag->tags, key, 0)) == ST_Error_None)
+        update_field(tag, key);
+
+    return rv;
+}
+
+/* Buffer used to build up the tag before writing it out. */
+typedef struct ape_wbuf_s {
+    uint8_t *data;
+    size_t len;
+    uint32_t count;
+    int err;
+} ape_wbuf_t;
+
+static void put_u32(uint8_t *buf, uint32_t v) {
+    buf[0] = (uint8_t)v;
+    buf[1] = (uint8_t)(v >> 8);
+    buf[2] = (uint8_t)(v >> 16);
+    buf[3] = (uint8_t)(v >> 24);
+}
+
+/* Write the header or footer of a tag. */
+static void put_header(uint8_t *buf, uint32_t sz, uint32_t count,
+                       uint32_t flags) {
+    memcpy(buf, "APETAGEX", 8);
+    put_u32(buf + 8, 2000);
+    put_u32(buf + 12, sz);
+    put_u32(buf + 16, count);
+    put_u32(buf + 20, flags);
+    memset(buf + 24, 0, 8);
+}
+
+/* Keys are written out the way they were in the file, if they came from
+   one. */
+static const char *item_key(const void *key, const ST_APE_item *item) {
+    return item->key ? item->key : (const char *)key;
+}
+
+static void size_item(const ST_Dict *d, void *data, const void *key,
+                      const void *v) {
+    ape_wbuf_t *b = (ape_wbuf_t *)data;
+    const ST_APE_item *item = (const ST_APE_item *)v;
+
+    (void)d;
+
+    /* Anything that hasn't been read in yet has to be now, since the old tag
+       is about to be overwritten. The tag is const here, so this goes through
+       the getters like anything else reading it. */
+    if((!ST_APE_item_data(item) && item->length) ||
+       (item->pic && !ST_Picture_data(item->pic) &&
+        ST_Picture_dataLength(item->pic)))
+        b->err = 1;
+
+    b->len += 8 + strlen(item_key(key, item)) + 1 + item->length;
+    ++b->count;
+}
+
+static void write_item(const ST_Dict *d, void *data, const void *key,
+                       const void *v) {
+    ape_wbuf_t *b = (ape_wbuf_t *)data;
+    const ST_APE_item *item = (const ST_APE_item *)v;
+    const char *k = item_key(key, item);
+    size_t klen = strlen(k) + 1;
+
+    char *o = (char *)b->data + b->len + 8;
+    size_t i;
+
+    (void)d;
+
+    put_u32(b->data + b->len, (uint32_t)item->length);
+    put_u32(b->data + b->len + 4, item->flags);
+    memcpy(o, k, klen);
+
+    /* Keys we only have in lower-case get the usual capitalization (like
+       "Title" or "Cover Art (Front)"). */
+    if(!item->key) {
+        for(i = 0; i < klen; ++i) {
+            if(!i || o[i - 1] == ' ' || o[i - 1] == '(')
+                o[i] = toupper(o[i]);
+        }
+    }
+
+    if(item->length)
+        memcpy(b->data + b->len + 8 + klen, item->data, item->length);
+    b->len += 8 + klen + item->length;
+}
+
+ST_FUNC ST_Error ST_APE_writeToFile(const ST_APE *tag, const char *fn) {
+    FILE *fp;
+    ST_Tail t;
+    uint8_t *trail = NULL;
+    ape_wbuf_t b = { NULL, 0, 0, 0 };
+    off_t start, keep, end;
+    size_t tlen;
+    uint32_t sz, flags;
+    ST_Error rv = ST_Error_Unknown;
+
+    if(!tag || !fn || tag->base.type != ST_TagType_APE)
+        return ST_Error_InvalidArgument;
+
+    if(!(fp = fopen(fn, "r+b")))
+        return ST_Error_errno;
+
+    if(ST_Tail_probe(fp, &t)) {
+        fclose(fp);
+        return ST_Error_errno;
+    }
+
+    /* An existing tag gets replaced right where it is. Otherwise, the new one
+       goes in front of any Enhanced TAG+ block and ID3v1 tag. */
+    if(t.ape != -1) {
+        start = t.ape;
+        keep = t.ape + t.ape_size;
+    }
+    else if(t.tag_plus != -1) {
+        start = keep = t.tag_plus;
+    }
+    else if(t.id3v1 != -1) {
+        start = keep = t.id3v1;
+    }
+    else {
+        start = keep = t.file_size;
+    }
+
+    /* Hang onto everything after the tag, since it has to stay after it. */
+    tlen = (size_t)(t.file_size - keep);
+
+    if(tlen && (!(trail = (uint8_t *)ST_malloc(tlen)) ||
+                ST_Tail_read(&t, fp, keep, trail, tlen)))
+        goto out_errno;
+
+    /* Build the new tag in memory. An empty tag just gets removed. */
+    ST_Dict_foreach(tag->tags, &b, &size_item);
+
+    if(b.err)
+        goto out_errno;
+
+    if(b.count) {
+        if(b.len > UINT32_MAX - 64 ||
+           !(b.data = (uint8_t *)ST_malloc(b.len + 64)))
+            goto out_errno;
+
+        sz = (uint32_t)b.len + 32;
+        flags = APE_FLAG_HAS_HEADER | (tag->flags & APE_FLAG_READ_ONLY);
+        put_header(b.data, sz, b.count, flags | APE_FLAG_IS_HEADER);
+
+        b.len = 32;
+        ST_Dict_foreach(tag->tags, &b, &write_item);
+        put_header(b.data + b.len, sz, b.count, flags);
+        b.len += 32;
+    }
+
+    /* Write it all out where the old tag was, and chop off anything left over
+       from the old one. */
+    if(fseeko(fp, start, SEEK_SET))
+        goto out_errno;
+
+    if(b.len && fwrite(b.data, 1, b.len, fp) != b.len)
+        goto out_errno;
+
+    if(tlen && fwrite(trail, 1, tlen, fp) != tlen)
+        goto out_errno;
+
+    end = start + (off_t)b.len + (off_t)tlen;
+
+    if(fflush(fp) || (end < t.file_size && ftruncate(fileno(fp), end)))
+        goto out_errno;
+
+    rv = ST_Error_None;
+    goto out;
+
+out_errno:
+    rv = ST_Error_errno;
+out:
+    ST_free(trail);
+    ST_free(b.data);
+    ST_Tail_release(&t);
+    fclose(fp);
+    return rv;
 }
@@ -0,0 +1,251 @@
+/*
+    SonatinaTag
+    Copyright (C) 2026 Lawrence Sebald
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License version 2.1 as published by the Free Software Foundation.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+*/
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+
+#include "SonatinaTag/SonatinaTag.h"
+#include "SonatinaTag/Tags/Frozen.h"
+#include "SonatinaTag/Allocator.h"
+#include "Tag.h"
+#include "../utils/Text.h"
+
+/* The text of the fields follows the structure in the same block, each one
+   NUL terminated. Fields are found by their offset from the start of the
+   block, so that the block can be moved. */
+struct ST_Frozen_struct {
+    ST_Tag base;
+
+    ST_TagType source;
+    uint32_t size;
+    uint32_t text[ST_Field_Count];  /* 0 if the field isn't there */
+
+    int genre;
+    int track;
+    int track_count;
+    int disc;
+    int disc_count;
+    uint64_t duration_ms;
+    int has_picture;
+};
+
+/* The most text kept for any one field. */
+#define FROZEN_MAX_FIELD    (1 << 24)
+
+/* Read a field in full, growing buf as needed. Returns the length of the value
+   (which is put at the start of *buf), or -1 if the tag doesn't have it or
+   there was an error. */
+static long read_field(const ST_Tag *tag, ST_Field field, uint8_t **buf,
+                       size_t *len) {
+    uint8_t *tmp;
+    ST_Error err;
+
+    for(;;) {
+        err = ST_Tag_get(tag, field, *buf, *len);
+
+        if(err != ST_Error_None && err != ST_Error_TooLarge)
+            return -1;
+
+        if(err == ST_Error_None || *len >= FROZEN_MAX_FIELD)
+            return (long)strlen((const char *)*buf);
+
+        if(!(tmp = (uint8_t *)ST_realloc(*buf, *len * 2)))
+            return -1;
+
+        *buf = tmp;
+        *len *= 2;
+    }
+}
+
+ST_FUNC ST_Frozen *ST_Frozen_create(const ST_Tag *tag) {
+    const ST_Frozen *src;
+    ST_Frozen *rv = NULL;
+    uint8_t *field = NULL, *text = NULL, *tmp;
+    size_t field_len = 1024, text_len = 0;
+    uint32_t off[ST_Field_Count];
+    long n;
+    int i;
+
+    if(!tag)
+        return NULL;
+
+    /* Nothing in a frozen tag points anywhere, so it can just be copied. */
+    if(tag->type == ST_TagType_Frozen) {
+        src = (const ST_Frozen *)tag;
+
+        if((rv = (ST_Frozen *)ST_malloc(src->size))) {
+            memcpy(rv, src, src->size);
+            rv->base.arena = NULL;
+        }
+
+        return rv;
+    }
+
+    if(!(field = (uint8_t *)ST_malloc(field_len)))
+        return NULL;
+
+    for(i = 0; i < ST_Field_Count; ++i) {
+        off[i] = 0;
+
+        if((n = read_field(tag, (ST_Field)i, &field, &field_len)) < 0)
+            continue;
+
+        if(text_len + n + 1 > UINT32_MAX - sizeof(ST_Frozen))
+            goto out;
+
+        if(!(tmp = (uint8_t *)ST_realloc(text, text_len + n + 1)))
+            goto out;
+
+        text = tmp;
+        memcpy(text + text_len, field, n + 1);
+        off[i] = (uint32_t)(sizeof(ST_Frozen) + text_len);
+        text_len += n + 1;
+    }
+
+    if(!(rv = (ST_Frozen *)ST_malloc(sizeof(ST_Frozen) + text_len)))
+        goto out;
+
+    memset(rv, 0, sizeof(ST_Frozen));
+    rv->base.type = ST_TagType_Frozen;
+    rv->base.arena = NULL;
+    rv->source = tag->type;
+    rv->size = (uint32_t)(sizeof(ST_Frozen) + text_len);
+    memcpy(rv->text, off, sizeof(off));
+
+    if(text_len)
+        memcpy(rv + 1, text, text_len);
+
+    rv->genre = ST_Tag_normalizedGenre(tag, NULL, 0);
+    rv->track = ST_Tag_track(tag);
+    rv->track_count = ST_Tag_trackCount(tag);
+    rv->disc = ST_Tag_disc(tag);
+    rv->disc_count = ST_Tag_discCount(tag);
+    rv->duration_ms = ST_Tag_durationMs(tag);
+    rv->has_picture = ST_Tag_picture(tag, ST_PictureType_Any, 0) != NULL;
+
+out:
+    ST_free(text);
+    ST_free(field);
+    return rv;
+}
+
+ST_FUNC void ST_Frozen_free(ST_Frozen *tag) {
+    if(!tag || tag->base.type != ST_TagType_Frozen)
+        return;
+
+    if(tag->base.arena) {
+        ST_Arena_free(tag->base.arena);
+        return;
+    }
+
+    ST_free(tag);
+}
+
+ST_FUNC size_t ST_Frozen_size(const ST_Frozen *tag) {
+    if(!tag)
+        return 0;
+
+    return tag->size;
+}
+
+ST_FUNC ST_TagType ST_Frozen_sourceType(const ST_Frozen *tag) {
+    if(!tag)
+        return ST_TagType_Invalid;
+
+    return tag->source;
+}
+
+ST_FUNC int ST_Frozen_hasPicture(const ST_Frozen *tag) {
+    if(!tag)
+        return 0;
+
+    return tag->has_picture;
+}
+
+ST_FUNC ST_Error ST_Frozen_get(const ST_Frozen *tag, ST_Field field,
+                               uint8_t *buf, size_t len) {
+    const uint8_t *text;
+
+    if(!tag || !buf || !len || field < 0 || field >= ST_Field_Count)
+        return ST_Error_InvalidArgument;
+
+    buf[0] = 0;
+
+    if(!tag->text[field])
+        return ST_Error_NotFound;
+
+    text = (const uint8_t *)tag + tag->text[field];
+    return ST_Text_getUTF8(text, strlen((const char *)text),
+                           ST_TextEncoding_UTF8, buf, len);
+}
+
+ST_FUNC int ST_Frozen_normalizedGenre(const ST_Frozen *tag, uint8_t *buf,
+                                      size_t len) {
+    if(!tag) {
+        if(buf && len)
+            buf[0] = 0;
+
+        return ST_Genre_None;
+    }
+
+    if(buf && len)
+        ST_Frozen_get(tag, ST_Field_Genre, buf, len);
+
+    return tag->genre;
+}
+
+ST_FUNC int ST_Frozen_track(const ST_Frozen *tag) {
+    if(!tag)
+        return -1;
+
+    return tag->track;
+}
+
+ST_FUNC int ST_Frozen_disc(const ST_Frozen *tag) {
+    if(!tag)
+        return -1;
+
+    return tag->disc;
+}
+
+ST_FUNC int ST_Frozen_trackCount(const ST_Frozen *tag) {
+    if(!tag)
+        return -1;
+
+    return tag->track_count;
+}
+
+ST_FUNC int ST_Frozen_discCount(const ST_Frozen *tag) {
+    if(!tag)
+        return -1;
+
+    return tag->disc_count;
+}
+
+ST_FUNC uint64_t ST_Frozen_durationMs(const ST_Frozen *tag) {
+    if(!tag)
+        return (uint64_t)-1;
+
+    return tag->duration_ms;
+}
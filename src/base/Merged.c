@@ -0,0 +1,355 @@
+/*
+    SonatinaTag
+    Copyright (C) 2026 Lawrence Sebald
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License version 2.1 as published by the Free Software Foundation.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+*/
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+
+#include "SonatinaTag/SonatinaTag.h"
+#include "SonatinaTag/Tags/Merged.h"
+#include "SonatinaTag/Allocator.h"
+#include "Tag.h"
+#include "../utils/Tail.h"
+
+struct ST_Merged_struct {
+    ST_Tag base;
+
+    ST_Tag *tags[ST_MERGED_MAX_TAGS];
+    int count;
+
+    /* The order to look at the tags in, for each field and for everything
+       else (numbers and pictures). */
+    ST_TagType order[ST_Field_Count][ST_MERGED_MAX_TAGS];
+    int order_len[ST_Field_Count];
+    ST_TagType order_all[ST_MERGED_MAX_TAGS];
+    int order_all_len;
+};
+
+static const ST_TagType default_order[ST_MERGED_MAX_TAGS] = {
+    ST_TagType_ID3v2, ST_TagType_APE, ST_TagType_ID3v1
+};
+
+static ST_Merged *merged_create(void) {
+    ST_Merged *rv = (ST_Merged *)ST_malloc(sizeof(ST_Merged));
+    int i;
+
+    if(rv) {
+        memset(rv, 0, sizeof(ST_Merged));
+        rv->base.type = ST_TagType_Merged;
+
+        for(i = 0; i < ST_Field_Count; ++i) {
+            memcpy(rv->order[i], default_order, sizeof(default_order));
+            rv->order_len[i] = ST_MERGED_MAX_TAGS;
+        }
+
+        memcpy(rv->order_all, default_order, sizeof(default_order));
+        rv->order_all_len = ST_MERGED_MAX_TAGS;
+    }
+
+    return rv;
+}
+
+ST_FUNC ST_Merged *ST_Merged_createFromFile(const char *fn) {
+    ST_Merged *rv;
+    ST_Tag *tag;
+    ST_Tail t;
+    FILE *fp;
+
+    if(!fn)
+        return NULL;
+
+    if(!(fp = fopen(fn, "rb")))
+        return NULL;
+
+    if(!(rv = merged_create()))
+        goto out_close;
+
+    /* Read the start of the file for the ID3v2 tag, then look at the end of it
+       just once for both of the others. */
+    if((tag = (ST_Tag *)ST_ID3v2_createFromStream(fp)))
+        rv->tags[rv->count++] = tag;
+
+    if(!ST_Tail_probe(fp, &t)) {
+        if((tag = (ST_Tag *)ST_APE_createFromTail(fn, fp, &t)))
+            rv->tags[rv->count++] = tag;
+
+        if((tag = (ST_Tag *)ST_ID3v1_createFromTail(&t)))
+            rv->tags[rv->count++] = tag;
+
+        ST_Tail_release(&t);
+    }
+
+    if(!rv->count) {
+        ST_Merged_free(rv);
+        rv = NULL;
+    }
+
+out_close:
+    fclose(fp);
+    return rv;
+}
+
+ST_FUNC void ST_Merged_free(ST_Merged *tag) {
+    int i;
+
+    if(!tag)
+        return;
+
+    if(tag->base.arena) {
+        ST_Arena_free(tag->base.arena);
+        return;
+    }
+
+    for(i = 0; i < tag->count; ++i) {
+        ST_Tag_free(tag->tags[i]);
+    }
+
+    ST_free(tag);
+}
+
+ST_FUNC int ST_Merged_tagCount(const ST_Merged *tag) {
+    if(!tag)
+        return -1;
+
+    return tag->count;
+}
+
+ST_FUNC const ST_Tag *ST_Merged_tag(const ST_Merged *tag, ST_TagType type) {
+    int i;
+
+    if(!tag)
+        return NULL;
+
+    for(i = 0; i < tag->count; ++i) {
+        if(tag->tags[i]->type == type)
+            return tag->tags[i];
+    }
+
+    return NULL;
+}
+
+/* Make sure an order only has types a merged tag can hold, each only once. */
+static int check_order(const ST_TagType *order, int count) {
+    int i, j;
+
+    if(count < 0 || count > ST_MERGED_MAX_TAGS || (count && !order))
+        return -1;
+
+    for(i = 0; i < count; ++i) {
+        if(order[i] != ST_TagType_ID3v2 && order[i] != ST_TagType_APE &&
+           order[i] != ST_TagType_ID3v1)
+            return -1;
+
+        for(j = 0; j < i; ++j) {
+            if(order[j] == order[i])
+                return -1;
+        }
+    }
+
+    return 0;
+}
+
+ST_FUNC ST_Error ST_Merged_setPrecedence(ST_Merged *tag,
+                                         const ST_TagType *order, int count) {
+    int i;
+
+    if(!tag || check_order(order, count))
+        return ST_Error_InvalidArgument;
+
+    for(i = 0; i < ST_Field_Count; ++i) {
+        memcpy(tag->order[i], order, sizeof(ST_TagType) * count);
+        tag->order_len[i] = count;
+    }
+
+    memcpy(tag->order_all, order, sizeof(ST_TagType) * count);
+    tag->order_all_len = count;
+    return ST_Error_None;
+}
+
+ST_FUNC ST_Error ST_Merged_setFieldPrecedence(ST_Merged *tag, ST_Field field,
+                                              const ST_TagType *order,
+                                              int count) {
+    if(!tag || field < 0 || field >= ST_Field_Count ||
+       check_order(order, count))
+        return ST_Error_InvalidArgument;
+
+    memcpy(tag->order[field], order, sizeof(ST_TagType) * count);
+    tag->order_len[field] = count;
+    return ST_Error_None;
+}
+
+/* Look for a field in each tag in turn, returning the type of the one it was
+   found in. Tags where the field is empty are passed over if a later one has
+   something in it. */
+static ST_TagType lookup(const ST_Merged *tag, ST_Field field, uint8_t *buf,
+                         size_t len, ST_Error *err) {
+    ST_TagType empty = ST_TagType_Invalid;
+    const ST_Tag *t;
+    ST_Error e;
+    int i;
+
+    for(i = 0; i < tag->order_len[field]; ++i) {
+        if(!(t = ST_Merged_tag(tag, tag->order[field][i])))
+            continue;
+
+        if((e = ST_Tag_get(t, field, buf, len)) == ST_Error_NotFound)
+            continue;
+
+        if(e != ST_Error_None && e != ST_Error_TooLarge) {
+            *err = e;
+            return ST_TagType_Invalid;
+        }
+
+        if(buf[0]) {
+            *err = e;
+            return t->type;
+        }
+
+        if(empty == ST_TagType_Invalid)
+            empty = t->type;
+    }
+
+    buf[0] = 0;
+    *err = empty != ST_TagType_Invalid ? ST_Error_None : ST_Error_NotFound;
+    return empty;
+}
+
+ST_FUNC ST_TagType ST_Merged_source(const ST_Merged *tag, ST_Field field) {
+    uint8_t probe[8];
+    ST_Error err;
+
+    if(!tag || field < 0 || field >= ST_Field_Count)
+        return ST_TagType_Invalid;
+
+    return lookup(tag, field, probe, sizeof(probe), &err);
+}
+
+ST_FUNC ST_Error ST_Merged_get(const ST_Merged *tag, ST_Field field,
+                               uint8_t *buf, size_t len) {
+    ST_Error err;
+
+    if(!tag || !buf || !len || field < 0 || field >= ST_Field_Count)
+        return ST_Error_InvalidArgument;
+
+    lookup(tag, field, buf, len, &err);
+    return err;
+}
+
+ST_FUNC int ST_Merged_normalizedGenre(const ST_Merged *tag, uint8_t *buf,
+                                      size_t len) {
+    const ST_Tag *t;
+    int i, rv;
+
+    if(tag) {
+        for(i = 0; i < tag->order_len[ST_Field_Genre]; ++i) {
+            if(!(t = ST_Merged_tag(tag, tag->order[ST_Field_Genre][i])))
+                continue;
+
+            if((rv = ST_Tag_normalizedGenre(t, buf, len)) != ST_Genre_None)
+                return rv;
+        }
+    }
+
+    if(buf && len)
+        buf[0] = 0;
+
+    return ST_Genre_None;
+}
+
+/* Take a number from the first tag that has one set. If none of them do, the
+   largest of what they said is returned, so a tag that knows it has no value
+   (0) wins over one that can't hold it at all (-1). */
+static int first_number(const ST_Merged *tag, int (*get)(const ST_Tag *)) {
+    const ST_Tag *t;
+    int i, v, rv = -1;
+
+    if(!tag)
+        return -1;
+
+    for(i = 0; i < tag->order_all_len; ++i) {
+        if(!(t = ST_Merged_tag(tag, tag->order_all[i])))
+            continue;
+
+        if((v = get(t)) > 0)
+            return v;
+        else if(v > rv)
+            rv = v;
+    }
+
+    return rv;
+}
+
+ST_FUNC int ST_Merged_track(const ST_Merged *tag) {
+    return first_number(tag, ST_Tag_track);
+}
+
+ST_FUNC int ST_Merged_disc(const ST_Merged *tag) {
+    return first_number(tag, ST_Tag_disc);
+}
+
+ST_FUNC int ST_Merged_trackCount(const ST_Merged *tag) {
+    return first_number(tag, ST_Tag_trackCount);
+}
+
+ST_FUNC int ST_Merged_discCount(const ST_Merged *tag) {
+    return first_number(tag, ST_Tag_discCount);
+}
+
+ST_FUNC uint64_t ST_Merged_durationMs(const ST_Merged *tag) {
+    const ST_Tag *t;
+    uint64_t v;
+    int i;
+
+    if(!tag)
+        return (uint64_t)-1;
+
+    for(i = 0; i < tag->order_all_len; ++i) {
+        if(!(t = ST_Merged_tag(tag, tag->order_all[i])))
+            continue;
+
+        if((v = ST_Tag_durationMs(t)) && v != (uint64_t)-1)
+            return v;
+    }
+
+    return 0;
+}
+
+ST_FUNC const ST_Picture *ST_Merged_picture(const ST_Merged *tag,
+                                            ST_PictureType pt, int index) {
+    const ST_Picture *rv;
+    const ST_Tag *t;
+    int i;
+
+    if(!tag)
+        return NULL;
+
+    for(i = 0; i < tag->order_all_len; ++i) {
+        if(!(t = ST_Merged_tag(tag, tag->order_all[i])))
+            continue;
+
+        if((rv = ST_Tag_picture(t, pt, index)))
+            return rv;
+    }
+
+    return NULL;
+}
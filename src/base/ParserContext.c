@@ -0,0 +1,117 @@
+/*
+    SonatinaTag
+    Copyright (C) 2026 Lawrence Sebald
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License version 2.1 as published by the Free Software Foundation.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+*/
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "SonatinaTag/SonatinaTag.h"
+#include "SonatinaTag/ParserContext.h"
+#include "SonatinaTag/Allocator.h"
+#include "Tag.h"
+
+/* Big enough for everything but the pictures in just about any file. */
+#define CONTEXT_CHUNK_SIZE      262144
+
+struct ST_ParserContext_struct {
+    ST_Arena *arena;
+    const ST_Tag *tag;
+
+    /* Where the text of ST_ParserContext_record goes. */
+    char text[ST_TagRecord_BufferSize];
+};
+
+ST_FUNC ST_ParserContext *ST_ParserContext_create(size_t chunk_size) {
+    ST_ParserContext *rv;
+
+    if(!(rv = (ST_ParserContext *)ST_malloc(sizeof(ST_ParserContext))))
+        return NULL;
+
+    if(!(rv->arena = ST_Arena_create(chunk_size ? chunk_size :
+                                     CONTEXT_CHUNK_SIZE))) {
+        ST_free(rv);
+        return NULL;
+    }
+
+    rv->tag = NULL;
+    return rv;
+}
+
+ST_FUNC void ST_ParserContext_free(ST_ParserContext *ctx) {
+    if(!ctx)
+        return;
+
+    ST_Arena_free(ctx->arena);
+    ST_free(ctx);
+}
+
+ST_FUNC void ST_ParserContext_reset(ST_ParserContext *ctx) {
+    if(!ctx)
+        return;
+
+    /* Everything the tag owns is in the arena, so there's nothing to walk. */
+    ST_Arena_reset(ctx->arena);
+    ctx->tag = NULL;
+}
+
+ST_FUNC const ST_Tag *ST_ParserContext_parse(ST_ParserContext *ctx,
+                                             const char *fn) {
+    const ST_Allocator *prev;
+
+    if(!ctx || !fn)
+        return NULL;
+
+    ST_ParserContext_reset(ctx);
+
+    prev = ST_useAllocator(ST_Arena_allocator(ctx->arena));
+    ctx->tag = ST_Tag_createFromFile(fn);
+    ST_useAllocator(prev);
+
+    return ctx->tag;
+}
+
+ST_FUNC const ST_Merged *ST_ParserContext_parseMerged(ST_ParserContext *ctx,
+                                                      const char *fn) {
+    const ST_Allocator *prev;
+
+    if(!ctx || !fn)
+        return NULL;
+
+    ST_ParserContext_reset(ctx);
+
+    prev = ST_useAllocator(ST_Arena_allocator(ctx->arena));
+    ctx->tag = (const ST_Tag *)ST_Merged_createFromFile(fn);
+    ST_useAllocator(prev);
+
+    return (const ST_Merged *)ctx->tag;
+}
+
+ST_FUNC ST_Error ST_ParserContext_record(ST_ParserContext *ctx,
+                                         ST_TagRecord *rec) {
+    if(!ctx || !rec)
+        return ST_Error_InvalidArgument;
+
+    if(!ctx->tag)
+        return ST_Error_NotFound;
+
+    return ST_Tag_extractRecord(ctx->tag, rec, ctx->text, sizeof(ctx->text));
+}
@@ -20,7 +20,9 @@
 #include "config.h"
 #endif
 
+#include <stdio.h>
 #include <string.h>
+#include <stdint.h>
 
 #include "SonatinaTag/SonatinaTag.h"
 #include "Tag.h"
@@ -30,6 +32,9 @@
 #include "SonatinaTag/Tags/FLAC.h"
 #include "SonatinaTag/Tags/M4A.h"
 #include "SonatinaTag/Tags/APE.h"
+#include "SonatinaTag/Tags/Merged.h"
+#include "SonatinaTag/Tags/Frozen.h"
+#include "../utils/Tail.h"
 
 ST_FUNC ST_TagType ST_Tag_type(const ST_Tag *tag) {
     if(!tag)
@@ -38,34 +43,160 @@ ST_FUNC ST_TagType ST_Tag_type(const ST_Tag *tag) {
     return tag->type;
 }
 
+/* Kinds of files we know how to find tags in. */
+typedef enum file_kind_e {
+    FILE_Unknown,
+    FILE_MP3,
+    FILE_M4A,
+    FILE_FLAC,
+    FILE_APE
+} file_kind_t;
+
+/* Containers that use APEv2 as their native tag format. */
+static const char *ape_exts[] = {
+    ".ape", ".wv", ".mpc", ".mp+", ".mpp", ".tak", NULL
+};
+
+static file_kind_t kind_from_ext(const char *fn) {
+    const char *ext = strrchr(fn, '.');
+    int i;
+
+    if(!ext)
+        return FILE_Unknown;
+
+    if(!strcasecmp(ext, ".mp3"))
+        return FILE_MP3;
+    else if(!strcasecmp(ext, ".m4a") || !strcasecmp(ext, ".mp4") ||
+            !strcasecmp(ext, ".m4p") || !strcasecmp(ext, ".m4b") ||
+            !strcasecmp(ext, ".m4v") || !strcasecmp(ext, ".m4r") ||
+            !strcasecmp(ext, ".mov"))
+        return FILE_M4A;
+    else if(!strcasecmp(ext, ".flac") || !strcasecmp(ext, ".fla"))
+        return FILE_FLAC;
+
+    for(i = 0; ape_exts[i]; ++i) {
+        if(!strcasecmp(ext, ape_exts[i]))
+            return FILE_APE;
+    }
+
+    return FILE_Unknown;
+}
+
+/* Figure out what kind of file it is from the first few bytes of it, for when
+   the extension doesn't tell us. */
+static file_kind_t kind_from_magic(const char *fn) {
+    FILE *fp;
+    uint8_t buf[12];
+    size_t len;
+
+    if(!(fp = fopen(fn, "rb")))
+        return FILE_Unknown;
+
+    len = fread(buf, 1, 12, fp);
+    fclose(fp);
+
+    if(len < 4)
+        return FILE_Unknown;
+
+    if(!memcmp(buf, "fLaC", 4))
+        return FILE_FLAC;
+    else if(!memcmp(buf, "MAC ", 4) || !memcmp(buf, "wvpk", 4) ||
+            !memcmp(buf, "MPCK", 4) || !memcmp(buf, "MP+", 3) ||
+            !memcmp(buf, "tBaK", 4) ||
+            (len >= 8 && !memcmp(buf, "APETAGEX", 8)))
+        return FILE_APE;
+    else if(len >= 8 && !memcmp(buf + 4, "ftyp", 4))
+        return FILE_M4A;
+    else if(!memcmp(buf, "ID3", 3) ||
+            (buf[0] == 0xFF && (buf[1] & 0xE0) == 0xE0))
+        return FILE_MP3;
+
+    return FILE_Unknown;
+}
+
+/* Read whichever of the tags at the end of the file is preferred, APEv2 over
+   ID3v1, looking at the end of the file only once for both of them. */
+static ST_Tag *tail_tag(const char *fn) {
+    FILE *fp;
+    ST_Tail t;
+    ST_Tag *rv = NULL;
+
+    if(!(fp = fopen(fn, "rb")))
+        return NULL;
+
+    if(!ST_Tail_probe(fp, &t)) {
+        if(!(rv = (ST_Tag *)ST_APE_createFromTail(fn, fp, &t)))
+            rv = (ST_Tag *)ST_ID3v1_createFromTail(&t);
+
+        ST_Tail_release(&t);
+    }
+
+    fclose(fp);
+    return rv;
+}
+
 ST_FUNC ST_Tag *ST_Tag_createFromFile(const char *fn) {
-    char *ext = strrchr(fn, '.');
+    file_kind_t kind;
     ST_Tag *rv;
 
-    if(!ext)
+    if(!fn)
         return NULL;
 
-    /* Prefer ID3v2 over APEv2 and ID3v1 for MP3 files */
-    if(!strcasecmp(ext, ".mp3")) {
-        if((rv = (ST_Tag *)ST_ID3v2_createFromFile(fn))) {
-            return rv;
-        }
+    if((kind = kind_from_ext(fn)) == FILE_Unknown)
+        kind = kind_from_magic(fn);
 
-        if((rv = (ST_Tag *)ST_APE_createFromFile(fn))) {
-            return rv;
-        }
+    switch(kind) {
+        case FILE_MP3:
+            /* Prefer ID3v2 over APEv2 and ID3v1 for MP3 files */
+            if((rv = (ST_Tag *)ST_ID3v2_createFromFile(fn))) {
+                return rv;
+            }
 
-        return (ST_Tag *)ST_ID3v1_createFromFile(fn);
-    }
-    else if(!strcasecmp(ext, ".m4a") || !strcasecmp(ext, ".mp4") ||
-            !strcasecmp(ext, ".m4p")) {
-        return (ST_Tag *)ST_M4A_createFromFile(fn);
+            return tail_tag(fn);
+
+        case FILE_M4A:
+            return (ST_Tag *)ST_M4A_createFromFile(fn);
+
+        case FILE_FLAC:
+            return (ST_Tag *)ST_FLAC_createFromFile(fn);
+
+        case FILE_APE:
+            /* APEv2 is the native format for these, but some tools stick an
+               ID3v1 tag on them instead. */
+            return tail_tag(fn);
+
+        default:
+            return NULL;
     }
-    else if(!strcasecmp(ext, ".flac") || !strcasecmp(ext, ".fla")) {
-        return (ST_Tag *)ST_FLAC_createFromFile(fn);
+}
+
+ST_FUNC ST_Tag *ST_Tag_createFromFileInArena(const char *fn) {
+    const ST_Allocator *prev;
+    ST_Arena *a;
+    ST_Tag *rv;
+
+    if(!fn || !(a = ST_Arena_create(0)))
+        return NULL;
+
+    prev = ST_useAllocator(ST_Arena_allocator(a));
+    rv = ST_Tag_createFromFile(fn);
+    ST_useAllocator(prev);
+
+    if(!rv) {
+        ST_Arena_free(a);
+        return NULL;
     }
 
-    return NULL;
+    rv->arena = a;
+    return rv;
+}
+
+ST_FUNC ST_Error ST_Tag_adoptArena(ST_Tag *tag, ST_Arena *a) {
+    if(!tag || !a || tag->arena)
+        return ST_Error_InvalidArgument;
+
+    tag->arena = a;
+    return ST_Error_None;
 }
 
 ST_FUNC void ST_Tag_free(ST_Tag *tag) {
@@ -88,6 +219,12 @@ ST_FUNC void ST_Tag_free(ST_Tag *tag) {
         case ST_TagType_APE:
             return ST_APE_free((ST_APE *)tag);
 
+        case ST_TagType_Merged:
+            return ST_Merged_free((ST_Merged *)tag);
+
+        case ST_TagType_Frozen:
+            return ST_Frozen_free((ST_Frozen *)tag);
+
         default:
             return;
     }
@@ -113,6 +250,12 @@ ST_FUNC int ST_Tag_track(const ST_Tag *tag) {
         case ST_TagType_APE:
             return ST_APE_track((const ST_APE *)tag);
 
+        case ST_TagType_Merged:
+            return ST_Merged_track((const ST_Merged *)tag);
+
+        case ST_TagType_Frozen:
+            return ST_Frozen_track((const ST_Frozen *)tag);
+
         default:
             return -1;
     }
@@ -139,11 +282,107 @@ ST_FUNC int ST_Tag_disc(const ST_Tag *tag) {
         case ST_TagType_APE:
             return ST_APE_disc((const ST_APE *)tag);
 
+        case ST_TagType_Merged:
+            return ST_Merged_disc((const ST_Merged *)tag);
+
+        case ST_TagType_Frozen:
+            return ST_Frozen_disc((const ST_Frozen *)tag);
+
+        default:
+            return -1;
+    }
+}
+
+ST_FUNC int ST_Tag_trackCount(const ST_Tag *tag) {
+    if(!tag)
+        return -1;
+
+    switch(tag->type) {
+        case ST_TagType_ID3v1:
+            /* ID3v1 doesn't support a track total. */
+            return -1;
+
+        case ST_TagType_ID3v2:
+            return ST_ID3v2_trackCount((const ST_ID3v2 *)tag);
+
+        case ST_TagType_FLAC:
+            return ST_FLAC_trackCount((const ST_FLAC *)tag);
+
+        case ST_TagType_M4A:
+            return ST_M4A_trackCount((const ST_M4A *)tag);
+
+        case ST_TagType_APE:
+            return ST_APE_trackCount((const ST_APE *)tag);
+
+        case ST_TagType_Merged:
+            return ST_Merged_trackCount((const ST_Merged *)tag);
+
+        case ST_TagType_Frozen:
+            return ST_Frozen_trackCount((const ST_Frozen *)tag);
+
+        default:
+            return -1;
+    }
+}
+
+ST_FUNC int ST_Tag_discCount(const ST_Tag *tag) {
+    if(!tag)
+        return -1;
+
+    switch(tag->type) {
+        case ST_TagType_ID3v1:
+            /* ID3v1 doesn't support a disc number attribute. */
+            return -1;
+
+        case ST_TagType_ID3v2:
+            return ST_ID3v2_discCount((const ST_ID3v2 *)tag);
+
+        case ST_TagType_FLAC:
+            return ST_FLAC_discCount((const ST_FLAC *)tag);
+
+        case ST_TagType_M4A:
+            return ST_M4A_discCount((const ST_M4A *)tag);
+
+        case ST_TagType_APE:
+            return ST_APE_discCount((const ST_APE *)tag);
+
+        case ST_TagType_Merged:
+            return ST_Merged_discCount((const ST_Merged *)tag);
+
+        case ST_TagType_Frozen:
+            return ST_Frozen_discCount((const ST_Frozen *)tag);
+
         default:
             return -1;
     }
 }
 
+ST_FUNC uint64_t ST_Tag_durationMs(const ST_Tag *tag) {
+    if(!tag)
+        return (uint64_t)-1;
+
+    switch(tag->type) {
+        case ST_TagType_ID3v2:
+            return ST_ID3v2_durationMs((const ST_ID3v2 *)tag);
+
+        case ST_TagType_FLAC:
+            return ST_FLAC_durationMs((const ST_FLAC *)tag);
+
+        case ST_TagType_M4A:
+            return ST_M4A_durationMs((const ST_M4A *)tag);
+
+        case ST_TagType_Merged:
+            return ST_Merged_durationMs((const ST_Merged *)tag);
+
+        case ST_TagType_Frozen:
+            return ST_Frozen_durationMs((const ST_Frozen *)tag);
+
+        default:
+            /* The rest of them don't know anything about the audio. */
+            return 0;
+    }
+}
+
 ST_FUNC const ST_Picture *ST_Tag_picture(const ST_Tag *tag, ST_PictureType pt,
                                          int index) {
     if(!tag)
@@ -165,7 +404,13 @@ ST_FUNC const ST_Picture *ST_Tag_picture(const ST_Tag *tag, ST_PictureType pt,
             return ST_M4A_picture((const ST_M4A *)tag, index);
 
         case ST_TagType_APE:
-            /* We don't support pictures in APE tags yet... */
+            return ST_APE_picture((const ST_APE *)tag, pt, index);
+
+        case ST_TagType_Merged:
+            return ST_Merged_picture((const ST_Merged *)tag, pt, index);
+
+        case ST_TagType_Frozen:
+            /* Pictures aren't kept when a tag is frozen. */
             return NULL;
 
         default:
@@ -173,10 +418,250 @@ ST_FUNC const ST_Picture *ST_Tag_picture(const ST_Tag *tag, ST_PictureType pt,
     }
 }
 
+ST_FUNC int ST_Tag_normalizedGenre(const ST_Tag *tag, uint8_t *buf,
+                                   size_t len) {
+    if(!tag) {
+        if(buf && len)
+            buf[0] = 0;
+
+        return ST_Genre_None;
+    }
+
+    switch(tag->type) {
+        case ST_TagType_ID3v1:
+            return ST_ID3v1_normalizedGenre((const ST_ID3v1 *)tag, buf, len);
+
+        case ST_TagType_ID3v2:
+            return ST_ID3v2_normalizedGenre((const ST_ID3v2 *)tag, buf, len);
+
+        case ST_TagType_FLAC:
+            return ST_FLAC_normalizedGenre((const ST_FLAC *)tag, buf, len);
+
+        case ST_TagType_M4A:
+            return ST_M4A_normalizedGenre((const ST_M4A *)tag, buf, len);
+
+        case ST_TagType_APE:
+            return ST_APE_normalizedGenre((const ST_APE *)tag, buf, len);
+
+        case ST_TagType_Merged:
+            return ST_Merged_normalizedGenre((const ST_Merged *)tag, buf,
+                                             len);
+
+        case ST_TagType_Frozen:
+            return ST_Frozen_normalizedGenre((const ST_Frozen *)tag, buf,
+                                             len);
+
+        default:
+            if(buf && len)
+                buf[0] = 0;
+
+            return ST_Genre_None;
+    }
+}
+
+ST_LOCAL ST_Error ST_Tag_getGenre(const ST_Tag *tag, uint8_t *buf, size_t len) {
+    uint8_t *tmp;
+    size_t n;
+    ST_Error rv = ST_Error_None;
+
+    if(ST_Tag_normalizedGenre(tag, buf, len) == ST_Genre_None)
+        return ST_Error_NotFound;
+
+    /* The genre only comes back as text, so the way to tell if it was cut short
+       is to see if there's more of it when there's more room. That can only
+       be the case if it came within a character of filling up buf. */
+    n = strlen((const char *)buf);
+
+    if(n + 4 < len)
+        return ST_Error_None;
+
+    if(!(tmp = (uint8_t *)ST_malloc(len + 4)))
+        return ST_Error_errno;
+
+    ST_Tag_normalizedGenre(tag, tmp, len + 4);
+
+    if(strlen((const char *)tmp) > n)
+        rv = ST_Error_TooLarge;
+
+    ST_free(tmp);
+    return rv;
+}
+
+ST_FUNC ST_Error ST_Tag_get(const ST_Tag *tag, ST_Field field, uint8_t *buf,
+                            size_t len) {
+    if(!tag)
+        return ST_Error_InvalidArgument;
+
+    switch(tag->type) {
+        case ST_TagType_ID3v1:
+            return ST_ID3v1_get((const ST_ID3v1 *)tag, field, buf, len);
+
+        case ST_TagType_ID3v2:
+            return ST_ID3v2_get((const ST_ID3v2 *)tag, field, buf, len);
+
+        case ST_TagType_FLAC:
+            return ST_FLAC_get((const ST_FLAC *)tag, field, buf, len);
+
+        case ST_TagType_M4A:
+            return ST_M4A_get((const ST_M4A *)tag, field, buf, len);
+
+        case ST_TagType_APE:
+            return ST_APE_get((const ST_APE *)tag, field, buf, len);
+
+        case ST_TagType_Merged:
+            return ST_Merged_get((const ST_Merged *)tag, field, buf, len);
+
+        case ST_TagType_Frozen:
+            return ST_Frozen_get((const ST_Frozen *)tag, field, buf, len);
+
+        default:
+            return ST_Error_InvalidArgument;
+    }
+}
+
+ST_FUNC ST_Tag *ST_Tag_freeze(const ST_Tag *tag) {
+    return (ST_Tag *)ST_Frozen_create(tag);
+}
+
+/* Numbers of 0 and below all mean the same thing in a record. */
+static int record_number(int v) {
+    return (v > 0) ? v : 0;
+}
+
+ST_FUNC ST_Error ST_Tag_extractRecord(const ST_Tag *tag, ST_TagRecord *rec,
+                                      char *buf, size_t len) {
+    uint8_t *pos = (uint8_t *)buf, probe[8];
+    size_t left = buf ? len : 0, n;
+    ST_Error err;
+    int i;
+
+    if(!tag || !rec)
+        return ST_Error_InvalidArgument;
+
+    memset(rec, 0, sizeof(ST_TagRecord));
+    rec->type = tag->type;
+
+    for(i = 0; i < ST_Field_Count; ++i) {
+        /* The genre's ID goes in the record along with its text. */
+        if(i == ST_Field_Genre)
+            rec->genre = ST_Tag_normalizedGenre(tag, NULL, 0);
+
+        if(left > 1)
+            err = ST_Tag_get(tag, (ST_Field)i, pos, left);
+        else
+            err = ST_Tag_get(tag, (ST_Field)i, probe, sizeof(probe));
+
+        if(err != ST_Error_None && err != ST_Error_TooLarge)
+            continue;
+
+        /* If there's no room left at all, just make note of it. */
+        if(left < 2) {
+            rec->truncated = 1;
+            continue;
+        }
+
+        if(err == ST_Error_TooLarge)
+            rec->truncated = 1;
+
+        n = strlen((const char *)pos);
+        rec->text[i] = (const char *)pos;
+        pos += n + 1;
+        left -= n + 1;
+    }
+
+    rec->track = record_number(ST_Tag_track(tag));
+    rec->track_count = record_number(ST_Tag_trackCount(tag));
+    rec->disc = record_number(ST_Tag_disc(tag));
+    rec->disc_count = record_number(ST_Tag_discCount(tag));
+    rec->duration_ms = ST_Tag_durationMs(tag);
+
+    if(tag->type == ST_TagType_Frozen)
+        rec->has_picture = ST_Frozen_hasPicture((const ST_Frozen *)tag);
+    else
+        rec->has_picture = ST_Tag_picture(tag, ST_PictureType_Any, 0) != NULL;
+
+    return ST_Error_None;
+}
+
 #ifdef ST_HAVE_COREFOUNDATION
+/* Keys for the fields in the dictionaries of merged and frozen tags. */
+static const char *field_keys[ST_Field_Count] = {
+    "title", "artist", "album", "albumartist", "comment", "date", "genre",
+    "composer", "replaygain_track_gain", "replaygain_track_peak",
+    "replaygain_album_gain", "replaygain_album_peak", "musicbrainz_trackid",
+    "musicbrainz_albumid", "musicbrainz_artistid",
+    "musicbrainz_albumartistid", "musicbrainz_releasegroupid"
+};
+
+/* Make a string out of a field with ST_Tag_get, for the tags that don't have
+   their own functions for it (merged and frozen tags). */
+static CFStringRef copy_field(const ST_Tag *tag, ST_Field field,
+                              ST_Error *err) {
+    uint8_t *buf = NULL, *tmp;
+    size_t len = 256;
+    CFStringRef rv = NULL;
+    ST_Error e;
+
+    for(;;) {
+        if(!(tmp = (uint8_t *)ST_realloc(buf, len))) {
+            e = ST_Error_errno;
+            goto out;
+        }
+
+        buf = tmp;
+
+        if((e = ST_Tag_get(tag, field, buf, len)) != ST_Error_TooLarge)
+            break;
+
+        len *= 2;
+    }
+
+    if(e == ST_Error_None)
+        rv = CFStringCreateWithCString(kCFAllocatorDefault, (const char *)buf,
+                                       kCFStringEncodingUTF8);
+
+out:
+    ST_free(buf);
+
+    if(err)
+        *err = e;
+
+    return rv;
+}
+
+static CFDictionaryRef copy_fields(const ST_Tag *tag) {
+    CFMutableDictionaryRef rv;
+    CFStringRef key, tmp;
+    int i;
+
+    if(!(rv = CFDictionaryCreateMutable(kCFAllocatorDefault, 0,
+                                        &kCFTypeDictionaryKeyCallBacks,
+                                        &kCFTypeDictionaryValueCallBacks)))
+        return NULL;
+
+    for(i = 0; i < ST_Field_Count; ++i) {
+        if(!(tmp = copy_field(tag, (ST_Field)i, NULL)))
+            continue;
+
+        if((key = CFStringCreateWithCString(kCFAllocatorDefault, field_keys[i],
+                                            kCFStringEncodingUTF8))) {
+            CFDictionaryAddValue(rv, key, tmp);
+            CFRelease(key);
+        }
+
+        CFRelease(tmp);
+    }
+
+    return rv;
+}
+
 ST_FUNC CFStringRef ST_Tag_copyTitle(const ST_Tag *tag, ST_Error *err) {
-    if(!tag)
+    if(!tag) {
+        if(err)
+            *err = ST_Error_InvalidArgument;
+
         return NULL;
+    }
 
     switch(tag->type) {
         case ST_TagType_ID3v1:
@@ -194,14 +679,25 @@ ST_FUNC CFStringRef ST_Tag_copyTitle(const ST_Tag *tag, ST_Error *err) {
         case ST_TagType_APE:
             return ST_APE_copyTitle((const ST_APE *)tag, err);
 
+        case ST_TagType_Merged:
+        case ST_TagType_Frozen:
+            return copy_field(tag, ST_Field_Title, err);
+
         default:
+            if(err)
+                *err = ST_Error_InvalidArgument;
+
             return NULL;
     }
 }
 
 ST_FUNC CFStringRef ST_Tag_copyArtist(const ST_Tag *tag, ST_Error *err) {
-    if(!tag)
+    if(!tag) {
+        if(err)
+            *err = ST_Error_InvalidArgument;
+
         return NULL;
+    }
 
     switch(tag->type) {
         case ST_TagType_ID3v1:
@@ -219,14 +715,25 @@ ST_FUNC CFStringRef ST_Tag_copyArtist(const ST_Tag *tag, ST_Error *err) {
         case ST_TagType_APE:
             return ST_APE_copyArtist((const ST_APE *)tag, err);
 
+        case ST_TagType_Merged:
+        case ST_TagType_Frozen:
+            return copy_field(tag, ST_Field_Artist, err);
+
         default:
+            if(err)
+                *err = ST_Error_InvalidArgument;
+
             return NULL;
     }
 }
 
 ST_FUNC CFStringRef ST_Tag_copyAlbum(const ST_Tag *tag, ST_Error *err) {
-    if(!tag)
+    if(!tag) {
+        if(err)
+            *err = ST_Error_InvalidArgument;
+
         return NULL;
+    }
 
     switch(tag->type) {
         case ST_TagType_ID3v1:
@@ -244,14 +751,25 @@ ST_FUNC CFStringRef ST_Tag_copyAlbum(const ST_Tag *tag, ST_Error *err) {
         case ST_TagType_APE:
             return ST_APE_copyAlbum((const ST_APE *)tag, err);
 
+        case ST_TagType_Merged:
+        case ST_TagType_Frozen:
+            return copy_field(tag, ST_Field_Album, err);
+
         default:
+            if(err)
+                *err = ST_Error_InvalidArgument;
+
             return NULL;
     }
 }
 
 ST_FUNC CFStringRef ST_Tag_copyComment(const ST_Tag *tag, ST_Error *err) {
-    if(!tag)
+    if(!tag) {
+        if(err)
+            *err = ST_Error_InvalidArgument;
+
         return NULL;
+    }
 
     switch(tag->type) {
         case ST_TagType_ID3v1:
@@ -269,14 +787,25 @@ ST_FUNC CFStringRef ST_Tag_copyComment(const ST_Tag *tag, ST_Error *err) {
         case ST_TagType_APE:
             return ST_APE_copyComment((const ST_APE *)tag, err);
 
+        case ST_TagType_Merged:
+        case ST_TagType_Frozen:
+            return copy_field(tag, ST_Field_Comment, err);
+
         default:
+            if(err)
+                *err = ST_Error_InvalidArgument;
+
             return NULL;
     }
 }
 
 ST_FUNC CFStringRef ST_Tag_copyDate(const ST_Tag *tag, ST_Error *err) {
-    if(!tag)
+    if(!tag) {
+        if(err)
+            *err = ST_Error_InvalidArgument;
+
         return NULL;
+    }
 
     switch(tag->type) {
         case ST_TagType_ID3v1:
@@ -294,7 +823,14 @@ ST_FUNC CFStringRef ST_Tag_copyDate(const ST_Tag *tag, ST_Error *err) {
         case ST_TagType_APE:
             return ST_APE_copyDate((const ST_APE *)tag, err);
 
+        case ST_TagType_Merged:
+        case ST_TagType_Frozen:
+            return copy_field(tag, ST_Field_Date, err);
+
         default:
+            if(err)
+                *err = ST_Error_InvalidArgument;
+
             return NULL;
     }
 }
@@ -302,8 +838,12 @@ ST_FUNC CFStringRef ST_Tag_copyDate(const ST_Tag *tag, ST_Error *err) {
 ST_FUNC CFStringRef ST_Tag_copyGenre(const ST_Tag *tag, ST_Error *err) {
     ST_ID3v1_GenreCode g;
 
-    if(!tag)
+    if(!tag) {
+        if(err)
+            *err = ST_Error_InvalidArgument;
+
         return NULL;
+    }
 
     switch(tag->type) {
         case ST_TagType_ID3v1:
@@ -322,7 +862,14 @@ ST_FUNC CFStringRef ST_Tag_copyGenre(const ST_Tag *tag, ST_Error *err) {
         case ST_TagType_APE:
             return ST_APE_copyGenre((const ST_APE *)tag, err);
 
+        case ST_TagType_Merged:
+        case ST_TagType_Frozen:
+            return copy_field(tag, ST_Field_Genre, err);
+
         default:
+            if(err)
+                *err = ST_Error_InvalidArgument;
+
             return NULL;
     }
 }
@@ -347,6 +894,10 @@ ST_FUNC CFDictionaryRef ST_Tag_copyDictionary(const ST_Tag *tag) {
         case ST_TagType_APE:
             return ST_APE_copyDictionary((const ST_APE *)tag);
 
+        case ST_TagType_Merged:
+        case ST_TagType_Frozen:
+            return copy_fields(tag);
+
         default:
             return NULL;
     }
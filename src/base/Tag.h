@@ -19,16 +19,33 @@
 #ifndef ST_INTERNAL__base__Tag_h
 #define ST_INTERNAL__base__Tag_h
 
+#include <stdio.h>
+
 #include "SonatinaTag/cdefs.h"
 
 ST_BEGIN_DECLS
 
 #include "SonatinaTag/basedefs.h"
+#include "SonatinaTag/Allocator.h"
+#include "SonatinaTag/Tags/ID3v2.h"
 
 struct ST_Tag_struct {
     ST_TagType type;
+
+    /* The arena the tag lives in, if it was made in one. Freeing the tag just
+       frees the arena. */
+    ST_Arena *arena;
 };
 
+/* Read an ID3v2 tag from the start of a file that is already open, leaving it
+   open afterwards. Returns NULL if there isn't one. */
+ST_LOCAL ST_ID3v2 *ST_ID3v2_createFromStream(FILE *fp);
+
+/* Get the normalized genre of a tag as text, for the field getters. Returns
+   ST_Error_NotFound if there isn't one, or ST_Error_TooLarge if it had to be
+   cut short to fit in buf. */
+ST_LOCAL ST_Error ST_Tag_getGenre(const ST_Tag *tag, uint8_t *buf, size_t len);
+
 ST_END_DECLS
 
 #endif /* !ST_INTERNAL__base__Tag_h */
@@ -0,0 +1,241 @@
+/*
+    SonatinaTag
+    Copyright (C) 2026 Lawrence Sebald
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License version 2.1 as published by the Free Software Foundation.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+*/
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <sys/types.h>
+
+#include "SonatinaTag/Allocator.h"
+#include "FLACFrames.h"
+#include "../utils/Tail.h"
+
+/* How much of the file to read in at once while checking frames. */
+#define VERIFY_BUFSZ            65536
+
+/* The longest a frame header can be: 4 fixed bytes, up to 7 bytes of coded
+   sample/frame number, up to 2 bytes each of block size and sample rate, and
+   the CRC-8. */
+#define MAX_HEADER_LEN          16
+
+/* CRC-8 (polynomial 0x07) for the frame headers, and CRC-16 (polynomial 0x8005)
+   for the frames themselves. The CRC-16 is done eight bytes at a time using the
+   slicing-by-8 method. */
+#include "FLACCrc.h"
+
+static uint8_t crc8(const uint8_t *buf, size_t len) {
+    uint8_t crc = 0;
+
+    while(len--) {
+        crc = crc8_table[crc ^ *buf++];
+    }
+
+    return crc;
+}
+
+static uint16_t crc16(uint16_t crc, const uint8_t *buf, size_t len) {
+    while(len >= 8) {
+        crc = crc16_table[7][buf[0] ^ (crc >> 8)] ^
+            crc16_table[6][buf[1] ^ (crc & 0xFF)] ^
+            crc16_table[5][buf[2]] ^ crc16_table[4][buf[3]] ^
+            crc16_table[3][buf[4]] ^ crc16_table[2][buf[5]] ^
+            crc16_table[1][buf[6]] ^ crc16_table[0][buf[7]];
+        buf += 8;
+        len -= 8;
+    }
+
+    while(len--) {
+        crc = (uint16_t)((crc << 8) ^ crc16_table[0][(crc >> 8) ^ *buf++]);
+    }
+
+    return crc;
+}
+
+/* See if the bytes at buf look like a valid frame header with a matching
+   CRC-8. Returns the length of the header if so, or 0 if not. */
+static size_t check_header(const uint8_t *buf, size_t avail) {
+    size_t len = 4;
+    int bs, sr, i, n;
+
+    if(avail < 6 || buf[0] != 0xFF || (buf[1] & 0xFE) != 0xF8)
+        return 0;
+
+    bs = buf[2] >> 4;
+    sr = buf[2] & 0x0F;
+
+    /* Weed out the reserved/invalid values. */
+    if(bs == 0 || sr == 15 || (buf[3] >> 4) > 10 ||
+       ((buf[3] >> 1) & 0x07) == 3 || (buf[3] & 0x01))
+        return 0;
+
+    /* Figure out the length of the UTF-8 style coded frame/sample number. */
+    if(!(buf[4] & 0x80))
+        n = 1;
+    else if((buf[4] & 0xE0) == 0xC0)
+        n = 2;
+    else if((buf[4] & 0xF0) == 0xE0)
+        n = 3;
+    else if((buf[4] & 0xF8) == 0xF0)
+        n = 4;
+    else if((buf[4] & 0xFC) == 0xF8)
+        n = 5;
+    else if((buf[4] & 0xFE) == 0xFC)
+        n = 6;
+    else if(buf[4] == 0xFE)
+        n = 7;
+    else
+        return 0;
+
+    if(avail < len + n)
+        return 0;
+
+    for(i = 1; i < n; ++i) {
+        if((buf[len + i] & 0xC0) != 0x80)
+            return 0;
+    }
+
+    len += n;
+
+    /* Uncommon block sizes and sample rates are stored after the number. */
+    if(bs == 6)
+        len += 1;
+    else if(bs == 7)
+        len += 2;
+
+    if(sr == 12)
+        len += 1;
+    else if(sr == 13 || sr == 14)
+        len += 2;
+
+    if(avail < len + 1 || crc8(buf, len) != buf[len])
+        return 0;
+
+    return len + 1;
+}
+
+/* Figure out where the audio data ends, leaving off any ID3v1 or APEv2 tag (or
+   anything else) that might be stuck on the end of the file. */
+static uint64_t audio_end(FILE *fp) {
+    ST_Tail t;
+
+    if(ST_Tail_probe(fp, &t))
+        return 0;
+
+    ST_Tail_release(&t);
+    return (uint64_t)t.audio_end;
+}
+
+ST_LOCAL uint64_t ST_FLAC_verifyFrames(FILE *fp, uint64_t start) {
+    uint8_t *buf, *q;
+    size_t pos = 0, len = 0, rd;
+    uint64_t off = start, end, frame = start, suspect = 0, left;
+    uint16_t crc = 0;
+
+    if(!(end = audio_end(fp)) || end <= start)
+        return start;
+
+    if(fseeko(fp, (off_t)start, SEEK_SET))
+        return start;
+
+    if(!(buf = (uint8_t *)ST_malloc(VERIFY_BUFSZ)))
+        return start;
+
+    left = end - start;
+
+    for(;;) {
+        /* Make sure there's enough in the buffer to look at a whole header. */
+        if(len - pos < MAX_HEADER_LEN && left) {
+            memmove(buf, buf + pos, len - pos);
+            off += pos;
+            len -= pos;
+            pos = 0;
+
+            rd = VERIFY_BUFSZ - len;
+            if(rd > left)
+                rd = (size_t)left;
+
+            if(fread(buf + len, 1, rd, fp) != rd)
+                break;
+
+            len += rd;
+            left -= rd;
+        }
+
+        /* At the end of the audio, the last frame must have checked out. */
+        if(pos == len) {
+            if(crc)
+                break;
+
+            ST_free(buf);
+            return 0;
+        }
+
+        /* The first frame has to start right at the beginning. */
+        if(off + pos == start) {
+            if(!check_header(buf, len))
+                break;
+
+            crc = crc16(0, buf, 1);
+            pos = 1;
+            continue;
+        }
+
+        /* Every byte up to the next possible sync code belongs to the current
+           frame, so run them all through the CRC in one go. */
+        if(!(q = (uint8_t *)memchr(buf + pos, 0xFF, len - pos))) {
+            crc = crc16(crc, buf + pos, len - pos);
+            pos = len;
+            continue;
+        }
+
+        crc = crc16(crc, buf + pos, (size_t)(q - (buf + pos)));
+        pos = (size_t)(q - buf);
+
+        /* Read more in first if the header could run off the end of the
+           buffer. */
+        if(len - pos < MAX_HEADER_LEN && left)
+            continue;
+
+        /* If the CRC-16 of everything since the start of the frame comes out to
+           zero and a valid header follows, then the frame ended here. If the
+           header isn't valid, this is probably the start of a frame with a
+           broken header, which is the one to blame if nothing after it checks
+           out. A zero CRC can also just happen by chance in the middle of a
+           frame, so a later frame that checks out clears this. */
+        if(!crc) {
+            if(check_header(buf + pos, len - pos)) {
+                frame = off + pos;
+                suspect = 0;
+            }
+            else if(!suspect) {
+                suspect = off + pos;
+            }
+        }
+
+        crc = crc16(crc, buf + pos, 1);
+        ++pos;
+    }
+
+    ST_free(buf);
+    return suspect ? suspect : frame;
+}
@@ -0,0 +1,37 @@
+/*
+    SonatinaTag
+    Copyright (C) 2026 Lawrence Sebald
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License version 2.1 as published by the Free Software Foundation.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+*/
+
+#ifndef ST_INTERNAL__flac__FLACFrames_h
+#define ST_INTERNAL__flac__FLACFrames_h
+
+#include <stdio.h>
+#include <stdint.h>
+
+#include "SonatinaTag/cdefs.h"
+
+ST_BEGIN_DECLS
+
+/* Walk the audio frames of a FLAC file, starting at the given offset (the
+   first byte after the last metadata block), checking the CRC-8 of each frame
+   header and the CRC-16 of each frame. Returns 0 if every frame checked out, or
+   the offset of the first bad (or truncated) frame otherwise. */
+ST_LOCAL uint64_t ST_FLAC_verifyFrames(FILE *fp, uint64_t start);
+
+ST_END_DECLS
+
+#endif /* !ST_INTERNAL__flac__FLACFrames_h */
@@ -28,13 +28,68 @@
 
 #include "SonatinaTag/SonatinaTag.h"
 #include "SonatinaTag/Tags/FLAC.h"
+#include "SonatinaTag/Allocator.h"
 #include "../base/Tag.h"
+#include "../utils/Text.h"
+#include "FLACFrames.h"
+
+typedef struct flac_block_s {
+    uint64_t offset;
+    uint32_t length;
+    uint8_t type;
+    uint8_t last;
+} flac_block_t;
+
+struct ST_FLAC_BlockTable_struct {
+    int count;
+    flac_block_t *blocks;
+};
+
+/* Well-known Vorbis comment keys. These get resolved once when the comments
+   are parsed (or modified), so that the common getters don't have to go through
+   the dictionary every time. */
+typedef enum vc_field_e {
+    VC_Title = 0,
+    VC_Artist,
+    VC_Album,
+    VC_AlbumArtist,
+    VC_Comment,
+    VC_Date,
+    VC_Genre,
+    VC_Composer,
+    VC_TrackNumber,
+    VC_TrackTotal,
+    VC_DiscNumber,
+    VC_DiscTotal,
+    VC_RGTrackGain,
+    VC_RGTrackPeak,
+    VC_RGAlbumGain,
+    VC_RGAlbumPeak,
+    VC_MBTrackID,
+    VC_MBAlbumID,
+    VC_MBArtistID,
+    VC_MBAlbumArtistID,
+    VC_MBReleaseGroupID,
+    VC_MBWorkID,
+    VC_MBDiscID,
+    VC_FieldCount
+} vc_field_t;
 
 struct ST_FLAC_struct {
     ST_Tag base;
     ST_Dict *vorbisComments;
     ST_Picture **pictures;
     int npictures;
+    ST_FLAC_BlockTable blocks;
+    uint64_t bad_frame;
+
+    /* Audio properties, from the STREAMINFO block. */
+    uint32_t sample_rate;
+    uint64_t total_samples;
+
+    /* First value of each well-known key. These point at comments owned by the
+       vorbisComments dictionary. */
+    const ST_FLAC_vcomment *fields[VC_FieldCount];
 };
 
 struct ST_FLAC_vcomment_struct {
@@ -43,6 +98,8 @@ struct ST_FLAC_vcomment_struct {
 };
 
 /* FLAC metadata types that we're concerned with. */
+#define METADATA_TYPE_STREAMINFO        0
+#define METADATA_TYPE_PADDING           1
 #define METADATA_TYPE_VORBIS_COMMENT    4
 #define METADATA_TYPE_PICTURE           6
 
@@ -56,25 +113,154 @@ struct ST_FLAC_vcomment_struct {
 static int parse_comments(ST_FLAC *tag, uint8_t *buf, uint32_t length);
 static int parse_picture(ST_FLAC *tag, uint8_t *bytes, uint32_t len);
 
+#define MATCH(str, id) if(!memcmp(key, str, len)) return id
+
+/* Map a (lowercase) Vorbis comment key to one of the well-known fields, or -1
+   if it isn't one of them. */
+static int field_id(const char *key, size_t len) {
+    switch(len) {
+        case 4:
+            MATCH("date", VC_Date);
+            break;
+
+        case 5:
+            MATCH("title", VC_Title);
+            MATCH("album", VC_Album);
+            MATCH("genre", VC_Genre);
+            break;
+
+        case 6:
+            MATCH("artist", VC_Artist);
+            break;
+
+        case 7:
+            MATCH("comment", VC_Comment);
+            break;
+
+        case 8:
+            MATCH("composer", VC_Composer);
+            break;
+
+        case 9:
+            MATCH("disctotal", VC_DiscTotal);
+            break;
+
+        case 10:
+            MATCH("tracktotal", VC_TrackTotal);
+            MATCH("discnumber", VC_DiscNumber);
+            break;
+
+        case 11:
+            MATCH("tracknumber", VC_TrackNumber);
+            MATCH("albumartist", VC_AlbumArtist);
+            break;
+
+        case 18:
+            MATCH("musicbrainz_workid", VC_MBWorkID);
+            MATCH("musicbrainz_discid", VC_MBDiscID);
+            break;
+
+        case 19:
+            MATCH("musicbrainz_trackid", VC_MBTrackID);
+            MATCH("musicbrainz_albumid", VC_MBAlbumID);
+            break;
+
+        case 20:
+            MATCH("musicbrainz_artistid", VC_MBArtistID);
+            break;
+
+        case 21:
+            if(memcmp(key, "replaygain_", 11))
+                break;
+
+            MATCH("replaygain_track_gain", VC_RGTrackGain);
+            MATCH("replaygain_track_peak", VC_RGTrackPeak);
+            MATCH("replaygain_album_gain", VC_RGAlbumGain);
+            MATCH("replaygain_album_peak", VC_RGAlbumPeak);
+            break;
+
+        case 25:
+            MATCH("musicbrainz_albumartistid", VC_MBAlbumArtistID);
+            break;
+
+        case 26:
+            MATCH("musicbrainz_releasegroupid", VC_MBReleaseGroupID);
+            break;
+    }
+
+    return -1;
+}
+
+#undef MATCH
+
+/* The well-known field that each of the ST_Field values comes from. */
+static const int vc_fields[ST_Field_Count] = {
+    VC_Title, VC_Artist, VC_Album, VC_AlbumArtist, VC_Comment, VC_Date,
+    VC_Genre, VC_Composer, VC_RGTrackGain, VC_RGTrackPeak, VC_RGAlbumGain,
+    VC_RGAlbumPeak, VC_MBTrackID, VC_MBAlbumID, VC_MBArtistID,
+    VC_MBAlbumArtistID, VC_MBReleaseGroupID
+};
+
+/* Re-resolve the cached value of a well-known key after the dictionary entry
+   for it has been changed. */
+static void update_field(ST_FLAC *tag, const char *key) {
+    int id = field_id(key, strlen(key));
+    const void **value;
+    int count;
+
+    if(id < 0)
+        return;
+
+    if((value = ST_Dict_find(tag->vorbisComments, key, &count)) && count)
+        tag->fields[id] = (const ST_FLAC_vcomment *)value[0];
+    else
+        tag->fields[id] = NULL;
+}
+
+static ST_Error field_value(const ST_FLAC *tag, int id, uint8_t *buf,
+                            size_t len) {
+    const ST_FLAC_vcomment *val;
+
+    if(!tag || tag->base.type != ST_TagType_FLAC)
+        return ST_Error_InvalidArgument;
+
+    if(!(val = tag->fields[id]))
+        return ST_Error_NotFound;
+
+    memset(buf, 0, len);
+    memcpy(buf, val->data, MIN(len, val->length));
+    return ST_Error_None;
+}
+
+static size_t field_length(const ST_FLAC *tag, int id) {
+    if(!tag || tag->base.type != ST_TagType_FLAC)
+        return (size_t)-1;
+
+    if(!tag->fields[id])
+        return 0;
+
+    return tag->fields[id]->length;
+}
+
 static ST_FLAC_vcomment *make_comment(const uint8_t *buf, size_t length) {
     ST_FLAC_vcomment *rv;
 
-    if((rv = (ST_FLAC_vcomment *)malloc(sizeof(ST_FLAC_vcomment)))) {
-        if((rv->data = (uint8_t *)malloc(length))) {
+    if((rv = (ST_FLAC_vcomment *)ST_malloc(sizeof(ST_FLAC_vcomment)))) {
+        if((rv->data = (uint8_t *)ST_malloc(length))) {
             memcpy(rv->data, buf, length);
             rv->length = length;
             return rv;
         }
 
-        free(rv);
+        ST_free(rv);
     }
 
     return NULL;
 }
 
 static void free_comment(ST_FLAC_vcomment *c) {
-    free(c->data);
-    free(c);
+    ST_free(c->data);
+    ST_free(c);
 }
 
 ST_FUNC size_t ST_FLAC_vcomment_length(const ST_FLAC_vcomment *c) {
@@ -92,19 +278,26 @@ ST_FUNC const uint8_t *ST_FLAC_vcomment_data(const ST_FLAC_vcomment *c) {
 }
 
 ST_FUNC ST_FLAC *ST_FLAC_create(void) {
-    ST_FLAC *rv = (ST_FLAC *)malloc(sizeof(ST_FLAC));
+    ST_FLAC *rv = (ST_FLAC *)ST_malloc(sizeof(ST_FLAC));
     void (*f)(void *);
 
     if(rv) {
         f = (void (*)(void *))free_comment;
         if(!(rv->vorbisComments = ST_Dict_createString(10, f))) {
-            free(rv);
+            ST_free(rv);
             return NULL;
         }
 
         rv->pictures = NULL;
         rv->npictures = 0;
+        rv->blocks.count = 0;
+        rv->blocks.blocks = NULL;
+        memset(rv->fields, 0, sizeof(rv->fields));
+        rv->bad_frame = 0;
+        rv->sample_rate = 0;
+        rv->total_samples = 0;
         rv->base.type = ST_TagType_FLAC;
+        rv->base.arena = NULL;
     }
 
     return rv;
@@ -114,6 +307,11 @@ ST_FUNC void ST_FLAC_free(ST_FLAC *tag) {
     if(!tag || tag->base.type != ST_TagType_FLAC)
         return;
 
+    if(tag->base.arena) {
+        ST_Arena_free(tag->base.arena);
+        return;
+    }
+
     /* Clean up the dictionaries. This will free all the values in them too. */
     ST_Dict_free(tag->vorbisComments);
 
@@ -121,19 +319,58 @@ ST_FUNC void ST_FLAC_free(ST_FLAC *tag) {
         ST_Picture_free(tag->pictures[--tag->npictures]);
     }
 
-    free(tag->pictures);
-    free(tag);
+    ST_free(tag->pictures);
+    ST_free(tag->blocks.blocks);
+    ST_free(tag);
+}
+
+static int add_block(ST_FLAC_BlockTable *t, uint8_t type, uint32_t len,
+                     uint64_t off, int last) {
+    void *tmp;
+
+    tmp = ST_realloc(t->blocks, (t->count + 1) * sizeof(flac_block_t));
+    if(!tmp)
+        return -1;
+
+    t->blocks = (flac_block_t *)tmp;
+    t->blocks[t->count].offset = off;
+    t->blocks[t->count].length = len;
+    t->blocks[t->count].type = type;
+    t->blocks[t->count].last = last ? 1 : 0;
+    ++t->count;
+
+    return 0;
+}
+
+/* Read the header of the next metadata block, and add it to the table. The
+   file must be positioned at the start of the block header. */
+static int read_block_header(FILE *fp, ST_FLAC_BlockTable *t, uint64_t off) {
+    uint8_t buf[4];
+    uint32_t len;
+
+    if(fread(buf, 1, 4, fp) != 4)
+        return -1;
+
+    len = (buf[1] << 16) | (buf[2] << 8) | (buf[3]);
+    return add_block(t, buf[0] & 0x7F, len, off, buf[0] & 0x80);
 }
 
 ST_FUNC ST_FLAC *ST_FLAC_createFromFile(const char *fn) {
+    return ST_FLAC_createFromFileWithFlags(fn, 0);
+}
+
+ST_FUNC ST_FLAC *ST_FLAC_createFromFileWithFlags(const char *fn,
+                                                 uint32_t flags) {
     FILE *fp;
     uint8_t buf[4];
     uint8_t *tag;
     int done = 0;
     uint8_t block_type;
     uint32_t block_len;
+    uint64_t pos = 4;
     int got_meta = 0;
     ST_FLAC *rv = ST_FLAC_create();
+    flac_block_t *b;
 
     if(!rv) {
         return NULL;
@@ -156,20 +393,24 @@ ST_FUNC ST_FLAC *ST_FLAC_createFromFile(const char *fn) {
     }
 
     /* Loop through the metadata blocks until we find a VORBIS_COMMENT or a
-       PICTURE metadata block. */
+       PICTURE metadata block. Every block we pass over gets recorded in the
+       block table along the way. */
     while(!done) {
-        if(fread(buf, 1, 4, fp) != 4) {
+        if(read_block_header(fp, &rv->blocks, pos)) {
             goto out_close;
         }
 
-        block_type = buf[0] & 0x7F;
-        block_len = (buf[1] << 16) | (buf[2] << 8) | (buf[3]);
+        b = &rv->blocks.blocks[rv->blocks.count - 1];
+        block_type = b->type;
+        block_len = b->length;
+        pos += 4 + (uint64_t)block_len;
 
         /* See if this is the last one */
-        done = buf[0] & 0x80;
+        done = b->last;
 
         /* If this isn't a type we care about, skip it. */
-        if(block_type != METADATA_TYPE_VORBIS_COMMENT &&
+        if(block_type != METADATA_TYPE_STREAMINFO &&
+           block_type != METADATA_TYPE_VORBIS_COMMENT &&
            block_type != METADATA_TYPE_PICTURE) {
             fseek(fp, (long)block_len, SEEK_CUR);
             continue;
@@ -177,18 +418,30 @@ ST_FUNC ST_FLAC *ST_FLAC_createFromFile(const char *fn) {
 
         /* Since we're looking at the metadata block we want, allocate the space
            to store it. */
-        tag = (uint8_t *)malloc((size_t)block_len);
+        tag = (uint8_t *)ST_malloc((size_t)block_len);
         if(!tag) {
             goto out_close;
         }
 
         if(fread(tag, 1, (size_t)block_len, fp) != (size_t)block_len) {
+            ST_free(tag);
             goto out_close;
         }
 
-        if(block_type == METADATA_TYPE_VORBIS_COMMENT) {
+        if(block_type == METADATA_TYPE_STREAMINFO) {
+            /* The sample rate is 20 bits at byte 10, and the total number of
+               samples is the 36 bits after the channels and sample size. */
+            if(block_len >= 18) {
+                rv->sample_rate = (tag[10] << 12) | (tag[11] << 4) |
+                    (tag[12] >> 4);
+                rv->total_samples = ((uint64_t)(tag[13] & 0x0F) << 32) |
+                    ((uint32_t)tag[14] << 24) | (tag[15] << 16) |
+                    (tag[16] << 8) | tag[17];
+            }
+        }
+        else if(block_type == METADATA_TYPE_VORBIS_COMMENT) {
             if(parse_comments(rv, tag, block_len) < 0) {
-                free(tag);
+                ST_free(tag);
                 goto out_close;
             }
 
@@ -196,7 +449,7 @@ ST_FUNC ST_FLAC *ST_FLAC_createFromFile(const char *fn) {
         }
         else if(block_type == METADATA_TYPE_PICTURE) {
             if(parse_picture(rv, tag, block_len) < 0) {
-                free(tag);
+                ST_free(tag);
                 goto out_close;
             }
 
@@ -204,9 +457,14 @@ ST_FUNC ST_FLAC *ST_FLAC_createFromFile(const char *fn) {
         }
 
         /* Clean up before the next round */
-        free(tag);
+        ST_free(tag);
     }
 
+    /* The file is now positioned at the first audio frame, so check them over
+       if we've been asked to. */
+    if(flags & ST_FLAC_Flag_VerifyFrames)
+        rv->bad_frame = ST_FLAC_verifyFrames(fp, pos);
+
     /* We're done with the file at this point, no matter what. */
     fclose(fp);
 
@@ -224,6 +482,138 @@ out_free:
     return NULL;
 }
 
+ST_FUNC uint64_t ST_FLAC_badFrameOffset(const ST_FLAC *tag) {
+    if(!tag || tag->base.type != ST_TagType_FLAC)
+        return (uint64_t)-1;
+
+    return tag->bad_frame;
+}
+
+ST_FUNC ST_FLAC_BlockTable *ST_FLAC_BlockTable_createFromFile(const char *fn) {
+    FILE *fp;
+    uint8_t buf[4];
+    uint64_t pos = 4;
+    flac_block_t *b;
+    ST_FLAC_BlockTable *rv;
+
+    if(!fn)
+        return NULL;
+
+    if(!(rv = (ST_FLAC_BlockTable *)ST_malloc(sizeof(ST_FLAC_BlockTable))))
+        return NULL;
+
+    rv->count = 0;
+    rv->blocks = NULL;
+
+    if(!(fp = fopen(fn, "rb")))
+        goto out_free;
+
+    if(fread(buf, 1, 4, fp) != 4 || memcmp("fLaC", buf, 4))
+        goto out_close;
+
+    /* Only the block headers are read here, everything else gets skipped. */
+    do {
+        if(read_block_header(fp, rv, pos))
+            goto out_close;
+
+        b = &rv->blocks[rv->count - 1];
+        pos += 4 + (uint64_t)b->length;
+
+        if(!b->last && fseek(fp, (long)b->length, SEEK_CUR))
+            goto out_close;
+    } while(!b->last);
+
+    fclose(fp);
+    return rv;
+
+out_close:
+    fclose(fp);
+out_free:
+    ST_FLAC_BlockTable_free(rv);
+    return NULL;
+}
+
+ST_FUNC void ST_FLAC_BlockTable_free(ST_FLAC_BlockTable *t) {
+    if(!t)
+        return;
+
+    ST_free(t->blocks);
+    ST_free(t);
+}
+
+ST_FUNC const ST_FLAC_BlockTable *ST_FLAC_blockTable(const ST_FLAC *tag) {
+    if(!tag || tag->base.type != ST_TagType_FLAC)
+        return NULL;
+
+    return &tag->blocks;
+}
+
+ST_FUNC int ST_FLAC_BlockTable_count(const ST_FLAC_BlockTable *t) {
+    if(!t)
+        return -1;
+
+    return t->count;
+}
+
+ST_FUNC ST_FLAC_BlockType ST_FLAC_BlockTable_type(const ST_FLAC_BlockTable *t,
+                                                  int index) {
+    if(!t || index < 0 || index >= t->count)
+        return ST_FLAC_BlockType_Invalid;
+
+    return (ST_FLAC_BlockType)t->blocks[index].type;
+}
+
+ST_FUNC uint64_t ST_FLAC_BlockTable_offset(const ST_FLAC_BlockTable *t,
+                                           int index) {
+    if(!t || index < 0 || index >= t->count)
+        return (uint64_t)-1;
+
+    return t->blocks[index].offset;
+}
+
+ST_FUNC uint32_t ST_FLAC_BlockTable_length(const ST_FLAC_BlockTable *t,
+                                           int index) {
+    if(!t || index < 0 || index >= t->count)
+        return (uint32_t)-1;
+
+    return t->blocks[index].length;
+}
+
+ST_FUNC int ST_FLAC_BlockTable_isLast(const ST_FLAC_BlockTable *t, int index) {
+    if(!t || index < 0 || index >= t->count)
+        return -1;
+
+    return (int)t->blocks[index].last;
+}
+
+ST_FUNC uint64_t ST_FLAC_BlockTable_paddingLength(const ST_FLAC_BlockTable *t) {
+    uint64_t rv = 0;
+    int i;
+
+    if(!t)
+        return (uint64_t)-1;
+
+    for(i = 0; i < t->count; ++i) {
+        if(t->blocks[i].type == METADATA_TYPE_PADDING)
+            rv += t->blocks[i].length;
+    }
+
+    return rv;
+}
+
+ST_FUNC uint64_t ST_FLAC_BlockTable_audioOffset(const ST_FLAC_BlockTable *t) {
+    const flac_block_t *b;
+
+    if(!t || !t->count)
+        return (uint64_t)-1;
+
+    b = &t->blocks[t->count - 1];
+    if(!b->last)
+        return (uint64_t)-1;
+
+    return b->offset + 4 + b->length;
+}
+
 ST_FUNC ST_Error ST_FLAC_commentForKey(const ST_FLAC *tag, const char *key,
                                        int index, uint8_t *buf, size_t len) {
     const void **value;
@@ -313,45 +703,64 @@ ST_FUNC size_t ST_FLAC_commentLengthForKey(const ST_FLAC *tag, const char *key,
 }
 
 ST_FUNC ST_Error ST_FLAC_title(const ST_FLAC *tag, uint8_t *buf, size_t len) {
-    if(!tag || tag->base.type != ST_TagType_FLAC)
-        return ST_Error_InvalidArgument;
-
-    return ST_FLAC_commentForKey(tag, "title", 0, buf, len);
+    return field_value(tag, VC_Title, buf, len);
 }
 
 ST_FUNC ST_Error ST_FLAC_artist(const ST_FLAC *tag, uint8_t *buf, size_t len) {
-    if(!tag || tag->base.type != ST_TagType_FLAC)
-        return ST_Error_InvalidArgument;
-
-    return ST_FLAC_commentForKey(tag, "artist", 0, buf, len);
+    return field_value(tag, VC_Artist, buf, len);
 }
 
 ST_FUNC ST_Error ST_FLAC_album(const ST_FLAC *tag, uint8_t *buf, size_t len) {
-    if(!tag || tag->base.type != ST_TagType_FLAC)
-        return ST_Error_InvalidArgument;
-
-    return ST_FLAC_commentForKey(tag, "album", 0, buf, len);
+    return field_value(tag, VC_Album, buf, len);
 }
 
 ST_FUNC ST_Error ST_FLAC_comment(const ST_FLAC *tag, uint8_t *buf, size_t len) {
-    if(!tag || tag->base.type != ST_TagType_FLAC)
-        return ST_Error_InvalidArgument;
-
-    return ST_FLAC_commentForKey(tag, "comment", 0, buf, len);
+    return field_value(tag, VC_Comment, buf, len);
 }
 
 ST_FUNC ST_Error ST_FLAC_date(const ST_FLAC *tag, uint8_t *buf, size_t len) {
-    if(!tag || tag->base.type != ST_TagType_FLAC)
-        return ST_Error_InvalidArgument;
-
-    return ST_FLAC_commentForKey(tag, "date", 0, buf, len);
+    return field_value(tag, VC_Date, buf, len);
 }
 
 ST_FUNC ST_Error ST_FLAC_genre(const ST_FLAC *tag, uint8_t *buf, size_t len) {
+    return field_value(tag, VC_Genre, buf, len);
+}
+
+ST_FUNC int ST_FLAC_normalizedGenre(const ST_FLAC *tag, uint8_t *buf,
+                                    size_t len) {
+    const ST_FLAC_vcomment *val;
+
+    if(buf && len)
+        buf[0] = 0;
+
     if(!tag || tag->base.type != ST_TagType_FLAC)
+        return ST_Genre_None;
+
+    if(!(val = tag->fields[VC_Genre]))
+        return ST_Genre_None;
+
+    return ST_Genre_normalize(val->data, val->length, buf, len);
+}
+
+ST_FUNC ST_Error ST_FLAC_get(const ST_FLAC *tag, ST_Field field, uint8_t *buf,
+                             size_t len) {
+    const ST_FLAC_vcomment *val;
+
+    if(!tag || tag->base.type != ST_TagType_FLAC || !buf || !len ||
+       field < 0 || field >= ST_Field_Count)
         return ST_Error_InvalidArgument;
 
-    return ST_FLAC_commentForKey(tag, "genre", 0, buf, len);
+    buf[0] = 0;
+
+    if(field == ST_Field_Genre) {
+        return ST_Tag_getGenre((const ST_Tag *)tag, buf, len);
+    }
+
+    if(!(val = tag->fields[vc_fields[field]]) || !val->length)
+        return ST_Error_NotFound;
+
+    return ST_Text_getUTF8(val->data, val->length, ST_TextEncoding_UTF8, buf,
+                           len);
 }
 
 #ifdef ST_HAVE_COREFOUNDATION
@@ -419,10 +828,7 @@ ST_FUNC CFStringRef ST_FLAC_copyGenre(const ST_FLAC *tag, ST_Error *err) {
 ST_FUNC int ST_FLAC_track(const ST_FLAC *tag) {
     uint8_t tmp[32];
 
-    if(!tag || tag->base.type != ST_TagType_FLAC)
-        return -1;
-
-    if(ST_FLAC_commentForKey(tag, "tracknumber", 0, tmp, 32) != ST_Error_None)
+    if(field_value(tag, VC_TrackNumber, tmp, 32) != ST_Error_None)
         return -1;
 
     tmp[31] = 0;
@@ -432,14 +838,65 @@ ST_FUNC int ST_FLAC_track(const ST_FLAC *tag) {
 ST_FUNC int ST_FLAC_disc(const ST_FLAC *tag) {
     uint8_t tmp[32];
 
-    if(!tag || tag->base.type != ST_TagType_FLAC)
+    if(field_value(tag, VC_DiscNumber, tmp, 32) != ST_Error_None)
         return -1;
 
-    if(ST_FLAC_commentForKey(tag, "discnumber", 0, tmp, 32) != ST_Error_None)
+    tmp[31] = 0;
+    return atoi((const char *)tmp);
+}
+
+/* Get the total out of TRACKTOTAL/DISCTOTAL, or the number/total form of
+   TRACKNUMBER/DISCNUMBER. */
+static int field_total(const ST_FLAC *tag, int id, int total_id) {
+    uint8_t tmp[32];
+    const char *slash;
+
+    if(field_value(tag, total_id, tmp, 32) == ST_Error_None) {
+        tmp[31] = 0;
+        return atoi((const char *)tmp);
+    }
+
+    if(field_value(tag, id, tmp, 32) != ST_Error_None)
         return -1;
 
     tmp[31] = 0;
-    return atoi((const char *)tmp);
+
+    if(!(slash = strchr((const char *)tmp, '/')))
+        return -1;
+
+    return atoi(slash + 1);
+}
+
+ST_FUNC int ST_FLAC_trackCount(const ST_FLAC *tag) {
+    return field_total(tag, VC_TrackNumber, VC_TrackTotal);
+}
+
+ST_FUNC int ST_FLAC_discCount(const ST_FLAC *tag) {
+    return field_total(tag, VC_DiscNumber, VC_DiscTotal);
+}
+
+ST_FUNC uint32_t ST_FLAC_sampleRate(const ST_FLAC *tag) {
+    if(!tag || tag->base.type != ST_TagType_FLAC)
+        return (uint32_t)-1;
+
+    return tag->sample_rate;
+}
+
+ST_FUNC uint64_t ST_FLAC_totalSamples(const ST_FLAC *tag) {
+    if(!tag || tag->base.type != ST_TagType_FLAC)
+        return (uint64_t)-1;
+
+    return tag->total_samples;
+}
+
+ST_FUNC uint64_t ST_FLAC_durationMs(const ST_FLAC *tag) {
+    if(!tag || tag->base.type != ST_TagType_FLAC)
+        return (uint64_t)-1;
+
+    if(!tag->sample_rate)
+        return 0;
+
+    return tag->total_samples * 1000 / tag->sample_rate;
 }
 
 ST_FUNC const ST_Picture *ST_FLAC_picture(const ST_FLAC *tag, ST_PictureType pt,
@@ -468,27 +925,27 @@ ST_FUNC const ST_Picture *ST_FLAC_picture(const ST_FLAC *tag, ST_PictureType pt,
 }
 
 ST_FUNC size_t ST_FLAC_titleLength(const ST_FLAC *tag) {
-    return ST_FLAC_commentLengthForKey(tag, "title", 0);
+    return field_length(tag, VC_Title);
 }
 
 ST_FUNC size_t ST_FLAC_artistLength(const ST_FLAC *tag) {
-    return ST_FLAC_commentLengthForKey(tag, "artist", 0);
+    return field_length(tag, VC_Artist);
 }
 
 ST_FUNC size_t ST_FLAC_albumLength(const ST_FLAC *tag) {
-    return ST_FLAC_commentLengthForKey(tag, "album", 0);
+    return field_length(tag, VC_Album);
 }
 
 ST_FUNC size_t ST_FLAC_commentLength(const ST_FLAC *tag) {
-    return ST_FLAC_commentLengthForKey(tag, "comment", 0);
+    return field_length(tag, VC_Comment);
 }
 
 ST_FUNC size_t ST_FLAC_dateLength(const ST_FLAC *tag) {
-    return ST_FLAC_commentLengthForKey(tag, "date", 0);
+    return field_length(tag, VC_Date);
 }
 
 ST_FUNC size_t ST_FLAC_genreLength(const ST_FLAC *tag) {
-    return ST_FLAC_commentLengthForKey(tag, "genre", 0);
+    return field_length(tag, VC_Genre);
 }
 
 static ST_Error replace_tag(ST_FLAC *tag, const char *k, const uint8_t *v,
@@ -510,6 +967,8 @@ static ST_Error replace_tag(ST_FLAC *tag, const char *k, const uint8_t *v,
 
     if(rv != ST_Error_None)
         free_comment(c);
+    else
+        update_field(tag, k);
 
     return rv;
 }
@@ -570,33 +1029,33 @@ static ST_FLAC_vcomment *make_comment_str(CFStringRef s) {
     slen = CFStringGetLength(s);
     len = CFStringGetMaximumSizeForEncoding(CFStringGetLength(s),
                                             kCFStringEncodingUTF8);
-    if(!(tmp = (uint8_t *)malloc(len)))
+    if(!(tmp = (uint8_t *)ST_malloc(len)))
         return NULL;
 
     if(CFStringGetBytes(s, CFRangeMake(0, slen), kCFStringEncodingUTF8, 0,
                         false, (UInt8 *)tmp, len, &clen) != len) {
-        free(tmp);
+        ST_free(tmp);
         errno = EILSEQ;
         return NULL;
     }
 
     /* Trim the buffer down to the smallest it can be, since we allocated the
        maximum length it could've been up above. */
-    if(!(stmp = (uint8_t *)realloc(tmp, clen))) {
-        free(tmp);
+    if(!(stmp = (uint8_t *)ST_realloc(tmp, clen))) {
+        ST_free(tmp);
         return NULL;
     }
 
-    free(tmp);
+    ST_free(tmp);
 
     /* Make the comment structure and return it! */
-    if((rv = (ST_FLAC_vcomment *)malloc(sizeof(ST_FLAC_vcomment)))) {
+    if((rv = (ST_FLAC_vcomment *)ST_malloc(sizeof(ST_FLAC_vcomment)))) {
         rv->data = stmp;
         rv->length = clen;
         return rv;
     }
 
-    free(stmp);
+    ST_free(stmp);
     return NULL;
 }
 
@@ -617,6 +1076,8 @@ static ST_Error replace_tag_str(ST_FLAC *tag, const char *k, CFStringRef s) {
 
     if(rv != ST_Error_None)
         free_comment(c);
+    else
+        update_field(tag, k);
 
     return rv;
 }
@@ -652,7 +1113,8 @@ ST_FUNC ST_Error ST_FLAC_addPicture(ST_FLAC *tag, ST_Picture *p) {
     if(!tag || !p || tag->base.type != ST_TagType_FLAC)
         return ST_Error_InvalidArgument;
 
-    tmp = realloc(tag->pictures, (tag->npictures + 1) * sizeof(ST_Picture *));
+    tmp = ST_realloc(tag->pictures,
+                     (tag->npictures + 1) * sizeof(ST_Picture *));
     if(!tmp)
         return ST_Error_errno;
 
@@ -676,7 +1138,7 @@ static ST_Error remove_pict(ST_FLAC *tag, int i) {
     /* Reduce the space we're using. If this fails, we still have the old
        pointer, so its not really a big deal (although, it really shouldn't
        ever fail). */
-    tmp = realloc(tag->pictures, --tag->npictures * sizeof(ST_Picture *));
+    tmp = ST_realloc(tag->pictures, --tag->npictures * sizeof(ST_Picture *));
     if(tmp)
         tag->pictures = (ST_Picture **)tmp;
 
@@ -783,7 +1245,9 @@ ST_FUNC ST_Error ST_FLAC_addComment(ST_FLAC *tag, const char *key,
         return ST_Error_errno;
 
     if((rv = ST_Dict_add(tag->vorbisComments, key, tmp)) != ST_Error_None)
-        free(tmp);
+        ST_free(tmp);
+    else
+        update_field(tag, key);
 
     return rv;
 }
@@ -801,7 +1265,9 @@ ST_FUNC ST_Error ST_FLAC_addCommentStr(ST_FLAC *tag, const char *key,
         return ST_Error_errno;
 
     if((rv = ST_Dict_add(tag->vorbisComments, key, tmp)) != ST_Error_None)
-        free(tmp);
+        ST_free(tmp);
+    else
+        update_field(tag, key);
 
     return rv;
 }
@@ -809,16 +1275,22 @@ ST_FUNC ST_Error ST_FLAC_addCommentStr(ST_FLAC *tag, const char *key,
 
 ST_FUNC ST_Error ST_FLAC_removeComment(ST_FLAC *tag, const char *key,
                                        int index) {
+    ST_Error rv;
+
     if(!tag || !key || index < -1 || tag->base.type != ST_TagType_FLAC)
         return ST_Error_InvalidArgument;
 
-    return ST_Dict_remove(tag->vorbisComments, key, index);
+    if((rv = ST_Dict_remove(tag->vorbisComments, key, index)) == ST_Error_None)
+        update_field(tag, key);
+
+    return rv;
 }
 
 static int parse_comments(ST_FLAC *tag, uint8_t *buf, uint32_t length) {
     uint32_t start = 0, sz, count;
     char *tmp, *tmp2, *tmp3;
     ST_FLAC_vcomment *c;
+    int id;
 
     /* Make sure things are relatively sane */
     if(length < 4)
@@ -827,7 +1299,7 @@ static int parse_comments(ST_FLAC *tag, uint8_t *buf, uint32_t length) {
     /* The first part of the Vorbis Comment is the vendor of the encoder. */
     sz = buf[0] | (buf[1] << 8) | (buf[2] << 16) | (buf[3] << 24);
 
-    if(length < 4 + sz || !(tmp = (char *)malloc(sz + 1)))
+    if(length < 4 + sz || !(tmp = (char *)ST_malloc(sz + 1)))
         return -1;
 
     memcpy(tmp, buf + 4, sz);
@@ -836,7 +1308,7 @@ static int parse_comments(ST_FLAC *tag, uint8_t *buf, uint32_t length) {
     if(!(c = make_comment((uint8_t *)tmp, strlen(tmp))))
         return -1;
 
-    free(tmp);
+    ST_free(tmp);
     ST_Dict_add(tag->vorbisComments, "vendor", c);
 
     /* Set up the rest of the parsing */
@@ -850,7 +1322,7 @@ static int parse_comments(ST_FLAC *tag, uint8_t *buf, uint32_t length) {
         sz = buf[start] | (buf[start + 1] << 8) | (buf[start + 2] << 16) |
             (buf[start + 3] << 24);
 
-        if(length < start + sz + 4 || !(tmp = (char *)malloc(sz + 1)))
+        if(length < start + sz + 4 || !(tmp = (char *)ST_malloc(sz + 1)))
             return -1;
 
         /* Read in the comment and parse it */
@@ -865,7 +1337,7 @@ static int parse_comments(ST_FLAC *tag, uint8_t *buf, uint32_t length) {
             *tmp2++ = 0;
 
             if(!(c = make_comment((uint8_t *)tmp2, sz - strlen(tmp) - 1))) {
-                free(tmp);
+                ST_free(tmp);
                 return -1;
             }
 
@@ -877,10 +1349,19 @@ static int parse_comments(ST_FLAC *tag, uint8_t *buf, uint32_t length) {
                 ++tmp3;
             }
 
-            ST_Dict_add(tag->vorbisComments, tmp, c);
+            if(ST_Dict_add(tag->vorbisComments, tmp, c) != ST_Error_None) {
+                free_comment(c);
+                ST_free(tmp);
+                return -1;
+            }
+
+            /* Remember the first value of any of the well-known keys. */
+            id = field_id(tmp, (size_t)(tmp3 - tmp));
+            if(id >= 0 && !tag->fields[id])
+                tag->fields[id] = c;
         }
 
-        free(tmp);
+        ST_free(tmp);
         start += sz + 4;
     }
 
@@ -909,7 +1390,7 @@ static int parse_picture(ST_FLAC *tag, uint8_t *bytes, uint32_t len) {
     /* Next up is the mime type string (ASCII) */
     sz = (bytes[4] << 24) | (bytes[5] << 16) | (bytes[6] << 8) | bytes[7];
 
-    if(len < 8 + sz || !(mime = (char *)malloc(sz + 1)))
+    if(len < 8 + sz || !(mime = (char *)ST_malloc(sz + 1)))
         return -1;
 
     memcpy(mime, bytes + 8, sz);
@@ -919,15 +1400,15 @@ static int parse_picture(ST_FLAC *tag, uint8_t *bytes, uint32_t len) {
     start = sz + 8;
 
     if(len < start + 4) {
-        free(mime);
+        ST_free(mime);
         return -1;
     }
 
     desc_sz = (bytes[start] << 24) | (bytes[start + 1] << 16) |
         (bytes[start + 2] << 8) | bytes[start + 3];
 
-    if(len < start + 4 + desc_sz || !(desc = (uint8_t *)malloc(desc_sz))) {
-        free(mime);
+    if(len < start + 4 + desc_sz || !(desc = (uint8_t *)ST_malloc(desc_sz))) {
+        ST_free(mime);
         return -1;
     }
 
@@ -937,8 +1418,8 @@ static int parse_picture(ST_FLAC *tag, uint8_t *bytes, uint32_t len) {
     start += desc_sz + 4;
 
     if(len < start + 20) {
-        free(desc);
-        free(mime);
+        ST_free(desc);
+        ST_free(mime);
         return -1;
     }
 
@@ -955,9 +1436,9 @@ static int parse_picture(ST_FLAC *tag, uint8_t *bytes, uint32_t len) {
     sz = (bytes[start + 16] << 24) | (bytes[start + 17] << 16) |
         (bytes[start + 18] << 8) | bytes[start + 19];
 
-    if(len < start + 20 + sz || !(data = (uint8_t *)malloc(sz))) {
-        free(desc);
-        free(mime);
+    if(len < start + 20 + sz || !(data = (uint8_t *)ST_malloc(sz))) {
+        ST_free(desc);
+        ST_free(mime);
         return -1;
     }
 
@@ -965,9 +1446,9 @@ static int parse_picture(ST_FLAC *tag, uint8_t *bytes, uint32_t len) {
 
     /* Store it into a new picture */
     if(!(p = ST_Picture_create())) {
-        free(data);
-        free(desc);
-        free(mime);
+        ST_free(data);
+        ST_free(desc);
+        ST_free(mime);
         return -1;
     }
 
@@ -980,23 +1461,24 @@ static int parse_picture(ST_FLAC *tag, uint8_t *bytes, uint32_t len) {
     if(ST_Picture_setMimeType(p, mime) ||
        ST_Picture_setDescription(p, desc, desc_sz, ST_TextEncoding_UTF8)) {
         ST_Picture_free(p);
-        free(data);
-        free(desc);
-        free(mime);
+        ST_free(data);
+        ST_free(desc);
+        ST_free(mime);
         return -1;
     }
 
-    free(desc);
-    free(mime);
+    ST_free(desc);
+    ST_free(mime);
 
     if(ST_Picture_setData(p, data, sz, 1)) {
         ST_Picture_free(p);
-        free(data);
+        ST_free(data);
         return -1;
     }
 
     /* Add the picture to the list */
-    tmp = realloc(tag->pictures, (tag->npictures + 1) * sizeof(ST_Picture *));
+    tmp = ST_realloc(tag->pictures,
+                     (tag->npictures + 1) * sizeof(ST_Picture *));
     if(!tmp) {
         ST_Picture_free(p);
         return -1;
@@ -0,0 +1,60 @@
+#!/usr/bin/env python3
+#
+# SonatinaTag
+# Copyright (C) 2026 Lawrence Sebald
+#
+# Generate FLACCrc.h, the CRC tables used to check FLAC frames:
+#
+#     python3 crc_tables.py > FLACCrc.h
+#
+# The CRC-8 (polynomial 0x07) covers the frame headers and the CRC-16
+# (polynomial 0x8005) covers whole frames. The CRC-16 has eight tables so that
+# it can be done eight bytes at a time, using the slicing-by-8 method.
+
+import sys
+
+
+def main():
+    crc8 = []
+    crc16 = [[0] * 256 for _ in range(8)]
+
+    for i in range(256):
+        c8 = i
+        c16 = i << 8
+
+        for _ in range(8):
+            c8 = ((c8 << 1) ^ 0x07) & 0xFF if c8 & 0x80 else (c8 << 1) & 0xFF
+            c16 = (((c16 << 1) ^ 0x8005) & 0xFFFF if c16 & 0x8000 else
+                   (c16 << 1) & 0xFFFF)
+
+        crc8.append(c8)
+        crc16[0][i] = c16
+
+    for i in range(256):
+        c16 = crc16[0][i]
+
+        for j in range(1, 8):
+            c16 = ((c16 << 8) & 0xFFFF) ^ crc16[0][c16 >> 8]
+            crc16[j][i] = c16
+
+    out = sys.stdout
+    out.write("/* Generated by crc_tables.py -- do not edit. */\n\n")
+
+    out.write("static const uint8_t crc8_table[256] = {\n")
+    for i in range(0, 256, 8):
+        out.write("    " + ", ".join("0x%02X" % c for c in crc8[i:i + 8]) +
+                  ",\n")
+    out.write("};\n\n")
+
+    out.write("static const uint16_t crc16_table[8][256] = {\n")
+    for t in crc16:
+        out.write("    {\n")
+        for i in range(0, 256, 8):
+            out.write("        " +
+                      ", ".join("0x%04X" % c for c in t[i:i + 8]) + ",\n")
+        out.write("    },\n")
+    out.write("};\n")
+
+
+if __name__ == "__main__":
+    main()
@@ -28,17 +28,14 @@
 
 #include "SonatinaTag/SonatinaTag.h"
 #include "SonatinaTag/Tags/ID3v1.h"
+#include "SonatinaTag/Allocator.h"
 #include "../base/Tag.h"
+#include "../utils/Tail.h"
+#include "../utils/Text.h"
 
 struct ST_ID3v1_struct {
     ST_Tag base;
-    char *title;
-    char *artist;
-    char *album;
-    char *year;
-    char *comment;
-    uint8_t genre;
-    uint8_t track;
+    ST_ID3v1_Record rec;
 };
 
 /* Raw (file) representation of the tag */
@@ -59,6 +56,21 @@ struct ID3v1_Tag {
     uint8_t genre;
 } __attribute__((packed));
 
+/* Enhanced TAG+ block, which sits right in front of the ID3v1 tag and holds
+   the rest of any title, artist, or album that doesn't fit in it. */
+#define TAGPLUS_FIELD_LEN   60
+
+struct TAGPlus_Block {
+    char magic[4];
+    char title[TAGPLUS_FIELD_LEN];
+    char artist[TAGPLUS_FIELD_LEN];
+    char album[TAGPLUS_FIELD_LEN];
+    uint8_t speed;
+    char genre[30];
+    char start_time[6];
+    char end_time[6];
+} __attribute__((packed));
+
 /* List of Genres -- English only */
 static const char *id3_genres[ID3v1GenreMax + 1] = {
     "Blues", "Classic Rock", "Country", "Dance", "Disco", "Funk",
@@ -93,7 +105,7 @@ static const char *id3_genres[ID3v1GenreMax + 1] = {
 };
 
 ST_FUNC ST_ID3v1 *ST_ID3v1_create(void) {
-    ST_ID3v1 *rv = (ST_ID3v1 *)malloc(sizeof(ST_ID3v1));
+    ST_ID3v1 *rv = (ST_ID3v1 *)ST_malloc(sizeof(ST_ID3v1));
 
     if(rv) {
         memset(rv, 0, sizeof(ST_ID3v1));
@@ -107,92 +119,178 @@ ST_FUNC void ST_ID3v1_free(ST_ID3v1 *tag) {
     if(!tag || tag->base.type != ST_TagType_ID3v1)
         return;
 
-    free(tag->title);
-    free(tag->artist);
-    free(tag->album);
-    free(tag->year);
-    free(tag->comment);
-    free(tag);
+    if(tag->base.arena) {
+        ST_Arena_free(tag->base.arena);
+        return;
+    }
+
+    ST_free(tag);
 }
 
-ST_FUNC ST_ID3v1 *ST_ID3v1_createFromFile(const char *fn) {
-    ST_ID3v1 *rv = ST_ID3v1_create();
+/* Copy out one of the text fields of the tag. This is a bit of a dance just
+   because of the fact that the ID3v1 fields may not be NUL terminated. If the
+   field is full and there's an Enhanced TAG+ block, the rest of it is there. */
+static void get_field(char *to, const char *v1, size_t len, const char *ext) {
+    memcpy(to, v1, len);
+    to[len] = 0;
+
+    if(ext && strlen(to) == len) {
+        memcpy(to + len, ext, TAGPLUS_FIELD_LEN);
+        to[len + TAGPLUS_FIELD_LEN] = 0;
+    }
+}
+
+/* Fill in a record from the raw tag, and the Enhanced TAG+ block (if there is
+   one). The tag is assumed to have already been checked for the magic value. */
+static void parse_record(ST_ID3v1_Record *rec, const uint8_t *raw,
+                         const uint8_t *rawext) {
     struct ID3v1_Tag tag;
-    FILE *fp;
-    char tmp[31];
+    struct TAGPlus_Block ext;
+    int has_ext = 0;
+
+    memcpy(&tag, raw, 128);
+
+    if(rawext && !memcmp(rawext, "TAG+", 4)) {
+        memcpy(&ext, rawext, 227);
+        has_ext = 1;
+    }
+
+    get_field(rec->title, tag.title, 30, has_ext ? ext.title : NULL);
+    get_field(rec->artist, tag.artist, 30, has_ext ? ext.artist : NULL);
+    get_field(rec->album, tag.album, 30, has_ext ? ext.album : NULL);
+    get_field(rec->comment, tag.comment_field.comment, 30, NULL);
+    get_field(rec->year, tag.year, 4, NULL);
+    rec->genre = tag.genre;
+    rec->track = 0;
 
-    if(!rv)
+    /* Deal with v1.1 tags. */
+    if(tag.comment_field.v1_1.zero == 0)
+        rec->track = tag.comment_field.v1_1.track;
+}
+
+ST_LOCAL ST_ID3v1 *ST_ID3v1_createFromTail(const ST_Tail *t) {
+    ST_ID3v1 *rv;
+
+    /* The probe has already checked for the magic value. */
+    if(t->id3v1 == -1 || !(rv = ST_ID3v1_create()))
         return NULL;
 
+    parse_record(&rv->rec, ST_Tail_bytes(t, t->id3v1, 128),
+                 t->tag_plus != -1 ? ST_Tail_bytes(t, t->tag_plus, 227) :
+                 NULL);
+    return rv;
+}
+
+ST_FUNC ST_ID3v1 *ST_ID3v1_createFromFile(const char *fn) {
+    FILE *fp;
+    ST_Tail t;
+    ST_ID3v1 *rv = NULL;
+
     /* Attempt to open the specified file */
     if(!(fp = fopen(fn, "rb")))
-       goto out_rel;
-
-    /* Go to the position where the ID3v1 should be in the file. */
-    if(fseek(fp, -128, SEEK_END))
-        goto out_close;
+        return NULL;
 
-    /* Read in the whole tag area for checking */
-    if(fread(&tag, 1, 128, fp) != 128)
-        goto out_close;
+    if(!ST_Tail_probe(fp, &t)) {
+        rv = ST_ID3v1_createFromTail(&t);
+        ST_Tail_release(&t);
+    }
 
     fclose(fp);
+    return rv;
+}
 
-    /* Look for the magic value */
-    if(tag.magic[0] != 'T' || tag.magic[1] != 'A' || tag.magic[2] != 'G')
-        goto out_rel;
+ST_FUNC ST_Error ST_ID3v1_readRecord(const char *fn, ST_ID3v1_Record *rec) {
+    FILE *fp;
+    uint8_t buf[227 + 128];
+    off_t fsz;
+    size_t len;
+    ST_Error rv = ST_Error_NotFound;
 
-    /* Copy out each part of the tag. This is a bit of a dance just because of
-       the fact that the ID3v1 fields may not be NUL terminated. */
-    tmp[30] = 0;
-    memcpy(tmp, tag.title, 30);
-    if(!(rv->title = strdup(tmp)))
-       goto out_rel;
+    if(!fn || !rec)
+        return ST_Error_InvalidArgument;
 
-    memcpy(tmp, tag.artist, 30);
-    if(!(rv->artist = strdup(tmp)))
-        goto out_rel;
+    memset(rec, 0, sizeof(ST_ID3v1_Record));
 
-    memcpy(tmp, tag.album, 30);
-    if(!(rv->album = strdup(tmp)))
-        goto out_rel;
+    if(!(fp = fopen(fn, "rb")))
+        return ST_Error_errno;
 
-    memcpy(tmp, tag.comment_field.comment, 30);
-    if(!(rv->comment = strdup(tmp)))
-        goto out_rel;
+    /* The tag and any Enhanced TAG+ block in front of it come in with one
+       read, so there's no point in having stdio allocate a buffer. */
+    setvbuf(fp, NULL, _IONBF, 0);
 
-    tmp[4] = 0;
-    memcpy(tmp, tag.year, 4);
-    if(!(rv->year = strdup(tmp)))
-        goto out_rel;
+    if(fseeko(fp, 0, SEEK_END) || (fsz = ftello(fp)) < 0) {
+        rv = ST_Error_errno;
+        goto out;
+    }
 
-    rv->genre = tag.genre;
+    len = (fsz < (off_t)sizeof(buf)) ? (size_t)fsz : sizeof(buf);
 
-    /* Deal with v1.1 tags. */
-    if(tag.comment_field.v1_1.zero == 0)
-        rv->track = tag.comment_field.v1_1.track;
+    if(fseeko(fp, -(off_t)len, SEEK_END) || fread(buf, 1, len, fp) != len) {
+        rv = ST_Error_errno;
+        goto out;
+    }
 
-    return rv;
+    if(len >= 128 && !memcmp(buf + len - 128, "TAG", 3)) {
+        parse_record(rec, buf + len - 128, len == sizeof(buf) ? buf : NULL);
+        rv = ST_Error_None;
+    }
 
-out_close:
+out:
     fclose(fp);
-out_rel:
-    ST_ID3v1_free(rv);
+    return rv;
+}
+
+ST_FUNC size_t ST_ID3v1_readRecords(const char *const *fns, size_t count,
+                                    ST_ID3v1_Record *recs, ST_Error *errs) {
+    size_t i, rv = 0;
+    ST_Error err;
+
+    if(!fns || !recs)
+        return 0;
+
+    for(i = 0; i < count; ++i) {
+        if((err = ST_ID3v1_readRecord(fns[i], &recs[i])) == ST_Error_None)
+            ++rv;
+
+        if(errs)
+            errs[i] = err;
+    }
+
+    return rv;
+}
+
+ST_FUNC const ST_ID3v1_Record *ST_ID3v1_record(const ST_ID3v1 *tag) {
+    if(!tag || tag->base.type != ST_TagType_ID3v1)
+        return NULL;
+
+    return &tag->rec;
+}
 
-    return NULL;
+/* Copy as much of a field as fits into the (zeroed out) raw tag. */
+static void put_field(char *to, const char *from, size_t max) {
+    size_t len = strlen(from);
+
+    memcpy(to, from, len > max ? max : len);
 }
 
-#define COPY_IF_NOT_NULL(to, from, cnt) \
-    if(from) strncpy(to, from, cnt)
+/* Copy whatever part of a field doesn't fit in the ID3v1 tag itself into the
+   Enhanced TAG+ block. */
+static void put_ext(char *to, const char *from) {
+    size_t len;
+
+    memset(to, 0, TAGPLUS_FIELD_LEN);
 
-#define COPY_IF_NOT_NULL_OR_ZERO(to, from, cnt) { \
-    if(from) strncpy(to, from, cnt); \
-    else     memset(to, 0, cnt); \
+    if((len = strlen(from)) > 30) {
+        len -= 30;
+        memcpy(to, from + 30, len > TAGPLUS_FIELD_LEN ? TAGPLUS_FIELD_LEN : len);
+    }
 }
 
 ST_FUNC ST_Error ST_ID3v1_writeToFile(const ST_ID3v1 *t, const char *fn) {
     FILE *fp;
+    ST_Tail tail;
     struct ID3v1_Tag tag;
+    struct TAGPlus_Block ext;
     ST_Error rv = ST_Error_None;
 
     /* Verify the tag and filename are not NULL */
@@ -206,59 +304,60 @@ ST_FUNC ST_Error ST_ID3v1_writeToFile(const ST_ID3v1 *t, const char *fn) {
         goto out;
     }
 
-    /* Go to the position where the ID3v1 should be in the file. */
-    if(fseek(fp, -128, SEEK_END)) {
+    /* Find out what's at the end of the file already. */
+    if(ST_Tail_probe(fp, &tail)) {
         rv = ST_Error_errno;
         goto out_close;
     }
 
-    memset(&tag, 0, sizeof(tag));
+    /* If there's an Enhanced TAG+ block, keep it in sync with the tag, since
+       readers take the end of the longer fields from it. */
+    if(tail.tag_plus != -1) {
+        memcpy(&ext, ST_Tail_bytes(&tail, tail.tag_plus, 227), 227);
+        put_ext(ext.title, t->rec.title);
+        put_ext(ext.artist, t->rec.artist);
+        put_ext(ext.album, t->rec.album);
 
-    /* Read in what should be the magic header, if its there */
-    if(fread(tag.magic, 1, 3, fp) != 3) {
-        rv = ST_Error_errno;
-        goto out_close;
-    }
-
-    if(tag.magic[0] != 'T' || tag.magic[1] != 'A' || tag.magic[2] != 'G') {
-        /* No magic value, so we assume the tag isn't actually present. */
-        if(fseek(fp, 0, SEEK_END)) {
+        if(fseeko(fp, tail.tag_plus, SEEK_SET) ||
+           fwrite(&ext, 1, 227, fp) != 227) {
             rv = ST_Error_errno;
-            goto out_close;
+            goto out_release;
         }
-
-        tag.magic[0] = 'T';
-        tag.magic[1] = 'A';
-        tag.magic[2] = 'G';
     }
-    else {
-        /* We have a tag, reposition to the end so we overwrite the old tag. */
-        if(fseek(fp, -128, SEEK_END)) {
-            rv = ST_Error_errno;
-            goto out_close;
-        }
+
+    /* Overwrite the old tag if there is one, otherwise tack it on the end. */
+    if(fseeko(fp, tail.id3v1 != -1 ? tail.id3v1 : tail.file_size, SEEK_SET)) {
+        rv = ST_Error_errno;
+        goto out_release;
     }
 
+    memset(&tag, 0, sizeof(tag));
+    tag.magic[0] = 'T';
+    tag.magic[1] = 'A';
+    tag.magic[2] = 'G';
+
     /* Fill in the tag. */
-    COPY_IF_NOT_NULL(tag.title, t->title, 30);
-    COPY_IF_NOT_NULL(tag.artist, t->artist, 30);
-    COPY_IF_NOT_NULL(tag.album, t->album, 30);
-    COPY_IF_NOT_NULL(tag.comment_field.comment, t->comment, 30);
-    COPY_IF_NOT_NULL(tag.year, t->year, 4);
-    tag.genre = t->genre;
+    put_field(tag.title, t->rec.title, 30);
+    put_field(tag.artist, t->rec.artist, 30);
+    put_field(tag.album, t->rec.album, 30);
+    put_field(tag.comment_field.comment, t->rec.comment, 30);
+    put_field(tag.year, t->rec.year, 4);
+    tag.genre = t->rec.genre;
 
     /* Fill in the track if we have one */
-    if(t->track) {
+    if(t->rec.track) {
         tag.comment_field.v1_1.zero = 0;
-        tag.comment_field.v1_1.track = t->track;
+        tag.comment_field.v1_1.track = t->rec.track;
     }
 
     /* Write it out to the file... */
     if(fwrite(&tag, 1, 128, fp) != 128) {
         rv = ST_Error_errno;
-        goto out_close;
+        goto out_release;
     }
 
+out_release:
+    ST_Tail_release(&tail);
 out_close:
     fclose(fp);
 out:
@@ -269,7 +368,7 @@ ST_FUNC ST_Error ST_ID3v1_title(const ST_ID3v1 *tag, uint8_t *buf, size_t len) {
     if(!tag || tag->base.type != ST_TagType_ID3v1)
         return ST_Error_InvalidArgument;
 
-    COPY_IF_NOT_NULL_OR_ZERO((char *)buf, tag->title, len);
+    strncpy((char *)buf, tag->rec.title, len);
     return ST_Error_None;
 }
 
@@ -278,7 +377,7 @@ ST_FUNC ST_Error ST_ID3v1_artist(const ST_ID3v1 *tag, uint8_t *buf,
     if(!tag || tag->base.type != ST_TagType_ID3v1)
         return ST_Error_InvalidArgument;
 
-    COPY_IF_NOT_NULL_OR_ZERO((char *)buf, tag->artist, len);
+    strncpy((char *)buf, tag->rec.artist, len);
     return ST_Error_None;
 }
 
@@ -286,7 +385,7 @@ ST_FUNC ST_Error ST_ID3v1_album(const ST_ID3v1 *tag, uint8_t *buf, size_t len) {
     if(!tag || tag->base.type != ST_TagType_ID3v1)
         return ST_Error_InvalidArgument;
 
-    COPY_IF_NOT_NULL_OR_ZERO((char *)buf, tag->album, len);
+    strncpy((char *)buf, tag->rec.album, len);
     return ST_Error_None;
 }
 
@@ -295,7 +394,7 @@ ST_FUNC ST_Error ST_ID3v1_comment(const ST_ID3v1 *tag, uint8_t *buf,
     if(!tag || tag->base.type != ST_TagType_ID3v1)
         return ST_Error_InvalidArgument;
 
-    COPY_IF_NOT_NULL_OR_ZERO((char *)buf, tag->comment, len);
+    strncpy((char *)buf, tag->rec.comment, len);
     return ST_Error_None;
 }
 
@@ -303,7 +402,7 @@ ST_FUNC ST_Error ST_ID3v1_year(const ST_ID3v1 *tag, uint8_t *buf, size_t len) {
     if(!tag || tag->base.type != ST_TagType_ID3v1)
         return ST_Error_InvalidArgument;
 
-    COPY_IF_NOT_NULL_OR_ZERO((char *)buf, tag->year, len);
+    strncpy((char *)buf, tag->rec.year, len);
     return ST_Error_None;
 }
 
@@ -319,10 +418,10 @@ ST_FUNC CFStringRef ST_ID3v1_copyTitle(const ST_ID3v1 *tag, ST_Error *err) {
     if(err)
         *err = ST_Error_None;
 
-    if(!tag->title)
+    if(!tag->rec.title[0])
         return NULL;
 
-    return CFStringCreateWithCString(kCFAllocatorDefault, tag->title,
+    return CFStringCreateWithCString(kCFAllocatorDefault, tag->rec.title,
                                      kCFStringEncodingISOLatin1);
 }
 
@@ -337,10 +436,10 @@ ST_FUNC CFStringRef ST_ID3v1_copyArtist(const ST_ID3v1 *tag, ST_Error *err) {
     if(err)
         *err = ST_Error_None;
 
-    if(!tag->artist)
+    if(!tag->rec.artist[0])
         return NULL;
 
-    return CFStringCreateWithCString(kCFAllocatorDefault, tag->artist,
+    return CFStringCreateWithCString(kCFAllocatorDefault, tag->rec.artist,
                                      kCFStringEncodingISOLatin1);
 }
 
@@ -355,10 +454,10 @@ ST_FUNC CFStringRef ST_ID3v1_copyAlbum(const ST_ID3v1 *tag, ST_Error *err) {
     if(err)
         *err = ST_Error_None;
 
-    if(!tag->album)
+    if(!tag->rec.album[0])
         return NULL;
 
-    return CFStringCreateWithCString(kCFAllocatorDefault, tag->album,
+    return CFStringCreateWithCString(kCFAllocatorDefault, tag->rec.album,
                                      kCFStringEncodingISOLatin1);
 }
 
@@ -373,10 +472,10 @@ ST_FUNC CFStringRef ST_ID3v1_copyComment(const ST_ID3v1 *tag, ST_Error *err) {
     if(err)
         *err = ST_Error_None;
 
-    if(!tag->comment)
+    if(!tag->rec.comment[0])
         return NULL;
 
-    return CFStringCreateWithCString(kCFAllocatorDefault, tag->comment,
+    return CFStringCreateWithCString(kCFAllocatorDefault, tag->rec.comment,
                                      kCFStringEncodingISOLatin1);
 }
 
@@ -391,10 +490,10 @@ ST_FUNC CFStringRef ST_ID3v1_copyYear(const ST_ID3v1 *tag, ST_Error *err) {
     if(err)
         *err = ST_Error_None;
 
-    if(!tag->year)
+    if(!tag->rec.year[0])
         return NULL;
 
-    return CFStringCreateWithCString(kCFAllocatorDefault, tag->year,
+    return CFStringCreateWithCString(kCFAllocatorDefault, tag->rec.year,
                                      kCFStringEncodingISOLatin1);
 }
 #endif
@@ -402,66 +501,122 @@ ST_FUNC CFStringRef ST_ID3v1_copyYear(const ST_ID3v1 *tag, ST_Error *err) {
 ST_FUNC size_t ST_ID3v1_titleLength(const ST_ID3v1 *tag) {
     if(!tag || tag->base.type != ST_TagType_ID3v1)
         return (size_t)-1;
-    else if(!tag->title)
-        return 0;
 
-    return strlen(tag->title);
+    return strlen(tag->rec.title);
 }
 
 ST_FUNC size_t ST_ID3v1_artistLength(const ST_ID3v1 *tag) {
     if(!tag || tag->base.type != ST_TagType_ID3v1)
         return (size_t)-1;
-    else if(!tag->artist)
-        return 0;
 
-    return strlen(tag->artist);
+    return strlen(tag->rec.artist);
 }
 
 ST_FUNC size_t ST_ID3v1_albumLength(const ST_ID3v1 *tag) {
     if(!tag || tag->base.type != ST_TagType_ID3v1)
         return (size_t)-1;
-    else if(!tag->album)
-        return 0;
 
-    return strlen(tag->album);
+    return strlen(tag->rec.album);
 }
 
 ST_FUNC size_t ST_ID3v1_commentLength(const ST_ID3v1 *tag) {
     if(!tag || tag->base.type != ST_TagType_ID3v1)
         return (size_t)-1;
-    else if(!tag->comment)
-        return 0;
 
-    return strlen(tag->comment);
+    return strlen(tag->rec.comment);
 }
 
 ST_FUNC size_t ST_ID3v1_yearLength(const ST_ID3v1 *tag) {
     if(!tag || tag->base.type != ST_TagType_ID3v1)
         return (size_t)-1;
-    else if(!tag->year)
-        return 0;
 
-    return strlen(tag->year);
+    return strlen(tag->rec.year);
 }
 
 ST_FUNC ST_ID3v1_GenreCode ST_ID3v1_genre(const ST_ID3v1 *tag) {
     if(!tag || tag->base.type != ST_TagType_ID3v1)
         return ID3v1GenreError;
 
-    return (ST_ID3v1_GenreCode)tag->genre;
+    return (ST_ID3v1_GenreCode)tag->rec.genre;
+}
+
+ST_FUNC int ST_ID3v1_normalizedGenre(const ST_ID3v1 *tag, uint8_t *buf,
+                                     size_t len) {
+    const char *name;
+
+    if(buf && len)
+        buf[0] = 0;
+
+    if(!tag || tag->base.type != ST_TagType_ID3v1)
+        return ST_Genre_None;
+
+    /* Anything past the end of the list (usually 255) means there's no genre
+       set at all. */
+    if(!(name = ST_ID3v1_stringForGenre(tag->rec.genre)))
+        return ST_Genre_None;
+
+    if(buf)
+        ST_Text_copyUTF8((const uint8_t *)name, strlen(name), buf, len);
+
+    return tag->rec.genre;
 }
 
 ST_FUNC int ST_ID3v1_track(const ST_ID3v1 *tag) {
     if(!tag || tag->base.type != ST_TagType_ID3v1)
         return -1;
 
-    return (int)tag->track;
+    return (int)tag->rec.track;
 }
 
-static ST_Error setString(ST_ID3v1 *tag, char **ptr, const uint8_t *v,
-                          size_t len, ST_TextEncoding e) {
-    char *prev = *ptr;
+ST_FUNC ST_Error ST_ID3v1_get(const ST_ID3v1 *tag, ST_Field field,
+                              uint8_t *buf, size_t len) {
+    const char *s;
+
+    if(!tag || tag->base.type != ST_TagType_ID3v1 || !buf || !len)
+        return ST_Error_InvalidArgument;
+
+    buf[0] = 0;
 
+    switch(field) {
+        case ST_Field_Title:
+            s = tag->rec.title;
+            break;
+
+        case ST_Field_Artist:
+            s = tag->rec.artist;
+            break;
+
+        case ST_Field_Album:
+            s = tag->rec.album;
+            break;
+
+        case ST_Field_Comment:
+            s = tag->rec.comment;
+            break;
+
+        case ST_Field_Date:
+            s = tag->rec.year;
+            break;
+
+        case ST_Field_Genre:
+            return ST_Tag_getGenre((const ST_Tag *)tag, buf, len);
+
+        default:
+            if(field < 0 || field >= ST_Field_Count)
+                return ST_Error_InvalidArgument;
+
+            return ST_Error_NotFound;
+    }
+
+    if(!*s)
+        return ST_Error_NotFound;
+
+    return ST_Text_getUTF8((const uint8_t *)s, strlen(s),
+                           ST_TextEncoding_ISO8859_1, buf, len);
+}
+
+static ST_Error setString(ST_ID3v1 *tag, char *field, const uint8_t *v,
+                          size_t len, ST_TextEncoding e) {
     /* Make sure they aren't doing anything screwy */
     if(!tag || (!v && len) || tag->base.type != ST_TagType_ID3v1)
         return ST_Error_InvalidArgument;
@@ -470,41 +625,31 @@ static ST_Error setString(ST_ID3v1 *tag, char **ptr, const uint8_t *v,
     else if(len > 30)
         return ST_Error_InvalidArgument;
 
-    if(!v) {
-        free(prev);
-        *ptr = NULL;
-        return ST_Error_None;
-    }
+    if(v)
+        memcpy(field, v, len);
 
-    if((*ptr = (char *)malloc(len + 1))) {
-        memcpy(*ptr, v, len);
-        (*ptr)[len] = 0;
-        free(prev);
-        return ST_Error_None;
-    }
-
-    *ptr = prev;
-    return ST_Error_errno;
+    field[v ? len : 0] = 0;
+    return ST_Error_None;
 }
 
 ST_FUNC ST_Error ST_ID3v1_setTitle(ST_ID3v1 *tag, const uint8_t *v,
                                    size_t len, ST_TextEncoding e) {
-    return setString(tag, &tag->title, v, len, e);
+    return setString(tag, tag->rec.title, v, len, e);
 }
 
 ST_FUNC ST_Error ST_ID3v1_setArtist(ST_ID3v1 *tag, const uint8_t *v,
                                     size_t len, ST_TextEncoding e) {
-    return setString(tag, &tag->artist, v, len, e);
+    return setString(tag, tag->rec.artist, v, len, e);
 }
 
 ST_FUNC ST_Error ST_ID3v1_setAlbum(ST_ID3v1 *tag, const uint8_t *v,
                                    size_t len, ST_TextEncoding e) {
-    return setString(tag, &tag->album, v, len, e);
+    return setString(tag, tag->rec.album, v, len, e);
 }
 
 ST_FUNC ST_Error ST_ID3v1_setComment(ST_ID3v1 *tag, const uint8_t *v,
                                      size_t len, ST_TextEncoding e) {
-    return setString(tag, &tag->comment, v, len, e);
+    return setString(tag, tag->rec.comment, v, len, e);
 }
 
 /* Just in case someone tries to use this on a braindead system... */
@@ -524,14 +669,14 @@ ST_FUNC ST_Error ST_ID3v1_setYear(ST_ID3v1 *tag, const uint8_t *v,
     else if(v && len != 0)
         return ST_Error_InvalidArgument;
 
-    return setString(tag, &tag->year, v, len, e);
+    return setString(tag, tag->rec.year, v, len, e);
 }
 
 ST_FUNC ST_Error ST_ID3v1_setGenre(ST_ID3v1 *tag, ST_ID3v1_GenreCode v) {
     if(!tag || tag->base.type != ST_TagType_ID3v1)
         return ST_Error_InvalidArgument;
 
-    tag->genre = v;
+    tag->rec.genre = v;
     return ST_Error_None;
 }
 
@@ -539,28 +684,27 @@ ST_FUNC ST_Error ST_ID3v1_setTrack(ST_ID3v1 *tag, int v) {
     if(!tag || tag->base.type != ST_TagType_ID3v1)
         return ST_Error_InvalidArgument;
 
-    tag->track = (uint8_t)v;
+    tag->rec.track = (uint8_t)v;
     return ST_Error_None;
 }
 
 #ifdef ST_HAVE_COREFOUNDATION
-static ST_Error setCFString(ST_ID3v1 *tag, char **ptr, CFStringRef s) {
-    char *prev = *ptr;
+static ST_Error setCFString(ST_ID3v1 *tag, char *field, CFStringRef s) {
     const char *str;
     char tmp[31];
 
     /* Make sure they aren't doing anything screwy */
     if(!tag || tag->base.type != ST_TagType_ID3v1)
         return ST_Error_InvalidArgument;
-    else if(CFStringGetLength(s) > 30)
-        return ST_Error_InvalidArgument;
 
     if(!s) {
-        free(prev);
-        *ptr = NULL;
+        field[0] = 0;
         return ST_Error_None;
     }
 
+    if(CFStringGetLength(s) > 30)
+        return ST_Error_InvalidArgument;
+
     /* Grab the ISO-8859-1 representation of the string */
     if(!(str = CFStringGetCStringPtr(s, kCFStringEncodingISOLatin1))) {
         if(!CFStringGetCString(s, tmp, 31, kCFStringEncodingISOLatin1))
@@ -574,48 +718,42 @@ static ST_Error setCFString(ST_ID3v1 *tag, char **ptr, CFStringRef s) {
         return ST_Error_InvalidArgument;
 
     /* Copy it in */
-    if((*ptr = strdup(str))) {
-        free(prev);
-        return ST_Error_None;
-    }
-
-    *ptr = prev;
-    return ST_Error_errno;
+    strcpy(field, str);
+    return ST_Error_None;
 }
 
 ST_FUNC ST_Error ST_ID3v1_setTitleStr(ST_ID3v1 *tag, CFStringRef str) {
-    return setCFString(tag, &tag->title, str);
+    return setCFString(tag, tag->rec.title, str);
 }
 
 ST_FUNC ST_Error ST_ID3v1_setArtistStr(ST_ID3v1 *tag, CFStringRef str) {
-    return setCFString(tag, &tag->artist, str);
+    return setCFString(tag, tag->rec.artist, str);
 }
 
 ST_FUNC ST_Error ST_ID3v1_setAlbumStr(ST_ID3v1 *tag, CFStringRef str) {
-    return setCFString(tag, &tag->album, str);
+    return setCFString(tag, tag->rec.album, str);
 }
 
 ST_FUNC ST_Error ST_ID3v1_setCommentStr(ST_ID3v1 *tag, CFStringRef str) {
-    return setCFString(tag, &tag->comment, str);
+    return setCFString(tag, tag->rec.comment, str);
 }
 
 ST_FUNC ST_Error ST_ID3v1_setYearStr(ST_ID3v1 *tag, CFStringRef s) {
-    char *prev = tag->year;
     const char *str;
     char tmp[5];
 
     /* Make sure they aren't doing anything screwy */
     if(!tag || tag->base.type != ST_TagType_ID3v1)
         return ST_Error_InvalidArgument;
-    else if(CFStringGetLength(s) != 4)
-        return ST_Error_InvalidArgument;
 
     if(!s) {
-        free(tag->year);
-        tag->year = NULL;
+        tag->rec.year[0] = 0;
         return ST_Error_None;
     }
 
+    if(CFStringGetLength(s) != 4)
+        return ST_Error_InvalidArgument;
+
     /* Grab the ISO-8859-1 representation of the string */
     if(!(str = CFStringGetCStringPtr(s, kCFStringEncodingISOLatin1))) {
         if(!CFStringGetCString(s, tmp, 5, kCFStringEncodingISOLatin1))
@@ -630,13 +768,8 @@ ST_FUNC ST_Error ST_ID3v1_setYearStr(ST_ID3v1 *tag, CFStringRef s) {
         return ST_Error_InvalidArgument;
 
     /* Copy it in */
-    if((tag->year = strdup(str))) {
-        free(prev);
-        return ST_Error_None;
-    }
-
-    tag->year = prev;
-    return ST_Error_errno;
+    strcpy(tag->rec.year, str);
+    return ST_Error_None;
 }
 #endif
 
@@ -725,14 +858,14 @@ ST_FUNC CFDictionaryRef ST_ID3v1_copyDictionary(const ST_ID3v1 *tag) {
             CFRelease(tmp);
         }
 
-        if((tmp = ST_ID3v1_createStringForGenre(tag->genre))) {
+        if((tmp = ST_ID3v1_createStringForGenre(tag->rec.genre))) {
             CFDictionaryAddValue(rv, gstr, tmp);
             CFRelease(tmp);
         }
 
-        if(tag->track && (tmp = CFStringCreateWithFormat(kCFAllocatorDefault,
-                                                         NULL, tkfmt,
-                                                         tag->track))) {
+        if(tag->rec.track &&
+           (tmp = CFStringCreateWithFormat(kCFAllocatorDefault, NULL, tkfmt,
+                                           tag->rec.track))) {
             CFDictionaryAddValue(rv, tkstr, tmp);
             CFRelease(tmp);
         }
@@ -25,12 +25,13 @@
 #include <string.h>
 
 #include "SonatinaTag/Error.h"
+#include "SonatinaTag/Allocator.h"
 #include "Frame.h"
 
 static void free_comment(ST_CommentFrame *f) {
-    free(f->desc);
-    free(f->string);
-    free(f);
+    ST_free(f->desc);
+    ST_free(f->string);
+    ST_free(f);
 }
 
 ST_FUNC ST_CommentFrame *ST_ID3v2_CommentFrame_create(ST_TextEncoding enc,
@@ -50,20 +51,20 @@ ST_FUNC ST_CommentFrame *ST_ID3v2_CommentFrame_create(ST_TextEncoding enc,
     if(strlen(lang) != 3)
         return NULL;
 
-    if((rv = (ST_CommentFrame *)malloc(sizeof(ST_CommentFrame)))) {
+    if((rv = (ST_CommentFrame *)ST_malloc(sizeof(ST_CommentFrame)))) {
         rv->base.type = ST_FrameType_Comment;
         rv->base.dtor = (void (*)(ST_Frame *))free_comment;
         rv->encoding = enc;
         rv->string_size = sl;
 
-        if(!(rv->string = (uint8_t *)malloc(sl))) {
-            free(rv);
+        if(!(rv->string = (uint8_t *)ST_malloc(sl))) {
+            ST_free(rv);
             return NULL;
         }
 
-        if(!(rv->desc = (uint8_t *)malloc(dl))) {
-            free(rv->string);
-            free(rv);
+        if(!(rv->desc = (uint8_t *)ST_malloc(dl))) {
+            ST_free(rv->string);
+            ST_free(rv);
             return NULL;
         }
 
@@ -115,7 +116,7 @@ ST_LOCAL ST_CommentFrame *ST_ID3v2_CommentFrame_create_buf(const uint8_t *buf,
     if(sz < 1 || buf[0] > (uint8_t)ST_TextEncoding_UTF8)
         return NULL;
 
-    if((rv = (ST_CommentFrame *)malloc(sizeof(ST_CommentFrame)))) {
+    if((rv = (ST_CommentFrame *)ST_malloc(sizeof(ST_CommentFrame)))) {
         rv->base.type = ST_FrameType_Comment;
         rv->base.dtor = (void (*)(ST_Frame *))free_comment;
         rv->encoding = (ST_TextEncoding)buf[0];
@@ -132,18 +133,18 @@ ST_LOCAL ST_CommentFrame *ST_ID3v2_CommentFrame_create_buf(const uint8_t *buf,
 
         /* Sanity check... */
         if(rv->desc_size == (uint32_t)-1 || rv->string_size == (uint32_t)-1) {
-            free(rv);
+            ST_free(rv);
             return NULL;
         }
 
-        if(!(rv->desc = (uint8_t *)malloc(rv->desc_size))) {
-            free(rv);
+        if(!(rv->desc = (uint8_t *)ST_malloc(rv->desc_size))) {
+            ST_free(rv);
             return NULL;
         }
 
-        if(!(rv->string = (uint8_t *)malloc(rv->string_size))) {
-            free(rv->desc);
-            free(rv);
+        if(!(rv->string = (uint8_t *)ST_malloc(rv->string_size))) {
+            ST_free(rv->desc);
+            ST_free(rv);
             return NULL;
         }
 
@@ -224,13 +225,13 @@ ST_FUNC ST_Error ST_ID3v2_CommentFrame_setText(ST_CommentFrame *f,
         return ST_Error_InvalidArgument;
 
     if(!own_buf) {
-        if(!(tmp = (uint8_t *)malloc((size_t)str_sz)))
+        if(!(tmp = (uint8_t *)ST_malloc((size_t)str_sz)))
             return ST_Error_errno;
 
         memcpy(tmp, str, str_sz);
     }
 
-    free(f->string);
+    ST_free(f->string);
     f->string = tmp;
     f->string_size = str_sz;
     f->encoding = enc;
@@ -247,13 +248,13 @@ ST_FUNC ST_Error ST_ID3v2_CommentFrame_setDesc(ST_CommentFrame *f,
         return ST_Error_InvalidArgument;
 
     if(!own_buf) {
-        if(!(tmp = (uint8_t *)malloc((size_t)desc_sz)))
+        if(!(tmp = (uint8_t *)ST_malloc((size_t)desc_sz)))
             return ST_Error_errno;
 
         memcpy(tmp, desc, desc_sz);
     }
 
-    free(f->desc);
+    ST_free(f->desc);
     f->desc = tmp;
     f->desc_size = desc_sz;
 
@@ -290,14 +291,14 @@ ST_FUNC ST_CommentFrame *ST_ID3v2_CommentFrame_createStr(CFStringRef str,
     slen = CFStringGetLength(str);
     l = CFStringGetMaximumSizeForEncoding(slen, encs[e]);
 
-    if(!(buf = (uint8_t *)malloc(l)))
+    if(!(buf = (uint8_t *)ST_malloc(l)))
         return NULL;
 
     CFStringGetBytes(str, CFRangeMake(0, slen), encs[e], 0, ext, buf, l, &slen);
 
     /* Attempt to make it smaller */
     if(slen != l) {
-        if((tmp = realloc(buf, slen)))
+        if((tmp = ST_realloc(buf, slen)))
             buf = (uint8_t *)tmp;
     }
 
@@ -305,8 +306,8 @@ ST_FUNC ST_CommentFrame *ST_ID3v2_CommentFrame_createStr(CFStringRef str,
     dlen = CFStringGetLength(desc);
     l = CFStringGetMaximumSizeForEncoding(dlen, encs[e]);
 
-    if(!(dbuf = (uint8_t *)malloc(l))) {
-        free(buf);
+    if(!(dbuf = (uint8_t *)ST_malloc(l))) {
+        ST_free(buf);
         return NULL;
     }
 
@@ -314,11 +315,11 @@ ST_FUNC ST_CommentFrame *ST_ID3v2_CommentFrame_createStr(CFStringRef str,
                      &dlen);
 
     if(dlen != l) {
-        if((tmp = realloc(dbuf, dlen)))
+        if((tmp = ST_realloc(dbuf, dlen)))
             dbuf = (uint8_t *)tmp;
     }
 
-    if((rv = (ST_CommentFrame *)malloc(sizeof(ST_CommentFrame)))) {
+    if((rv = (ST_CommentFrame *)ST_malloc(sizeof(ST_CommentFrame)))) {
         rv->base.type = ST_FrameType_Comment;
         rv->base.dtor = (void (*)(ST_Frame *))free_comment;
         rv->encoding = e;
@@ -330,8 +331,8 @@ ST_FUNC ST_CommentFrame *ST_ID3v2_CommentFrame_createStr(CFStringRef str,
         rv->language[3] = 0;
     }
     else {
-        free(buf);
-        free(dbuf);
+        ST_free(buf);
+        ST_free(dbuf);
     }
 
     return rv;
@@ -366,7 +367,7 @@ static ST_Error set_str(ST_CommentFrame *f, CFStringRef s, uint8_t **ptr,
     slen = CFStringGetLength(s);
     l = CFStringGetMaximumSizeForEncoding(slen, encs[f->encoding]);
 
-    if(!(buf = (uint8_t *)malloc(l)))
+    if(!(buf = (uint8_t *)ST_malloc(l)))
         return ST_Error_errno;
 
     CFStringGetBytes(s, CFRangeMake(0, slen), encs[f->encoding], 0,
@@ -374,11 +375,11 @@ static ST_Error set_str(ST_CommentFrame *f, CFStringRef s, uint8_t **ptr,
 
     /* Attempt to make it smaller */
     if(slen != l) {
-        if((tmp = realloc(buf, slen)))
+        if((tmp = ST_realloc(buf, slen)))
             buf = (uint8_t *)tmp;
     }
 
-    free(*ptr);
+    ST_free(*ptr);
     *sz = slen;
     *ptr = buf;
 
@@ -25,15 +25,16 @@
 #include <string.h>
 
 #include "SonatinaTag/Error.h"
+#include "SonatinaTag/Allocator.h"
 #include "Frame.h"
 
 static void free_generic(ST_GenericFrame *f) {
-    free(f->data);
-    free(f);
+    ST_free(f->data);
+    ST_free(f);
 }
 
 ST_FUNC ST_GenericFrame *ST_ID3v2_GenericFrame_create(uint32_t sz, uint8_t *d) {
-    ST_GenericFrame *rv = (ST_GenericFrame *)malloc(sizeof(ST_GenericFrame));
+    ST_GenericFrame *rv = (ST_GenericFrame *)ST_malloc(sizeof(ST_GenericFrame));
 
     if(rv) {
         rv->base.type = ST_FrameType_Generic;
@@ -67,13 +68,13 @@ ST_FUNC ST_Error ST_ID3v2_GenericFrame_setData(ST_GenericFrame *f, uint32_t sz,
         return ST_Error_InvalidArgument;
 
     if(!own_buf) {
-        if(!(tmp = (uint8_t *)malloc((size_t)sz)))
+        if(!(tmp = (uint8_t *)ST_malloc((size_t)sz)))
             return ST_Error_errno;
 
         memcpy(tmp, d, sz);
     }
 
-    free(f->data);
+    ST_free(f->data);
     f->data = tmp;
     f->size = sz;
 
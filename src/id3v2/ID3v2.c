@@ -26,8 +26,10 @@
 
 #include "SonatinaTag/SonatinaTag.h"
 #include "SonatinaTag/Tags/ID3v2.h"
+#include "SonatinaTag/Allocator.h"
 #include "Frame.h"
 #include "../base/Tag.h"
+#include "../utils/Text.h"
 
 struct ST_ID3v2_struct {
     ST_Tag base;
@@ -35,6 +37,12 @@ struct ST_ID3v2_struct {
     uint8_t revision;
     uint8_t flags;
     ST_Dict *frames;
+
+    /* First frame for each of the well-known fields. These point at frames
+       owned by the frames dictionary. While a file is being parsed, these are
+       left alone until all the frames are in. */
+    const ST_Frame *fields[ST_Field_Count];
+    int parsing;
 };
 
 #define STTAGID3V2_FLAG_UNSYNC  (1 << 7)
@@ -55,17 +63,116 @@ struct ST_ID3v2_struct {
 /* Forward declarations */
 static int parse_file(ST_ID3v2 *tag, FILE *fp);
 
+/* Where each of the well-known fields comes from: the frames to look in (in
+   order of preference), for ID3v2.3/2.4 and for ID3v2.2. If desc is set, only
+   a TXXX frame with that description or a UFID frame with that owner will do.
+   These get resolved when frames are added or removed, so that ST_ID3v2_get
+   doesn't have to go through the dictionary every time. */
+typedef struct field_src_s {
+    ST_ID3v2_FrameCode code[2];
+    ST_ID3v2_FrameCode code22[2];
+    const char *desc;
+} field_src_t;
+
+static const field_src_t field_srcs[ST_Field_Count] = {
+    { { ST_FrameTitle }, { ST_Frame22Title }, NULL },
+    { { ST_FrameLeadPerformer }, { ST_Frame22LeadPerformer }, NULL },
+    { { ST_FrameAlbumTitle }, { ST_Frame22AlbumTitle }, NULL },
+    { { ST_FrameAccompaniment }, { ST_Frame22Accompaniment }, NULL },
+    { { ST_FrameComments }, { ST_Frame22Comments }, NULL },
+    { { ST_FrameRecordingTime, ST_FrameYear }, { ST_Frame22Year }, NULL },
+    { { ST_FrameContentType }, { ST_Frame22ContentType }, NULL },
+    { { ST_FrameComposer }, { ST_Frame22Composer }, NULL },
+    { { ST_FrameUserText }, { ST_Frame22UserText }, "REPLAYGAIN_TRACK_GAIN" },
+    { { ST_FrameUserText }, { ST_Frame22UserText }, "REPLAYGAIN_TRACK_PEAK" },
+    { { ST_FrameUserText }, { ST_Frame22UserText }, "REPLAYGAIN_ALBUM_GAIN" },
+    { { ST_FrameUserText }, { ST_Frame22UserText }, "REPLAYGAIN_ALBUM_PEAK" },
+    { { ST_FrameUniqueFileIdent }, { ST_Frame22UniqueFileIdent },
+      "http://musicbrainz.org" },
+    { { ST_FrameUserText }, { ST_Frame22UserText }, "MusicBrainz Album Id" },
+    { { ST_FrameUserText }, { ST_Frame22UserText }, "MusicBrainz Artist Id" },
+    { { ST_FrameUserText }, { ST_Frame22UserText },
+      "MusicBrainz Album Artist Id" },
+    { { ST_FrameUserText }, { ST_Frame22UserText },
+      "MusicBrainz Release Group Id" }
+};
+
+/* Does a TXXX or UFID frame have the given description (or owner)? */
+static int desc_matches(const ST_Frame *frame, const char *desc) {
+    const ST_UserTextFrame *utf;
+    const ST_GenericFrame *gf;
+    uint8_t tmp[64];
+    size_t n = strlen(desc);
+
+    if(frame->type == ST_FrameType_UserText) {
+        utf = (const ST_UserTextFrame *)frame;
+
+        if(ST_Text_toUTF8(utf->desc, utf->desc_size, utf->encoding, tmp,
+                          sizeof(tmp)) != n)
+            return 0;
+
+        return !strncasecmp((const char *)tmp, desc, n);
+    }
+    else if(frame->type == ST_FrameType_Generic) {
+        gf = (const ST_GenericFrame *)frame;
+        return gf->size > n && !memcmp(gf->data, desc, n + 1);
+    }
+
+    return 0;
+}
+
+static void resolve_field(ST_ID3v2 *tag, int id) {
+    const field_src_t *src = &field_srcs[id];
+    const ST_ID3v2_FrameCode *codes;
+    const void **value;
+    int i, j, count;
+
+    codes = (tag->majorver == 2) ? src->code22 : src->code;
+    tag->fields[id] = NULL;
+
+    for(i = 0; i < 2 && codes[i]; ++i) {
+        if(!(value = ST_Dict_find(tag->frames, &codes[i], &count)))
+            continue;
+
+        for(j = 0; j < count; ++j) {
+            if(!src->desc || desc_matches((const ST_Frame *)value[j],
+                                          src->desc)) {
+                tag->fields[id] = (const ST_Frame *)value[j];
+                return;
+            }
+        }
+    }
+}
+
+/* Re-resolve any well-known fields that come from the given frame, after
+   frames with that code have been added or removed. */
+static void update_field(ST_ID3v2 *tag, ST_ID3v2_FrameCode code) {
+    int i;
+
+    if(tag->parsing)
+        return;
+
+    for(i = 0; i < ST_Field_Count; ++i) {
+        if(field_srcs[i].code[0] == code || field_srcs[i].code[1] == code ||
+           field_srcs[i].code22[0] == code || field_srcs[i].code22[1] == code)
+            resolve_field(tag, i);
+    }
+}
+
 ST_FUNC ST_ID3v2 *ST_ID3v2_create(void) {
-    ST_ID3v2 *rv = (ST_ID3v2 *)malloc(sizeof(ST_ID3v2));
+    ST_ID3v2 *rv = (ST_ID3v2 *)ST_malloc(sizeof(ST_ID3v2));
     void (*f)(void *) = (void (*)(void *))ST_ID3v2_Frame_free;
 
     if(rv) {
         if(!(rv->frames = ST_Dict_createUint32(10, f))) {
-            free(rv);
+            ST_free(rv);
             return NULL;
         }
 
+        memset(rv->fields, 0, sizeof(rv->fields));
+        rv->parsing = 0;
         rv->base.type = ST_TagType_ID3v2;
+        rv->base.arena = NULL;
     }
 
     return rv;
@@ -75,10 +182,15 @@ ST_FUNC void ST_ID3v2_free(ST_ID3v2 *tag) {
     if(!tag || tag->base.type != ST_TagType_ID3v2)
         return;
 
+    if(tag->base.arena) {
+        ST_Arena_free(tag->base.arena);
+        return;
+    }
+
     /* Clean up the dictionary. This will free all the values in it too. */
     ST_Dict_free(tag->frames);
 
-    free(tag);
+    ST_free(tag);
 }
 
 ST_FUNC ST_ID3v2 *ST_ID3v2_createFromFile(const char *fn) {
@@ -95,14 +207,30 @@ ST_FUNC ST_ID3v2 *ST_ID3v2_createFromFile(const char *fn) {
     }
 
     if(!parse_file(rv, fp)) {
+        fclose(fp);
         return rv;
     }
 
+    fclose(fp);
+
 out_free:
     ST_ID3v2_free(rv);
     return NULL;
 }
 
+ST_LOCAL ST_ID3v2 *ST_ID3v2_createFromStream(FILE *fp) {
+    ST_ID3v2 *rv;
+
+    if(fseeko(fp, 0, SEEK_SET) || !(rv = ST_ID3v2_create()))
+        return NULL;
+
+    if(!parse_file(rv, fp))
+        return rv;
+
+    ST_ID3v2_free(rv);
+    return NULL;
+}
+
 ST_FUNC const ST_Frame *ST_ID3v2_frameForKey(const ST_ID3v2 *tag,
                                              ST_ID3v2_FrameCode code,
                                              int index) {
@@ -200,18 +328,28 @@ ST_FUNC CFDictionaryRef ST_ID3v2_copyDictionary(const ST_ID3v2 *tag) {
 
 ST_FUNC ST_Error ST_ID3v2_addFrame(ST_ID3v2 *tag, ST_ID3v2_FrameCode code,
                                    ST_Frame *frame) {
+    ST_Error rv;
+
     if(!tag || !frame || tag->base.type != ST_TagType_ID3v2)
         return ST_Error_InvalidArgument;
 
-    return ST_Dict_add(tag->frames, &code, frame);
+    if((rv = ST_Dict_add(tag->frames, &code, frame)) == ST_Error_None)
+        update_field(tag, code);
+
+    return rv;
 }
 
 ST_FUNC ST_Error ST_ID3v2_removeFrame(ST_ID3v2 *tag, ST_ID3v2_FrameCode code,
                                       int index) {
+    ST_Error rv;
+
     if(!tag || index < -1 || tag->base.type != ST_TagType_ID3v2)
         return ST_Error_InvalidArgument;
 
-    return ST_Dict_remove(tag->frames, &code, index);
+    if((rv = ST_Dict_remove(tag->frames, &code, index)) == ST_Error_None)
+        update_field(tag, code);
+
+    return rv;
 }
 
 static ST_Error frameText(const ST_ID3v2 *tag, ST_ID3v2_FrameCode code,
@@ -388,6 +526,96 @@ ST_FUNC ST_Error ST_ID3v2_genre(const ST_ID3v2 *tag, uint8_t *buf, size_t len) {
     return frameText(tag, ST_FrameContentType, ST_Frame22ContentType, buf, len);
 }
 
+ST_FUNC int ST_ID3v2_normalizedGenre(const ST_ID3v2 *tag, uint8_t *buf,
+                                     size_t len) {
+    const ST_Frame *f;
+    const ST_TextFrame *tf;
+    uint8_t tmp[256];
+    size_t n;
+
+    if(buf && len)
+        buf[0] = 0;
+
+    if(!tag || tag->base.type != ST_TagType_ID3v2)
+        return ST_Genre_None;
+
+    f = tag->fields[ST_Field_Genre];
+
+    if(!f || f->type != ST_FrameType_Text)
+        return ST_Genre_None;
+
+    /* Genres are short, so just hang onto the first bit of the frame. */
+    tf = (const ST_TextFrame *)f;
+    n = ST_Text_toUTF8(tf->string, tf->size, tf->encoding, tmp, sizeof(tmp));
+    return ST_Genre_normalize(tmp, n, buf, len);
+}
+
+ST_FUNC ST_Error ST_ID3v2_get(const ST_ID3v2 *tag, ST_Field field,
+                              uint8_t *buf, size_t len) {
+    const ST_Frame *f;
+    const uint8_t *s, *end;
+    size_t sz;
+    ST_TextEncoding enc;
+
+    if(!tag || tag->base.type != ST_TagType_ID3v2 || !buf || !len ||
+       field < 0 || field >= ST_Field_Count)
+        return ST_Error_InvalidArgument;
+
+    buf[0] = 0;
+
+    /* Genres get cleaned up, since they might just be a number. */
+    if(field == ST_Field_Genre) {
+        return ST_Tag_getGenre((const ST_Tag *)tag, buf, len);
+    }
+
+    if(!(f = tag->fields[field]))
+        return ST_Error_NotFound;
+
+    switch(f->type) {
+        case ST_FrameType_Text:
+            s = ((const ST_TextFrame *)f)->string;
+            sz = ((const ST_TextFrame *)f)->size;
+            enc = ((const ST_TextFrame *)f)->encoding;
+            break;
+
+        case ST_FrameType_UserText:
+            s = ((const ST_UserTextFrame *)f)->string;
+            sz = ((const ST_UserTextFrame *)f)->string_size;
+            enc = ((const ST_UserTextFrame *)f)->encoding;
+            break;
+
+        case ST_FrameType_Comment:
+            s = ((const ST_CommentFrame *)f)->string;
+            sz = ((const ST_CommentFrame *)f)->string_size;
+            enc = ((const ST_CommentFrame *)f)->encoding;
+            break;
+
+        case ST_FrameType_Generic:
+            /* A UFID frame: the owner, a NUL, and then the identifier. */
+            s = ((const ST_GenericFrame *)f)->data;
+            sz = ((const ST_GenericFrame *)f)->size;
+
+            if(!(end = (const uint8_t *)memchr(s, 0, sz)))
+                return ST_Error_NotFound;
+
+            sz -= end + 1 - s;
+            s = end + 1;
+            enc = ST_TextEncoding_ISO8859_1;
+            break;
+
+        default:
+            return ST_Error_NotFound;
+    }
+
+    /* Only the first value of a multi-valued ID3v2.4 frame is returned. */
+    sz = ST_Text_firstLength(s, sz, enc);
+
+    if(!sz)
+        return ST_Error_NotFound;
+
+    return ST_Text_getUTF8(s, sz, enc, buf, len);
+}
+
 /* Just in case someone gets the brilliant idea to use this on a braindead
    system... */
 static int my_atoi(uint8_t *buf) {
@@ -476,6 +704,53 @@ ST_FUNC int ST_ID3v2_disc(const ST_ID3v2 *tag) {
     return frameNumber(tag, ST_FramePartOfSet, ST_Frame22PartOfSet);
 }
 
+/* Get the total out of a frame of the form "number/total". */
+static int frameTotal(const ST_ID3v2 *tag, ST_ID3v2_FrameCode code,
+                      ST_ID3v2_FrameCode code22) {
+    const ST_Frame *f;
+    const ST_TextFrame *tf;
+    uint8_t tmp[32];
+    const char *slash;
+
+    if(!tag || tag->base.type != ST_TagType_ID3v2)
+        return -1;
+
+    if(tag->majorver == 2)
+        code = code22;
+
+    if(!(f = ST_ID3v2_frameForKey(tag, code, 0)) ||
+       f->type != ST_FrameType_Text)
+        return -1;
+
+    tf = (const ST_TextFrame *)f;
+    ST_Text_toUTF8(tf->string, tf->size, tf->encoding, tmp, sizeof(tmp));
+
+    if(!(slash = strchr((const char *)tmp, '/')))
+        return -1;
+
+    return atoi(slash + 1);
+}
+
+ST_FUNC int ST_ID3v2_trackCount(const ST_ID3v2 *tag) {
+    return frameTotal(tag, ST_FrameTrackNumber, ST_Frame22TrackNumber);
+}
+
+ST_FUNC int ST_ID3v2_discCount(const ST_ID3v2 *tag) {
+    return frameTotal(tag, ST_FramePartOfSet, ST_Frame22PartOfSet);
+}
+
+ST_FUNC uint64_t ST_ID3v2_durationMs(const ST_ID3v2 *tag) {
+    int ms;
+
+    if(!tag || tag->base.type != ST_TagType_ID3v2)
+        return (uint64_t)-1;
+
+    if((ms = frameNumber(tag, ST_FrameLength, ST_Frame22Length)) <= 0)
+        return 0;
+
+    return (uint64_t)ms;
+}
+
 ST_FUNC const ST_Picture *ST_ID3v2_picture(const ST_ID3v2 *tag,
                                            ST_PictureType pt, int index) {
     const void **value;
@@ -623,6 +898,8 @@ static ST_Error replaceText(ST_ID3v2 *tag, ST_ID3v2_FrameCode k,
 
     if(rv != ST_Error_None)
         ST_ID3v2_Frame_free(frame);
+    else
+        update_field(tag, k);
 
     return rv;
 }
@@ -697,6 +974,8 @@ static ST_Error replaceTextStr(ST_ID3v2 *tag, ST_ID3v2_FrameCode k,
 
     if(rv != ST_Error_None)
         ST_ID3v2_Frame_free(frame);
+    else
+        update_field(tag, k);
 
     return rv;
 }
@@ -811,25 +1090,30 @@ static int parse_file(ST_ID3v2 *tag, FILE *fp) {
     uint32_t size;
     uint32_t (*szf)(const uint8_t *) = &parse_size_23;
     uint8_t *frame;
-    int shouldfree;
+    int shouldfree, i;
+
+    /* Don't bother working out the well-known fields until all the frames are
+       in. Doing it for every frame added would mean looking through all the
+       TXXX frames again for each new one. */
+    tag->parsing = 1;
 
     /* Assume for now that ID3v2 tags exist at the beginning of the file... */
     if(fread(buf, 1, 3, fp) != 3)
-        goto out_close;
+        goto out_err;
 
     /* Check for the ID3 signature */
     if(memcmp("ID3", buf, 3))
         /* No ID3 tag at the beginning, fail */
-        goto out_close;
+        goto out_err;
 
     /* We now "know" that there is an ID3 tag here, parse the rest of the ID3
        header to figure out what else we have to do */
     if(fread(buf, 1, 2, fp) != 2)
-        goto out_close;
+        goto out_err;
 
     /* Support is here for 2.2-2.4 */
     if(buf[0] < 2 || buf[0] > 4)
-        goto out_close;
+        goto out_err;
 
     tag->majorver = majorver = buf[0];
     tag->revision = revision = buf[1];
@@ -841,18 +1125,18 @@ static int parse_file(ST_ID3v2 *tag, FILE *fp) {
 
     /* Grab the flags from the ID3 header */
     if(fread(&tag->flags, 1, 1, fp) != 1)
-        goto out_close;
+        goto out_err;
 
     /* Make sure no unknown flags are set */
     if((majorver == 2 && (tag->flags & ~(STTAGID3V2_FLAG_MASK_22))) ||
        (majorver == 3 && (tag->flags & ~(STTAGID3V2_FLAG_MASK_23))) ||
        (majorver == 4 && (tag->flags & ~(STTAGID3V2_FLAG_MASK_24))))
-        goto out_close;
+        goto out_err;
 
 #if 0
     /* We don't handle the unsynchronization setting just yet... */
     if(tag->flags & STTAGID3V2_FLAG_UNSYNC)
-        goto out_close;
+        goto out_err;
 #endif
 
     /* The footer isn't handled either... */
@@ -862,7 +1146,7 @@ static int parse_file(ST_ID3v2 *tag, FILE *fp) {
 
     /* Read in the length of the header */
     if(fread(buf, 1, 4, fp) != 4)
-        goto out_close;
+        goto out_err;
 
     /* The length is always encoded in the same way as lengths in v2.4 */
     size = parse_size_24(buf);
@@ -872,7 +1156,7 @@ static int parse_file(ST_ID3v2 *tag, FILE *fp) {
         uint32_t sz2;
 
         if(fread(buf, 1, 4, fp) != 4)
-            goto out_close;
+            goto out_err;
 
         sz2 = szf(buf);
 
@@ -886,7 +1170,7 @@ static int parse_file(ST_ID3v2 *tag, FILE *fp) {
     while(start < size) {
         if(majorver > 2) {
             if(fread(buf, 1, 10, fp) != 10)
-                goto out_close;
+                goto out_err;
 
             fcc = (buf[0] << 24) | (buf[1] << 16) | (buf[2] << 8) | buf[3];
             sz = szf(buf + 4);
@@ -895,7 +1179,7 @@ static int parse_file(ST_ID3v2 *tag, FILE *fp) {
         }
         else {
             if(fread(buf, 1, 6, fp) != 6)
-                goto out_close;
+                goto out_err;
 
             if(buf[0] || buf[1] || buf[2])
                 fcc = (buf[0] << 24) | (buf[1] << 16) | (buf[2] << 8) | ' ';
@@ -912,18 +1196,18 @@ static int parse_file(ST_ID3v2 *tag, FILE *fp) {
             break;
 
         if(sz == 0 || sz == (uint32_t)-1)
-            goto out_close;
+            goto out_err;
 
         /* Make sure we only have ID3v2.2 "four" character codes in ID3v2.2 */
         if(majorver > 2 && (fcc & 0xFF) == ' ')
-            goto out_close;
+            goto out_err;
 
         /* Allocate space for the raw frame and read it in*/
-        if(!(frame = (uint8_t *)malloc((size_t)sz)))
-            goto out_close;
+        if(!(frame = (uint8_t *)ST_malloc((size_t)sz)))
+            goto out_err;
 
         if(fread(frame, 1, (size_t)sz, fp) != (size_t)sz)
-            goto out_close;
+            goto out_err;
 
         start += sz;
 
@@ -934,12 +1218,12 @@ static int parse_file(ST_ID3v2 *tag, FILE *fp) {
             ST_TextFrame *tframe;
 
             if(!(tframe = ST_ID3v2_TextFrame_create_buf(frame, sz)))
-                goto out_close;
+                goto out_err;
 
             tframe->base.flags = flags;
 
             if(ST_ID3v2_addFrame(tag, fcc, &tframe->base) != ST_Error_None)
-                goto out_close;
+                goto out_err;
 
             shouldfree = 1;
         }
@@ -947,12 +1231,12 @@ static int parse_file(ST_ID3v2 *tag, FILE *fp) {
             ST_UserTextFrame *utframe;
 
             if(!(utframe = ST_ID3v2_UserTextFrame_create_buf(frame, sz)))
-                goto out_close;
+                goto out_err;
 
             utframe->base.flags = flags;
 
             if(ST_ID3v2_addFrame(tag, fcc, &utframe->base) != ST_Error_None)
-                goto out_close;
+                goto out_err;
 
             shouldfree = 1;
         }
@@ -961,12 +1245,12 @@ static int parse_file(ST_ID3v2 *tag, FILE *fp) {
             ST_URLFrame *uframe;
 
             if(!(uframe = ST_ID3v2_URLFrame_create_buf(frame, sz)))
-                goto out_close;
+                goto out_err;
 
             uframe->base.flags = flags;
 
             if(ST_ID3v2_addFrame(tag, fcc, &uframe->base) != ST_Error_None)
-                goto out_close;
+                goto out_err;
 
             shouldfree = 1;
         }
@@ -974,12 +1258,12 @@ static int parse_file(ST_ID3v2 *tag, FILE *fp) {
             ST_UserURLFrame *uuframe;
 
             if(!(uuframe = ST_ID3v2_UserURLFrame_create_buf(frame, sz)))
-                goto out_close;
+                goto out_err;
 
             uuframe->base.flags = flags;
 
             if(ST_ID3v2_addFrame(tag, fcc, &uuframe->base) != ST_Error_None)
-                goto out_close;
+                goto out_err;
 
             shouldfree = 1;
         }
@@ -989,17 +1273,17 @@ static int parse_file(ST_ID3v2 *tag, FILE *fp) {
 
             if(majorver > 2) {
                 if(!(pframe = ST_ID3v2_PictureFrame_create_buf(frame, sz)))
-                    goto out_close;
+                    goto out_err;
             }
             else {
                 if(!(pframe = ST_ID3v2_PictureFrame_create_buf2(frame, sz)))
-                    goto out_close;
+                    goto out_err;
             }
 
             pframe->base.flags = flags;
 
             if(ST_ID3v2_addFrame(tag, fcc, &pframe->base) != ST_Error_None)
-                goto out_close;
+                goto out_err;
 
             shouldfree = 1;
         }
@@ -1007,12 +1291,12 @@ static int parse_file(ST_ID3v2 *tag, FILE *fp) {
             ST_CommentFrame *cframe;
 
             if(!(cframe = ST_ID3v2_CommentFrame_create_buf(frame, sz)))
-                goto out_close;
+                goto out_err;
 
             cframe->base.flags = flags;
 
             if(ST_ID3v2_addFrame(tag, fcc, &cframe->base) != ST_Error_None)
-                goto out_close;
+                goto out_err;
 
             shouldfree = 1;
         }
@@ -1031,15 +1315,19 @@ static int parse_file(ST_ID3v2 *tag, FILE *fp) {
         }
 
         if(shouldfree)
-            free(frame);
+            ST_free(frame);
+    }
+
+    tag->parsing = 0;
+
+    for(i = 0; i < ST_Field_Count; ++i) {
+        resolve_field(tag, i);
     }
 
-    fclose(fp);
     return 0;
 
 out_free:
-    free(frame);
-out_close:
-    fclose(fp);
+    ST_free(frame);
+out_err:
     return -1;
 }
@@ -25,17 +25,18 @@
 #include <string.h>
 
 #include "SonatinaTag/Error.h"
+#include "SonatinaTag/Allocator.h"
 #include "Frame.h"
 
 static void free_picture(ST_PictureFrame *f) {
     ST_Picture_free(f->picture);
-    free(f);
+    ST_free(f);
 }
 
 ST_FUNC ST_PictureFrame *ST_ID3v2_PictureFrame_create(ST_Picture *p) {
     ST_PictureFrame *rv;
 
-    if((rv = (ST_PictureFrame *)malloc(sizeof(ST_PictureFrame)))) {
+    if((rv = (ST_PictureFrame *)ST_malloc(sizeof(ST_PictureFrame)))) {
         rv->base.type = ST_FrameType_Picture;
         rv->base.dtor = (void (*)(ST_Frame *))free_picture;
         rv->picture = p;
@@ -115,7 +116,7 @@ ST_LOCAL ST_PictureFrame *ST_ID3v2_PictureFrame_create_buf(const uint8_t *buf,
         return NULL;
 
     /* Deal with the MIME type */
-    if(!(tmp = (uint8_t *)malloc(mime_len + 1)))
+    if(!(tmp = (uint8_t *)ST_malloc(mime_len + 1)))
         goto err_pic;
 
     memcpy(tmp, buf + 1, mime_len);
@@ -124,10 +125,10 @@ ST_LOCAL ST_PictureFrame *ST_ID3v2_PictureFrame_create_buf(const uint8_t *buf,
     if(ST_Picture_setMimeType(p, (const char *)tmp) != ST_Error_None)
         goto err_pic;
 
-    free(tmp);
+    ST_free(tmp);
 
     /* Now, deal with the description */
-    if(!(tmp = (uint8_t *)malloc(desc_len)))
+    if(!(tmp = (uint8_t *)ST_malloc(desc_len)))
         goto err_pic;
 
     memcpy(tmp, buf + 3 + mime_len, desc_len);
@@ -135,12 +136,12 @@ ST_LOCAL ST_PictureFrame *ST_ID3v2_PictureFrame_create_buf(const uint8_t *buf,
     if(ST_Picture_setDescription(p, tmp, desc_len, e) != ST_Error_None)
         goto err_pic;
 
-    free(tmp);
+    ST_free(tmp);
 
     /* Finally, deal with the image itself */
     img_len = sz - mime_len - desc_len - enc_len - 3;
 
-    if(!(tmp = (uint8_t *)malloc(img_len)))
+    if(!(tmp = (uint8_t *)ST_malloc(img_len)))
         goto err_pic;
 
     memcpy(tmp, buf + 3 + mime_len + desc_len + enc_len, img_len);
@@ -153,7 +154,7 @@ ST_LOCAL ST_PictureFrame *ST_ID3v2_PictureFrame_create_buf(const uint8_t *buf,
         goto err_pic;
 
     /* Finally, make the frame */
-    if(!(rv = (ST_PictureFrame *)malloc(sizeof(ST_PictureFrame))))
+    if(!(rv = (ST_PictureFrame *)ST_malloc(sizeof(ST_PictureFrame))))
         goto err_pic;
 
     rv->base.type = ST_FrameType_Picture;
@@ -206,7 +207,7 @@ ST_LOCAL ST_PictureFrame *ST_ID3v2_PictureFrame_create_buf2(const uint8_t *buf,
         return NULL;
 
     /* Deal with the MIME type */
-    if(!(tmp = (uint8_t *)malloc(4)))
+    if(!(tmp = (uint8_t *)ST_malloc(4)))
         goto err_pic;
 
     tmp[0] = buf[1];
@@ -217,10 +218,10 @@ ST_LOCAL ST_PictureFrame *ST_ID3v2_PictureFrame_create_buf2(const uint8_t *buf,
     if(ST_Picture_setMimeType(p, (const char *)tmp) != ST_Error_None)
         goto err_pic;
 
-    free(tmp);
+    ST_free(tmp);
 
     /* Now, deal with the description */
-    if(!(tmp = (uint8_t *)malloc(desc_len)))
+    if(!(tmp = (uint8_t *)ST_malloc(desc_len)))
         goto err_pic;
 
     memcpy(tmp, buf + 5, desc_len);
@@ -228,12 +229,12 @@ ST_LOCAL ST_PictureFrame *ST_ID3v2_PictureFrame_create_buf2(const uint8_t *buf,
     if(ST_Picture_setDescription(p, tmp, desc_len, e) != ST_Error_None)
         goto err_pic;
 
-    free(tmp);
+    ST_free(tmp);
 
     /* Finally, deal with the image itself */
     img_len = sz - desc_len - enc_len - 5;
 
-    if(!(tmp = (uint8_t *)malloc(img_len)))
+    if(!(tmp = (uint8_t *)ST_malloc(img_len)))
         goto err_pic;
 
     memcpy(tmp, buf + 5 + desc_len + enc_len, img_len);
@@ -246,7 +247,7 @@ ST_LOCAL ST_PictureFrame *ST_ID3v2_PictureFrame_create_buf2(const uint8_t *buf,
         goto err_pic;
 
     /* Finally, make the frame */
-    if(!(rv = (ST_PictureFrame *)malloc(sizeof(ST_PictureFrame))))
+    if(!(rv = (ST_PictureFrame *)ST_malloc(sizeof(ST_PictureFrame))))
         goto err_pic;
 
     rv->base.type = ST_FrameType_Picture;
@@ -25,11 +25,12 @@
 #include <string.h>
 
 #include "SonatinaTag/Error.h"
+#include "SonatinaTag/Allocator.h"
 #include "Frame.h"
 
 static void free_text(ST_TextFrame *f) {
-    free(f->string);
-    free(f);
+    ST_free(f->string);
+    ST_free(f);
 }
 
 ST_FUNC ST_TextFrame *ST_ID3v2_TextFrame_create(ST_TextEncoding e, uint32_t len,
@@ -39,14 +40,14 @@ ST_FUNC ST_TextFrame *ST_ID3v2_TextFrame_create(ST_TextEncoding e, uint32_t len,
     if(e > ST_TextEncoding_UTF8 || e <= ST_TextEncoding_Invalid)
         return NULL;
 
-    if((rv = (ST_TextFrame *)malloc(sizeof(ST_TextFrame)))) {
+    if((rv = (ST_TextFrame *)ST_malloc(sizeof(ST_TextFrame)))) {
         rv->base.type = ST_FrameType_Text;
         rv->base.dtor = (void (*)(ST_Frame *))free_text;
         rv->encoding = e;
         rv->size = len;
 
-        if(!(rv->string = (uint8_t *)malloc(len))) {
-            free(rv);
+        if(!(rv->string = (uint8_t *)ST_malloc(len))) {
+            ST_free(rv);
             return NULL;
         }
 
@@ -63,14 +64,14 @@ ST_LOCAL ST_TextFrame *ST_ID3v2_TextFrame_create_buf(const uint8_t *buf,
     if(sz < 1 || buf[0] > (uint8_t)ST_TextEncoding_UTF8)
         return NULL;
 
-    if((rv = (ST_TextFrame *)malloc(sizeof(ST_TextFrame)))) {
+    if((rv = (ST_TextFrame *)ST_malloc(sizeof(ST_TextFrame)))) {
         rv->base.type = ST_FrameType_Text;
         rv->base.dtor = (void (*)(ST_Frame *))free_text;
         rv->encoding = (ST_TextEncoding)buf[0];
         rv->size = sz - 1;
 
-        if(!(rv->string = (uint8_t *)malloc(sz - 1))) {
-            free(rv);
+        if(!(rv->string = (uint8_t *)ST_malloc(sz - 1))) {
+            ST_free(rv);
             return NULL;
         }
 
@@ -111,13 +112,13 @@ ST_FUNC ST_Error ST_ID3v2_TextFrame_setText(ST_TextFrame *f, ST_TextEncoding e,
         return ST_Error_InvalidArgument;
 
     if(!own_buf) {
-        if(!(tmp = (uint8_t *)malloc((size_t)sz)))
+        if(!(tmp = (uint8_t *)ST_malloc((size_t)sz)))
             return ST_Error_errno;
 
         memcpy(tmp, d, sz);
     }
 
-    free(f->string);
+    ST_free(f->string);
     f->string = tmp;
     f->size = sz;
     f->encoding = e;
@@ -148,7 +149,7 @@ ST_FUNC ST_TextFrame *ST_ID3v2_TextFrame_createStr(CFStringRef str,
     slen = CFStringGetLength(str);
     l = CFStringGetMaximumSizeForEncoding(slen, encs[enc]);
 
-    if(!(buf = (uint8_t *)malloc(l)))
+    if(!(buf = (uint8_t *)ST_malloc(l)))
         return NULL;
 
     CFStringGetBytes(str, CFRangeMake(0, slen), encs[enc], 0,
@@ -156,11 +157,11 @@ ST_FUNC ST_TextFrame *ST_ID3v2_TextFrame_createStr(CFStringRef str,
 
     /* Attempt to make it smaller */
     if(slen != l) {
-        if((tmp = realloc(buf, slen)))
+        if((tmp = ST_realloc(buf, slen)))
             buf = (uint8_t *)tmp;
     }
 
-    if((rv = (ST_TextFrame *)malloc(sizeof(ST_TextFrame)))) {
+    if((rv = (ST_TextFrame *)ST_malloc(sizeof(ST_TextFrame)))) {
         rv->base.type = ST_FrameType_Text;
         rv->base.dtor = (void (*)(ST_Frame *))free_text;
         rv->encoding = enc;
@@ -168,7 +169,7 @@ ST_FUNC ST_TextFrame *ST_ID3v2_TextFrame_createStr(CFStringRef str,
         rv->string = buf;
     }
     else {
-        free(buf);
+        ST_free(buf);
     }
 
     return rv;
@@ -196,7 +197,7 @@ ST_FUNC ST_Error ST_ID3v2_TextFrame_setTextStr(ST_TextFrame *f, CFStringRef s) {
     slen = CFStringGetLength(s);
     l = CFStringGetMaximumSizeForEncoding(slen, encs[f->encoding]);
 
-    if(!(buf = (uint8_t *)malloc(l)))
+    if(!(buf = (uint8_t *)ST_malloc(l)))
         return ST_Error_errno;
 
     CFStringGetBytes(s, CFRangeMake(0, slen), encs[f->encoding], 0,
@@ -204,11 +205,11 @@ ST_FUNC ST_Error ST_ID3v2_TextFrame_setTextStr(ST_TextFrame *f, CFStringRef s) {
 
     /* Attempt to make it smaller */
     if(slen != l) {
-        if((tmp = realloc(buf, slen)))
+        if((tmp = ST_realloc(buf, slen)))
             buf = (uint8_t *)tmp;
     }
 
-    free(f->string);
+    ST_free(f->string);
     f->size = slen;
     f->string = buf;
 
@@ -25,24 +25,25 @@
 #include <string.h>
 
 #include "SonatinaTag/Error.h"
+#include "SonatinaTag/Allocator.h"
 #include "Frame.h"
 
 static void free_url(ST_URLFrame *f) {
-    free(f->url);
-    free(f);
+    ST_free(f->url);
+    ST_free(f);
 }
 
 ST_FUNC ST_URLFrame *ST_ID3v2_URLFrame_create(uint32_t len,
                                               const uint8_t *str) {
     ST_URLFrame *rv;
 
-    if((rv = (ST_URLFrame *)malloc(sizeof(ST_URLFrame)))) {
+    if((rv = (ST_URLFrame *)ST_malloc(sizeof(ST_URLFrame)))) {
         rv->base.type = ST_FrameType_URL;
         rv->base.dtor = (void (*)(ST_Frame *))free_url;
         rv->size = len;
 
-        if(!(rv->url = (uint8_t *)malloc(len))) {
-            free(rv);
+        if(!(rv->url = (uint8_t *)ST_malloc(len))) {
+            ST_free(rv);
             return NULL;
         }
 
@@ -56,13 +57,13 @@ ST_LOCAL ST_URLFrame *ST_ID3v2_URLFrame_create_buf(const uint8_t *buf,
                                                    uint32_t sz) {
     ST_URLFrame *rv;
 
-    if((rv = (ST_URLFrame *)malloc(sizeof(ST_URLFrame)))) {
+    if((rv = (ST_URLFrame *)ST_malloc(sizeof(ST_URLFrame)))) {
         rv->base.type = ST_FrameType_URL;
         rv->base.dtor = (void (*)(ST_Frame *))free_url;
         rv->size = sz;
 
-        if(!(rv->url = (uint8_t *)malloc(sz))) {
-            free(rv);
+        if(!(rv->url = (uint8_t *)ST_malloc(sz))) {
+            ST_free(rv);
             return NULL;
         }
 
@@ -94,13 +95,13 @@ ST_FUNC ST_Error ST_ID3v2_URLFrame_setURL(ST_URLFrame *f, uint32_t sz,
         return ST_Error_InvalidArgument;
 
     if(!own_buf) {
-        if(!(tmp = (uint8_t *)malloc((size_t)sz)))
+        if(!(tmp = (uint8_t *)ST_malloc((size_t)sz)))
             return ST_Error_errno;
 
         memcpy(tmp, d, sz);
     }
 
-    free(f->url);
+    ST_free(f->url);
     f->url = tmp;
     f->size = sz;
 
@@ -129,7 +130,7 @@ ST_FUNC ST_URLFrame *ST_ID3v2_URLFrame_createStr(CFStringRef s) {
     slen = CFStringGetLength(s);
     l = CFStringGetMaximumSizeForEncoding(slen, kCFStringEncodingISOLatin1);
 
-    if(!(buf = (uint8_t *)malloc(l)))
+    if(!(buf = (uint8_t *)ST_malloc(l)))
         return NULL;
 
     CFStringGetBytes(s, CFRangeMake(0, slen), kCFStringEncodingISOLatin1, 0,
@@ -137,18 +138,18 @@ ST_FUNC ST_URLFrame *ST_ID3v2_URLFrame_createStr(CFStringRef s) {
 
     /* Attempt to make it smaller */
     if(slen != l) {
-        if((tmp = realloc(buf, slen)))
+        if((tmp = ST_realloc(buf, slen)))
             buf = (uint8_t *)tmp;
     }
 
-    if((rv = (ST_URLFrame *)malloc(sizeof(ST_URLFrame)))) {
+    if((rv = (ST_URLFrame *)ST_malloc(sizeof(ST_URLFrame)))) {
         rv->base.type = ST_FrameType_URL;
         rv->base.dtor = (void (*)(ST_Frame *))free_url;
         rv->size = slen;
         rv->url = buf;
     }
     else {
-        free(buf);
+        ST_free(buf);
     }
 
     return rv;
@@ -190,7 +191,7 @@ ST_FUNC ST_Error ST_ID3v2_URLFrame_setURLStr(ST_URLFrame *f, CFStringRef s) {
     slen = CFStringGetLength(s);
     l = CFStringGetMaximumSizeForEncoding(slen, kCFStringEncodingISOLatin1);
 
-    if(!(buf = (uint8_t *)malloc(l)))
+    if(!(buf = (uint8_t *)ST_malloc(l)))
         return ST_Error_errno;
 
     CFStringGetBytes(s, CFRangeMake(0, slen), kCFStringEncodingISOLatin1, 0,
@@ -198,11 +199,11 @@ ST_FUNC ST_Error ST_ID3v2_URLFrame_setURLStr(ST_URLFrame *f, CFStringRef s) {
 
     /* Attempt to make it smaller */
     if(slen != l) {
-        if((tmp = realloc(buf, slen)))
+        if((tmp = ST_realloc(buf, slen)))
             buf = (uint8_t *)tmp;
     }
 
-    free(f->url);
+    ST_free(f->url);
     f->size = slen;
     f->url = buf;
 
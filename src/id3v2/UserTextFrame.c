@@ -25,12 +25,13 @@
 #include <string.h>
 
 #include "SonatinaTag/Error.h"
+#include "SonatinaTag/Allocator.h"
 #include "Frame.h"
 
 static void free_usertext(ST_UserTextFrame *f) {
-    free(f->desc);
-    free(f->string);
-    free(f);
+    ST_free(f->desc);
+    ST_free(f->string);
+    ST_free(f);
 }
 
 ST_FUNC ST_UserTextFrame *ST_ID3v2_UserTextFrame_create(ST_TextEncoding enc,
@@ -46,20 +47,20 @@ ST_FUNC ST_UserTextFrame *ST_ID3v2_UserTextFrame_create(ST_TextEncoding enc,
     if(enc > ST_TextEncoding_UTF8 || enc <= ST_TextEncoding_Invalid)
         return NULL;
 
-    if((rv = (ST_UserTextFrame *)malloc(sizeof(ST_UserTextFrame)))) {
+    if((rv = (ST_UserTextFrame *)ST_malloc(sizeof(ST_UserTextFrame)))) {
         rv->base.type = ST_FrameType_UserText;
         rv->base.dtor = (void (*)(ST_Frame *))free_usertext;
         rv->encoding = enc;
         rv->string_size = sl;
 
-        if(!(rv->string = (uint8_t *)malloc(sl))) {
-            free(rv);
+        if(!(rv->string = (uint8_t *)ST_malloc(sl))) {
+            ST_free(rv);
             return NULL;
         }
 
-        if(!(rv->desc = (uint8_t *)malloc(dl))) {
-            free(rv->string);
-            free(rv);
+        if(!(rv->desc = (uint8_t *)ST_malloc(dl))) {
+            ST_free(rv->string);
+            ST_free(rv);
             return NULL;
         }
 
@@ -109,7 +110,7 @@ ST_LOCAL ST_UserTextFrame *ST_ID3v2_UserTextFrame_create_buf(const uint8_t *buf,
     if(sz < 1 || buf[0] > (uint8_t)ST_TextEncoding_UTF8)
         return NULL;
 
-    if((rv = (ST_UserTextFrame *)malloc(sizeof(ST_UserTextFrame)))) {
+    if((rv = (ST_UserTextFrame *)ST_malloc(sizeof(ST_UserTextFrame)))) {
         rv->base.type = ST_FrameType_UserText;
         rv->base.dtor = (void (*)(ST_Frame *))free_usertext;
         rv->encoding = (ST_TextEncoding)buf[0];
@@ -126,18 +127,18 @@ ST_LOCAL ST_UserTextFrame *ST_ID3v2_UserTextFrame_create_buf(const uint8_t *buf,
 
         /* Sanity check... */
         if(rv->desc_size == (uint32_t)-1 || rv->string_size == (uint32_t)-1) {
-            free(rv);
+            ST_free(rv);
             return NULL;
         }
 
-        if(!(rv->desc = (uint8_t *)malloc(rv->desc_size))) {
-            free(rv);
+        if(!(rv->desc = (uint8_t *)ST_malloc(rv->desc_size))) {
+            ST_free(rv);
             return NULL;
         }
 
-        if(!(rv->string = (uint8_t *)malloc(rv->string_size))) {
-            free(rv->desc);
-            free(rv);
+        if(!(rv->string = (uint8_t *)ST_malloc(rv->string_size))) {
+            ST_free(rv->desc);
+            ST_free(rv);
             return NULL;
         }
 
@@ -194,13 +195,13 @@ ST_FUNC ST_Error ST_ID3v2_UserTextFrame_setText(ST_UserTextFrame *f,
         return ST_Error_InvalidArgument;
 
     if(!own_buf) {
-        if(!(tmp = (uint8_t *)malloc((size_t)str_sz)))
+        if(!(tmp = (uint8_t *)ST_malloc((size_t)str_sz)))
             return ST_Error_errno;
 
         memcpy(tmp, str, str_sz);
     }
 
-    free(f->string);
+    ST_free(f->string);
     f->string = tmp;
     f->string_size = str_sz;
     f->encoding = enc;
@@ -217,13 +218,13 @@ ST_FUNC ST_Error ST_ID3v2_UserTextFrame_setDesc(ST_UserTextFrame *f,
         return ST_Error_InvalidArgument;
 
     if(!own_buf) {
-        if(!(tmp = (uint8_t *)malloc((size_t)desc_sz)))
+        if(!(tmp = (uint8_t *)ST_malloc((size_t)desc_sz)))
             return ST_Error_errno;
 
         memcpy(tmp, desc, desc_sz);
     }
 
-    free(f->desc);
+    ST_free(f->desc);
     f->desc = tmp;
     f->desc_size = desc_sz;
 
@@ -256,14 +257,14 @@ ST_FUNC ST_UserTextFrame *ST_ID3v2_UserTextFrame_createStr(CFStringRef str,
     slen = CFStringGetLength(str);
     l = CFStringGetMaximumSizeForEncoding(slen, encs[e]);
 
-    if(!(buf = (uint8_t *)malloc(l)))
+    if(!(buf = (uint8_t *)ST_malloc(l)))
         return NULL;
 
     CFStringGetBytes(str, CFRangeMake(0, slen), encs[e], 0, ext, buf, l, &slen);
 
     /* Attempt to make it smaller */
     if(slen != l) {
-        if((tmp = realloc(buf, slen)))
+        if((tmp = ST_realloc(buf, slen)))
             buf = (uint8_t *)tmp;
     }
 
@@ -271,8 +272,8 @@ ST_FUNC ST_UserTextFrame *ST_ID3v2_UserTextFrame_createStr(CFStringRef str,
     dlen = CFStringGetLength(desc);
     l = CFStringGetMaximumSizeForEncoding(dlen, encs[e]);
 
-    if(!(dbuf = (uint8_t *)malloc(l))) {
-        free(buf);
+    if(!(dbuf = (uint8_t *)ST_malloc(l))) {
+        ST_free(buf);
         return NULL;
     }
 
@@ -280,11 +281,11 @@ ST_FUNC ST_UserTextFrame *ST_ID3v2_UserTextFrame_createStr(CFStringRef str,
                      &dlen);
 
     if(dlen != l) {
-        if((tmp = realloc(dbuf, dlen)))
+        if((tmp = ST_realloc(dbuf, dlen)))
             dbuf = (uint8_t *)tmp;
     }
 
-    if((rv = (ST_UserTextFrame *)malloc(sizeof(ST_UserTextFrame)))) {
+    if((rv = (ST_UserTextFrame *)ST_malloc(sizeof(ST_UserTextFrame)))) {
         rv->base.type = ST_FrameType_UserText;
         rv->base.dtor = (void (*)(ST_Frame *))free_usertext;
         rv->encoding = e;
@@ -294,8 +295,8 @@ ST_FUNC ST_UserTextFrame *ST_ID3v2_UserTextFrame_createStr(CFStringRef str,
         rv->desc = dbuf;
     }
     else {
-        free(buf);
-        free(dbuf);
+        ST_free(buf);
+        ST_free(dbuf);
     }
 
     return rv;
@@ -330,7 +331,7 @@ static ST_Error set_str(ST_UserTextFrame *f, CFStringRef s, uint8_t **ptr,
     slen = CFStringGetLength(s);
     l = CFStringGetMaximumSizeForEncoding(slen, encs[f->encoding]);
 
-    if(!(buf = (uint8_t *)malloc(l)))
+    if(!(buf = (uint8_t *)ST_malloc(l)))
         return ST_Error_errno;
 
     CFStringGetBytes(s, CFRangeMake(0, slen), encs[f->encoding], 0,
@@ -338,11 +339,11 @@ static ST_Error set_str(ST_UserTextFrame *f, CFStringRef s, uint8_t **ptr,
 
     /* Attempt to make it smaller */
     if(slen != l) {
-        if((tmp = realloc(buf, slen)))
+        if((tmp = ST_realloc(buf, slen)))
             buf = (uint8_t *)tmp;
     }
 
-    free(*ptr);
+    ST_free(*ptr);
     *sz = slen;
     *ptr = buf;
 
@@ -25,12 +25,13 @@
 #include <string.h>
 
 #include "SonatinaTag/Error.h"
+#include "SonatinaTag/Allocator.h"
 #include "Frame.h"
 
 static void free_userurl(ST_UserURLFrame *f) {
-    free(f->desc);
-    free(f->url);
-    free(f);
+    ST_free(f->desc);
+    ST_free(f->url);
+    ST_free(f);
 }
 
 ST_FUNC ST_UserURLFrame *ST_ID3v2_UserURLFrame_create(ST_TextEncoding enc,
@@ -46,20 +47,20 @@ ST_FUNC ST_UserURLFrame *ST_ID3v2_UserURLFrame_create(ST_TextEncoding enc,
     if(enc > ST_TextEncoding_UTF8 || enc <= ST_TextEncoding_Invalid)
         return NULL;
 
-    if((rv = (ST_UserURLFrame *)malloc(sizeof(ST_UserURLFrame)))) {
+    if((rv = (ST_UserURLFrame *)ST_malloc(sizeof(ST_UserURLFrame)))) {
         rv->base.type = ST_FrameType_UserURL;
         rv->base.dtor = (void (*)(ST_Frame *))free_userurl;
         rv->encoding = enc;
         rv->url_size = ul;
 
-        if(!(rv->url = (uint8_t *)malloc(ul))) {
-            free(rv);
+        if(!(rv->url = (uint8_t *)ST_malloc(ul))) {
+            ST_free(rv);
             return NULL;
         }
 
-        if(!(rv->desc = (uint8_t *)malloc(dl))) {
-            free(rv->url);
-            free(rv);
+        if(!(rv->desc = (uint8_t *)ST_malloc(dl))) {
+            ST_free(rv->url);
+            ST_free(rv);
             return NULL;
         }
 
@@ -109,7 +110,7 @@ ST_LOCAL ST_UserURLFrame *ST_ID3v2_UserURLFrame_create_buf(const uint8_t *buf,
     if(sz < 1 || buf[0] > (uint8_t)ST_TextEncoding_UTF8)
         return NULL;
 
-    if((rv = (ST_UserURLFrame *)malloc(sizeof(ST_UserURLFrame)))) {
+    if((rv = (ST_UserURLFrame *)ST_malloc(sizeof(ST_UserURLFrame)))) {
         rv->base.type = ST_FrameType_UserURL;
         rv->base.dtor = (void (*)(ST_Frame *))free_userurl;
         rv->encoding = (ST_TextEncoding)buf[0];
@@ -126,18 +127,18 @@ ST_LOCAL ST_UserURLFrame *ST_ID3v2_UserURLFrame_create_buf(const uint8_t *buf,
 
         /* Sanity check... */
         if(rv->desc_size == (uint32_t)-1 || rv->url_size == (uint32_t)-1) {
-            free(rv);
+            ST_free(rv);
             return NULL;
         }
 
-        if(!(rv->desc = (uint8_t *)malloc(rv->desc_size))) {
-            free(rv);
+        if(!(rv->desc = (uint8_t *)ST_malloc(rv->desc_size))) {
+            ST_free(rv);
             return NULL;
         }
 
-        if(!(rv->url = (uint8_t *)malloc(rv->url_size))) {
-            free(rv->desc);
-            free(rv);
+        if(!(rv->url = (uint8_t *)ST_malloc(rv->url_size))) {
+            ST_free(rv->desc);
+            ST_free(rv);
             return NULL;
         }
 
@@ -191,13 +192,13 @@ ST_FUNC ST_Error ST_ID3v2_UserURLFrame_setURL(ST_UserURLFrame *f, uint32_t ul,
         return ST_Error_InvalidArgument;
 
     if(!own_buf) {
-        if(!(tmp = (uint8_t *)malloc((size_t)ul)))
+        if(!(tmp = (uint8_t *)ST_malloc((size_t)ul)))
             return ST_Error_errno;
 
         memcpy(tmp, url, ul);
     }
 
-    free(f->url);
+    ST_free(f->url);
     f->url = tmp;
     f->url_size = ul;
 
@@ -215,13 +216,13 @@ ST_FUNC ST_Error ST_ID3v2_UserURLFrame_setDesc(ST_UserURLFrame *f,
         return ST_Error_InvalidArgument;
 
     if(!own_buf) {
-        if(!(tmp = (uint8_t *)malloc((size_t)desc_sz)))
+        if(!(tmp = (uint8_t *)ST_malloc((size_t)desc_sz)))
             return ST_Error_errno;
 
         memcpy(tmp, desc, desc_sz);
     }
 
-    free(f->desc);
+    ST_free(f->desc);
     f->desc = tmp;
     f->desc_size = desc_sz;
     f->encoding = enc;
@@ -260,7 +261,7 @@ ST_FUNC ST_UserURLFrame *ST_ID3v2_UserURLFrame_createStr(CFStringRef url,
     slen = CFStringGetLength(url);
     l = CFStringGetMaximumSizeForEncoding(slen, kCFStringEncodingISOLatin1);
 
-    if(!(buf = (uint8_t *)malloc(l)))
+    if(!(buf = (uint8_t *)ST_malloc(l)))
         return NULL;
 
     CFStringGetBytes(url, CFRangeMake(0, slen), kCFStringEncodingISOLatin1, 0,
@@ -268,7 +269,7 @@ ST_FUNC ST_UserURLFrame *ST_ID3v2_UserURLFrame_createStr(CFStringRef url,
 
     /* Attempt to make it smaller */
     if(slen != l) {
-        if((tmp = realloc(buf, slen)))
+        if((tmp = ST_realloc(buf, slen)))
             buf = (uint8_t *)tmp;
     }
 
@@ -276,8 +277,8 @@ ST_FUNC ST_UserURLFrame *ST_ID3v2_UserURLFrame_createStr(CFStringRef url,
     dlen = CFStringGetLength(desc);
     l = CFStringGetMaximumSizeForEncoding(dlen, encs[e]);
 
-    if(!(dbuf = (uint8_t *)malloc(l))) {
-        free(buf);
+    if(!(dbuf = (uint8_t *)ST_malloc(l))) {
+        ST_free(buf);
         return NULL;
     }
 
@@ -285,11 +286,11 @@ ST_FUNC ST_UserURLFrame *ST_ID3v2_UserURLFrame_createStr(CFStringRef url,
                      e == ST_TextEncoding_UTF16, dbuf, l, &dlen);
 
     if(dlen != l) {
-        if((tmp = realloc(dbuf, dlen)))
+        if((tmp = ST_realloc(dbuf, dlen)))
             dbuf = (uint8_t *)tmp;
     }
 
-    if((rv = (ST_UserURLFrame *)malloc(sizeof(ST_UserURLFrame)))) {
+    if((rv = (ST_UserURLFrame *)ST_malloc(sizeof(ST_UserURLFrame)))) {
         rv->base.type = ST_FrameType_UserURL;
         rv->base.dtor = (void (*)(ST_Frame *))free_userurl;
         rv->encoding = e;
@@ -299,8 +300,8 @@ ST_FUNC ST_UserURLFrame *ST_ID3v2_UserURLFrame_createStr(CFStringRef url,
         rv->desc = dbuf;
     }
     else {
-        free(buf);
-        free(dbuf);
+        ST_free(buf);
+        ST_free(dbuf);
     }
 
     return rv;
@@ -317,7 +318,7 @@ static ST_Error set_str(ST_UserURLFrame *f, CFStringRef s, uint8_t **ptr,
     slen = CFStringGetLength(s);
     l = CFStringGetMaximumSizeForEncoding(slen, e);
 
-    if(!(buf = (uint8_t *)malloc(l)))
+    if(!(buf = (uint8_t *)ST_malloc(l)))
         return ST_Error_errno;
 
     CFStringGetBytes(s, CFRangeMake(0, slen), e, 0, e == kCFStringEncodingUTF16,
@@ -325,11 +326,11 @@ static ST_Error set_str(ST_UserURLFrame *f, CFStringRef s, uint8_t **ptr,
 
     /* Attempt to make it smaller */
     if(slen != l) {
-        if((tmp = realloc(buf, slen)))
+        if((tmp = ST_realloc(buf, slen)))
             buf = (uint8_t *)tmp;
     }
 
-    free(*ptr);
+    ST_free(*ptr);
     *sz = slen;
     *ptr = buf;
 
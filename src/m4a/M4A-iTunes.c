@@ -24,22 +24,72 @@
 #include <string.h>
 #include <stdlib.h>
 #include <stdint.h>
+#include <sys/types.h>
 
 #include "SonatinaTag/SonatinaTag.h"
 #include "SonatinaTag/Tags/M4A.h"
+#include "SonatinaTag/Allocator.h"
 #include "../base/Tag.h"
+#include "../utils/Lazy.h"
+#include "../utils/Text.h"
 
 struct ST_M4A_struct {
     ST_Tag base;
     ST_Dict *atoms;
     uint32_t picture_count;
     ST_Picture **pictures;
+
+    /* Audio properties, from the mvhd and the first sound track. */
+    uint32_t timescale;
+    uint64_t duration;
+    uint32_t audio_timescale;
+    uint64_t audio_duration;
+    uint32_t sample_rate;
+    uint32_t channels;
+    uint32_t bits_per_sample;
+    uint32_t bitrate;
+
+    /* Integer items, decoded from the first value of each. Anything that isn't
+       in the tag is -1. */
+    struct {
+        int track;
+        int track_count;
+        int disc;
+        int disc_count;
+        int genre_id;
+        int tempo;
+        int compilation;
+        int rating;
+    } items;
+
+    /* First value of each of the well-known text fields. These point at atoms
+       owned by the atoms dictionary, and are kept up to date along with the
+       integer items. */
+    const ST_M4A_Atom *fields[ST_Field_Count];
+
+    /* Chapters. If they came from a chapter track, the titles are read from
+       the file when they're first asked for, with the allocator the tag was
+       made with, as long as the file still matches the stamp. */
+    int chapter_count;
+    struct m4a_chapter_s *chapters;
+    char *filename;
+    ST_FileStamp stamp;
+    const ST_Allocator *alloc;
 };
 
+typedef struct m4a_chapter_s {
+    uint64_t start;
+    off_t offset;
+    uint32_t size;
+    char *title;
+} m4a_chapter_t;
+
 struct ST_M4A_Atom_struct {
     char *long_name;
+    size_t mean_len;
     size_t data_sz;
     uint8_t *data;
+    uint32_t type;
 };
 
 
@@ -49,29 +99,196 @@ struct ST_M4A_Atom_struct {
 
 #define MIN(x, y) ((x < y) ? x : y)
 
+/* How much of the end of the file to look at for a moov atom when the media
+   data comes first. */
+#define TAIL_WINDOW     (256 * 1024)
+
+/* How much padding to leave after the moov atom when it has to grow, and how
+   much of the file to move at once when doing so. */
+#define PADDING_SIZE    2048
+#define SHIFT_BUFSZ     (1024 * 1024)
+
 /* Forward declarations */
 static int parse_file(ST_M4A *tag, FILE *fp);
+static ST_Error read_title(const ST_M4A *tag, m4a_chapter_t *ch);
+
+/* Where each of the well-known fields comes from. The ones that don't have an
+   atom of their own are in '----' atoms with the given long name. */
+typedef struct field_src_s {
+    uint32_t fourcc;
+    const char *long_name;
+} field_src_t;
+
+static const field_src_t field_srcs[ST_Field_Count] = {
+    { ST_AtomTitle, NULL },
+    { ST_AtomArtist, NULL },
+    { ST_AtomAlbum, NULL },
+    { ST_AtomAlbumArtist, NULL },
+    { ST_AtomComment, NULL },
+    { ST_AtomYear, NULL },
+    { ST_AtomGenre, NULL },
+    { ST_AtomComposer, NULL },
+    { ST_AtomLongName, "com.apple.iTunes.replaygain_track_gain" },
+    { ST_AtomLongName, "com.apple.iTunes.replaygain_track_peak" },
+    { ST_AtomLongName, "com.apple.iTunes.replaygain_album_gain" },
+    { ST_AtomLongName, "com.apple.iTunes.replaygain_album_peak" },
+    { ST_AtomLongName, "com.apple.iTunes.MusicBrainz Track Id" },
+    { ST_AtomLongName, "com.apple.iTunes.MusicBrainz Album Id" },
+    { ST_AtomLongName, "com.apple.iTunes.MusicBrainz Artist Id" },
+    { ST_AtomLongName, "com.apple.iTunes.MusicBrainz Album Artist Id" },
+    { ST_AtomLongName, "com.apple.iTunes.MusicBrainz Release Group Id" }
+};
 
 static void free_atom(void *a) {
     ST_M4A_Atom *atom = (ST_M4A_Atom *)a;
 
-    free(atom->long_name);
-    free(atom->data);
-    free(atom);
+    ST_free(atom->long_name);
+    ST_free(atom->data);
+    ST_free(atom);
 }
 
 static ST_M4A_Atom *create_atom(size_t sz, uint8_t *data, char *long_name) {
-    ST_M4A_Atom *a = (ST_M4A_Atom *)malloc(sizeof(ST_M4A_Atom));
+    ST_M4A_Atom *a = (ST_M4A_Atom *)ST_malloc(sizeof(ST_M4A_Atom));
 
     if(a) {
         a->data = data;
         a->long_name = long_name;
+        a->mean_len = 0;
         a->data_sz = sz;
+        a->type = ST_M4A_DataType_UTF8;
     }
 
     return a;
 }
 
+/* The type of data that an atom is normally written out with. */
+static uint32_t data_type(uint32_t fourcc) {
+    switch(fourcc) {
+        case ST_AtomTrackNumber:
+        case ST_AtomDiscNumber:
+        case ST_AtomGenreID:
+            return ST_M4A_DataType_Implicit;
+
+        case ST_AtomTempo:
+        case ST_AtomPartOfCompilation:
+        case ST_AtomPartOfGaplessAlbum:
+        case ST_AtomPodcast:
+        case ST_AtomRating:
+        case ST_AtomTVEpisodeNumber:
+        case ST_AtomTVSeason:
+            return ST_M4A_DataType_SignedInt;
+
+        default:
+            return ST_M4A_DataType_UTF8;
+    }
+}
+
+/* Decode a big-endian integer item. */
+static int decode_int(const ST_M4A_Atom *a) {
+    char buf[16];
+    size_t len = MIN(a->data_sz, sizeof(buf) - 1);
+
+    /* Some taggers write these out as text... */
+    if(a->type == ST_M4A_DataType_UTF8) {
+        memcpy(buf, a->data, len);
+        buf[len] = 0;
+        return atoi(buf);
+    }
+
+    switch(a->data_sz) {
+        case 1:
+            return (int)((a->type == ST_M4A_DataType_UnsignedInt) ?
+                         a->data[0] : (int8_t)a->data[0]);
+
+        case 2:
+            return (int)((a->type == ST_M4A_DataType_UnsignedInt) ?
+                         (uint16_t)((a->data[0] << 8) | a->data[1]) :
+                         (int16_t)((a->data[0] << 8) | a->data[1]));
+
+        case 4:
+        case 8:
+            return (int)(((uint32_t)a->data[a->data_sz - 4] << 24) |
+                         (a->data[a->data_sz - 3] << 16) |
+                         (a->data[a->data_sz - 2] << 8) |
+                         a->data[a->data_sz - 1]);
+
+        default:
+            return -1;
+    }
+}
+
+/* Re-decode the integer item for the given atom type, after it has been read
+   in or changed. */
+static void update_item(ST_M4A *tag, uint32_t fourcc) {
+    const void **values;
+    const ST_M4A_Atom *a = NULL, *a2;
+    int count = 0, v = -1, v2 = -1, i, j;
+
+    if((values = ST_Dict_find(tag->atoms, &fourcc, &count)) && count)
+        a = (const ST_M4A_Atom *)values[0];
+
+    /* Text fields just point at the first value. The ones in '----' atoms have
+       to be picked out by their long names. */
+    for(i = 0; i < ST_Field_Count; ++i) {
+        if(field_srcs[i].fourcc != fourcc)
+            continue;
+
+        if(!field_srcs[i].long_name) {
+            tag->fields[i] = a;
+            continue;
+        }
+
+        tag->fields[i] = NULL;
+
+        for(j = 0; j < count; ++j) {
+            a2 = (const ST_M4A_Atom *)values[j];
+
+            if(a2->long_name &&
+               !strcasecmp(a2->long_name, field_srcs[i].long_name)) {
+                tag->fields[i] = a2;
+                break;
+            }
+        }
+    }
+
+    switch(fourcc) {
+        case ST_AtomTrackNumber:
+        case ST_AtomDiscNumber:
+            /* These are 2 bytes of padding, the number, and then the total. */
+            if(a && a->data_sz >= 4)
+                v = (a->data[2] << 8) | a->data[3];
+
+            if(a && a->data_sz >= 6)
+                v2 = (a->data[4] << 8) | a->data[5];
+
+            if(fourcc == ST_AtomTrackNumber) {
+                tag->items.track = v;
+                tag->items.track_count = v2;
+            }
+            else {
+                tag->items.disc = v;
+                tag->items.disc_count = v2;
+            }
+            break;
+
+        case ST_AtomGenreID:
+            tag->items.genre_id = a ? decode_int(a) : -1;
+            break;
+
+        case ST_AtomTempo:
+            tag->items.tempo = a ? decode_int(a) : -1;
+            break;
+
+        case ST_AtomPartOfCompilation:
+            tag->items.compilation = a ? decode_int(a) : -1;
+            break;
+
+        case ST_AtomRating:
+            tag->items.rating = a ? decode_int(a) : -1;
+            break;
+    }
+}
+
 #ifdef ST_HAVE_COREFOUNDATION
 static ST_M4A_Atom *create_atom_str(CFStringRef str, char *long_name) {
     CFIndex slen = CFStringGetLength(str);
@@ -81,7 +298,7 @@ static ST_M4A_Atom *create_atom_str(CFStringRef str, char *long_name) {
     ST_M4A_Atom *a;
 
     /* Make space for the string... */
-    if(!(s = (uint8_t *)malloc(l))) {
+    if(!(s = (uint8_t *)ST_malloc(l))) {
         return NULL;
     }
 
@@ -90,18 +307,20 @@ static ST_M4A_Atom *create_atom_str(CFStringRef str, char *long_name) {
                      s, l, &slen);
 
     if(slen != l) {
-        if((tmp = realloc(s, slen)))
+        if((tmp = ST_realloc(s, slen)))
             s = (uint8_t *)tmp;
     }
 
     /* Make the atom, or die trying */
-    if((a = (ST_M4A_Atom *)malloc(sizeof(ST_M4A_Atom)))) {
+    if((a = (ST_M4A_Atom *)ST_malloc(sizeof(ST_M4A_Atom)))) {
         a->data = s;
         a->long_name = long_name;
+        a->mean_len = 0;
         a->data_sz = slen;
+        a->type = ST_M4A_DataType_UTF8;
     }
     else {
-        free(s);
+        ST_free(s);
     }
 
     return a;
@@ -113,7 +332,7 @@ static ST_M4A_Atom *create_atom_data(CFDataRef d, char *long_name) {
     ST_M4A_Atom *a;
 
     /* Make space for the data... */
-    if(!(s = (uint8_t *)malloc(slen))) {
+    if(!(s = (uint8_t *)ST_malloc(slen))) {
         return NULL;
     }
 
@@ -121,13 +340,15 @@ static ST_M4A_Atom *create_atom_data(CFDataRef d, char *long_name) {
     CFDataGetBytes(d, CFRangeMake(0, slen), s);
 
     /* Make the atom, or die trying */
-    if((a = (ST_M4A_Atom *)malloc(sizeof(ST_M4A_Atom)))) {
+    if((a = (ST_M4A_Atom *)ST_malloc(sizeof(ST_M4A_Atom)))) {
         a->data = s;
         a->long_name = long_name;
+        a->mean_len = 0;
         a->data_sz = slen;
+        a->type = ST_M4A_DataType_UTF8;
     }
     else {
-        free(s);
+        ST_free(s);
     }
 
     return a;
@@ -155,6 +376,13 @@ ST_FUNC size_t ST_M4A_Atom_length(const ST_M4A_Atom *atom) {
     return atom->data_sz;
 }
 
+ST_FUNC uint32_t ST_M4A_Atom_type(const ST_M4A_Atom *atom) {
+    if(!atom)
+        return (uint32_t)-1;
+
+    return atom->type;
+}
+
 #ifdef ST_HAVE_COREFOUNDATION
 ST_FUNC CFStringRef ST_M4A_Atom_copyDataStr(const ST_M4A_Atom *atom) {
     if(!atom)
@@ -174,17 +402,39 @@ ST_FUNC CFDataRef ST_M4A_Atom_copyData(const ST_M4A_Atom *atom) {
 #endif
 
 ST_FUNC ST_M4A *ST_M4A_create(void) {
-    ST_M4A *rv = (ST_M4A *)malloc(sizeof(ST_M4A));
+    ST_M4A *rv = (ST_M4A *)ST_malloc(sizeof(ST_M4A));
 
     if(rv) {
         if(!(rv->atoms = ST_Dict_createUint32(10, free_atom))) {
-            free(rv);
+            ST_free(rv);
             return NULL;
         }
 
         rv->picture_count = 0;
         rv->pictures = NULL;
+        rv->timescale = 0;
+        rv->duration = 0;
+        rv->audio_timescale = 0;
+        rv->audio_duration = 0;
+        rv->sample_rate = 0;
+        rv->channels = 0;
+        rv->bits_per_sample = 0;
+        rv->bitrate = 0;
+        rv->items.track = -1;
+        rv->items.track_count = -1;
+        rv->items.disc = -1;
+        rv->items.disc_count = -1;
+        rv->items.genre_id = -1;
+        rv->items.tempo = -1;
+        rv->items.compilation = -1;
+        rv->items.rating = -1;
+        memset(rv->fields, 0, sizeof(rv->fields));
+        rv->chapter_count = 0;
+        rv->chapters = NULL;
+        rv->filename = NULL;
+        rv->alloc = ST_currentAllocator();
         rv->base.type = ST_TagType_M4A;
+        rv->base.arena = NULL;
     }
 
     return rv;
@@ -192,10 +442,16 @@ ST_FUNC ST_M4A *ST_M4A_create(void) {
 
 ST_FUNC void ST_M4A_free(ST_M4A *tag) {
     uint32_t i;
+    int j;
 
     if(!tag || tag->base.type != ST_TagType_M4A)
         return;
 
+    if(tag->base.arena) {
+        ST_Arena_free(tag->base.arena);
+        return;
+    }
+
     /* Clean up the dictionary. This will free all the values in them too. */
     ST_Dict_free(tag->atoms);
 
@@ -204,8 +460,15 @@ ST_FUNC void ST_M4A_free(ST_M4A *tag) {
         ST_Picture_free(tag->pictures[i]);
     }
 
-    free(tag->pictures);
-    free(tag);
+    ST_free(tag->pictures);
+
+    for(j = 0; j < tag->chapter_count; ++j) {
+        ST_free(tag->chapters[j].title);
+    }
+
+    ST_free(tag->chapters);
+    ST_free(tag->filename);
+    ST_free(tag);
 }
 
 ST_FUNC ST_M4A *ST_M4A_createFromFile(const char *fn) {
@@ -221,7 +484,17 @@ ST_FUNC ST_M4A *ST_M4A_createFromFile(const char *fn) {
         goto out_free;
     }
 
+    if(ST_FileStamp_take(&rv->stamp, fp)) {
+        fclose(fp);
+        goto out_free;
+    }
+
     if(!parse_file(rv, fp)) {
+        /* Hang onto the filename if we'll need it to read chapter titles. */
+        if(rv->chapter_count && !rv->chapters[0].title &&
+           !(rv->filename = ST_strdup(fn)))
+            goto out_free;
+
         return rv;
     }
 
@@ -311,6 +584,7 @@ ST_FUNC size_t ST_M4A_atomLengthForKey(const ST_M4A *tag, ST_M4A_AtomCode code,
 
     if((value = ST_Dict_find(tag->atoms, &code, &count))) {
         if(index < count) {
+            atom = (const ST_M4A_Atom *)value[index];
             return atom->data_sz;
         }
     }
@@ -343,27 +617,111 @@ ST_FUNC ST_Error ST_M4A_genre(const ST_M4A *tag, uint8_t *buf, size_t len) {
 }
 
 ST_FUNC int ST_M4A_track(const ST_M4A *tag) {
-    uint8_t buf[32] = { 0 };
-
     if(!tag || tag->base.type != ST_TagType_M4A)
         return -1;
 
-    if(ST_M4A_atomForKey(tag, ST_AtomTrackNumber, 0, buf, 32) != ST_Error_None)
+    return tag->items.track;
+}
+
+ST_FUNC int ST_M4A_trackCount(const ST_M4A *tag) {
+    if(!tag || tag->base.type != ST_TagType_M4A)
         return -1;
 
-    return (int)(buf[3] | (buf[2] << 8));
+    return tag->items.track_count;
 }
 
 ST_FUNC int ST_M4A_disc(const ST_M4A *tag) {
-    uint8_t buf[32] = { 0 };
+    if(!tag || tag->base.type != ST_TagType_M4A)
+        return -1;
+
+    return tag->items.disc;
+}
+
+ST_FUNC int ST_M4A_discCount(const ST_M4A *tag) {
+    if(!tag || tag->base.type != ST_TagType_M4A)
+        return -1;
+
+    return tag->items.disc_count;
+}
+
+ST_FUNC int ST_M4A_genreID(const ST_M4A *tag) {
+    if(!tag || tag->base.type != ST_TagType_M4A)
+        return -1;
+
+    return tag->items.genre_id;
+}
+
+ST_FUNC int ST_M4A_normalizedGenre(const ST_M4A *tag, uint8_t *buf,
+                                   size_t len) {
+    const ST_M4A_Atom *atom;
+    const char *name;
+
+    if(buf && len)
+        buf[0] = 0;
+
+    if(!tag || tag->base.type != ST_TagType_M4A)
+        return ST_Genre_None;
+
+    /* The gnre atom is the ID3v1 code plus one. Use it if it's there, and the
+       free-form genre otherwise. */
+    if(tag->items.genre_id > 0 &&
+       (name = ST_Genre_name(tag->items.genre_id - 1))) {
+        if(buf)
+            ST_Text_copyUTF8((const uint8_t *)name, strlen(name), buf, len);
+
+        return tag->items.genre_id - 1;
+    }
+
+    if(!(atom = tag->fields[ST_Field_Genre]))
+        return ST_Genre_None;
+
+    return ST_Genre_normalize(atom->data, atom->data_sz, buf, len);
+}
+
+ST_FUNC ST_Error ST_M4A_get(const ST_M4A *tag, ST_Field field, uint8_t *buf,
+                            size_t len) {
+    const ST_M4A_Atom *atom;
+
+    if(!tag || tag->base.type != ST_TagType_M4A || !buf || !len ||
+       field < 0 || field >= ST_Field_Count)
+        return ST_Error_InvalidArgument;
+
+    buf[0] = 0;
+
+    if(field == ST_Field_Genre) {
+        return ST_Tag_getGenre((const ST_Tag *)tag, buf, len);
+    }
 
+    if(!(atom = tag->fields[field]) || !atom->data_sz)
+        return ST_Error_NotFound;
+
+    if(atom->type == ST_M4A_DataType_UTF16)
+        return ST_Text_getUTF8(atom->data, atom->data_sz,
+                               ST_TextEncoding_UTF16BE, buf, len);
+
+    return ST_Text_getUTF8(atom->data, atom->data_sz, ST_TextEncoding_UTF8,
+                           buf, len);
+}
+
+ST_FUNC int ST_M4A_tempo(const ST_M4A *tag) {
+    if(!tag || tag->base.type != ST_TagType_M4A)
+        return -1;
+
+    return tag->items.tempo;
+}
+
+ST_FUNC int ST_M4A_compilation(const ST_M4A *tag) {
     if(!tag || tag->base.type != ST_TagType_M4A)
         return -1;
 
-    if(ST_M4A_atomForKey(tag, ST_AtomDiscNumber, 0, buf, 32) != ST_Error_None)
+    return tag->items.compilation;
+}
+
+ST_FUNC int ST_M4A_rating(const ST_M4A *tag) {
+    if(!tag || tag->base.type != ST_TagType_M4A)
         return -1;
 
-    return (int)(buf[3] | (buf[2] << 8));
+    return tag->items.rating;
 }
 
 ST_FUNC const ST_Picture *ST_M4A_picture(const ST_M4A *tag, int index) {
@@ -373,6 +731,126 @@ ST_FUNC const ST_Picture *ST_M4A_picture(const ST_M4A *tag, int index) {
     return tag->pictures[index];
 }
 
+ST_FUNC int ST_M4A_chapterCount(const ST_M4A *tag) {
+    if(!tag || tag->base.type != ST_TagType_M4A)
+        return -1;
+
+    return tag->chapter_count;
+}
+
+ST_FUNC uint64_t ST_M4A_chapterStart(const ST_M4A *tag, int index) {
+    if(!tag || tag->base.type != ST_TagType_M4A || index < 0 ||
+       index >= tag->chapter_count)
+        return (uint64_t)-1;
+
+    return tag->chapters[index].start;
+}
+
+ST_FUNC const char *ST_M4A_chapterTitle(const ST_M4A *tag, int index) {
+    if(!tag || tag->base.type != ST_TagType_M4A || index < 0 ||
+       index >= tag->chapter_count)
+        return NULL;
+
+    /* The filename is only cleared by ST_M4A_loadChapterTitles, so it's safe
+       to check without the lock. */
+    if(tag->filename) {
+        ST_Lazy_lock();
+        read_title(tag, &tag->chapters[index]);
+        ST_Lazy_unlock();
+    }
+
+    return tag->chapters[index].title;
+}
+
+ST_FUNC ST_Error ST_M4A_loadChapterTitles(ST_M4A *tag) {
+    ST_Error rv;
+    int i;
+
+    if(!tag || tag->base.type != ST_TagType_M4A)
+        return ST_Error_InvalidArgument;
+
+    if(!tag->filename)
+        return ST_Error_None;
+
+    for(i = 0; i < tag->chapter_count; ++i) {
+        if((rv = read_title(tag, &tag->chapters[i])) != ST_Error_None)
+            return rv;
+    }
+
+    ST_free(tag->filename);
+    tag->filename = NULL;
+    return ST_Error_None;
+}
+
+ST_FUNC uint32_t ST_M4A_timescale(const ST_M4A *tag) {
+    if(!tag || tag->base.type != ST_TagType_M4A)
+        return (uint32_t)-1;
+
+    return tag->timescale;
+}
+
+ST_FUNC uint64_t ST_M4A_duration(const ST_M4A *tag) {
+    if(!tag || tag->base.type != ST_TagType_M4A)
+        return (uint64_t)-1;
+
+    return tag->duration;
+}
+
+ST_FUNC uint32_t ST_M4A_audioTimescale(const ST_M4A *tag) {
+    if(!tag || tag->base.type != ST_TagType_M4A)
+        return (uint32_t)-1;
+
+    return tag->audio_timescale;
+}
+
+ST_FUNC uint64_t ST_M4A_audioDuration(const ST_M4A *tag) {
+    if(!tag || tag->base.type != ST_TagType_M4A)
+        return (uint64_t)-1;
+
+    return tag->audio_duration;
+}
+
+ST_FUNC uint64_t ST_M4A_durationMs(const ST_M4A *tag) {
+    if(!tag || tag->base.type != ST_TagType_M4A)
+        return (uint64_t)-1;
+
+    /* Prefer the length of the audio track, if there is one. */
+    if(tag->audio_timescale)
+        return tag->audio_duration * 1000 / tag->audio_timescale;
+    else if(tag->timescale)
+        return tag->duration * 1000 / tag->timescale;
+
+    return 0;
+}
+
+ST_FUNC uint32_t ST_M4A_sampleRate(const ST_M4A *tag) {
+    if(!tag || tag->base.type != ST_TagType_M4A)
+        return (uint32_t)-1;
+
+    return tag->sample_rate;
+}
+
+ST_FUNC uint32_t ST_M4A_channels(const ST_M4A *tag) {
+    if(!tag || tag->base.type != ST_TagType_M4A)
+        return (uint32_t)-1;
+
+    return tag->channels;
+}
+
+ST_FUNC uint32_t ST_M4A_bitsPerSample(const ST_M4A *tag) {
+    if(!tag || tag->base.type != ST_TagType_M4A)
+        return (uint32_t)-1;
+
+    return tag->bits_per_sample;
+}
+
+ST_FUNC uint32_t ST_M4A_bitrate(const ST_M4A *tag) {
+    if(!tag || tag->base.type != ST_TagType_M4A)
+        return (uint32_t)-1;
+
+    return tag->bitrate;
+}
+
 #ifdef ST_HAVE_COREFOUNDATION
 ST_FUNC CFStringRef ST_M4A_copyTitle(const ST_M4A *tag, ST_Error *err) {
     return ST_M4A_copyAtomForKey(tag, ST_AtomTitle, 0, err);
@@ -431,7 +909,7 @@ ST_FUNC ST_Error ST_M4A_addPicture(ST_M4A *tag, ST_Picture *picture) {
         return ST_Error_InvalidArgument;
 
     count = tag->picture_count;
-    if(!(tmp = realloc(tag->pictures, (count + 1) * sizeof(ST_Picture *))))
+    if(!(tmp = ST_realloc(tag->pictures, (count + 1) * sizeof(ST_Picture *))))
         return ST_Error_errno;
 
     tag->pictures = (ST_Picture **)tmp;
@@ -457,7 +935,7 @@ ST_FUNC ST_Error ST_M4A_removePicture(ST_M4A *tag, int index) {
         tag->pictures[i] = tag->pictures[i + 1];
     }
 
-    if(!(tmp = realloc(tag->pictures, (count - 1) * sizeof(ST_Picture *)))) {
+    if(!(tmp = ST_realloc(tag->pictures, (count - 1) * sizeof(ST_Picture *)))) {
         /* Uhh... This shouldn't happen, since we're making it smaller... */
     }
     else {
@@ -536,9 +1014,17 @@ ST_FUNC CFDictionaryRef ST_M4A_copyDictionary(const ST_M4A *tag) {
 }
 #endif
 
-ST_FUNC ST_Error ST_M4A_addAtom(ST_M4A *tag, ST_M4A_AtomCode code,
-                                const char *lname, uint8_t *value, size_t len,
-                                int ownbuf) {
+/* How much of a long name given to us by hand is the mean part of it. These
+   are the mean and name joined with a dot, so split them at the last one. */
+static size_t mean_length(const char *lname) {
+    const char *dot = strrchr(lname, '.');
+
+    return dot ? (size_t)(dot - lname) : strlen(lname);
+}
+
+static ST_Error add_atom(ST_M4A *tag, ST_M4A_AtomCode code, const char *lname,
+                         size_t mlen, uint8_t *value, size_t len, int ownbuf,
+                         uint32_t type) {
     uint8_t *tmp = value;
     char *ln = NULL;
     ST_M4A_Atom *atom;
@@ -547,11 +1033,11 @@ ST_FUNC ST_Error ST_M4A_addAtom(ST_M4A *tag, ST_M4A_AtomCode code,
     if(!tag || !value || !len || tag->base.type != ST_TagType_M4A)
         return ST_Error_InvalidArgument;
 
-    if(!ownbuf && !(tmp = (uint8_t *)malloc(len)))
+    if(!ownbuf && !(tmp = (uint8_t *)ST_malloc(len)))
         return ST_Error_errno;
 
-    if(lname && !(ln = strdup(lname))) {
-        free(tmp);
+    if(lname && !(ln = ST_strdup(lname))) {
+        ST_free(tmp);
         return ST_Error_errno;
     }
 
@@ -559,17 +1045,29 @@ ST_FUNC ST_Error ST_M4A_addAtom(ST_M4A *tag, ST_M4A_AtomCode code,
         memcpy(tmp, value, len);
 
     if(!(atom = create_atom(len, tmp, ln))) {
-        free(tmp);
-        free(ln);
+        ST_free(tmp);
+        ST_free(ln);
         return ST_Error_errno;
     }
 
+    atom->type = type;
+    atom->mean_len = mlen;
+
     if((rv = ST_Dict_add(tag->atoms, &code, atom)) != ST_Error_None)
         free_atom(atom);
+    else
+        update_item(tag, code);
 
     return rv;
 }
 
+ST_FUNC ST_Error ST_M4A_addAtom(ST_M4A *tag, ST_M4A_AtomCode code,
+                                const char *lname, uint8_t *value, size_t len,
+                                int ownbuf) {
+    return add_atom(tag, code, lname, lname ? mean_length(lname) : 0, value,
+                    len, ownbuf, data_type(code));
+}
+
 #ifdef ST_HAVE_COREFOUNDATION
 ST_FUNC ST_Error ST_M4A_addAtomStr(ST_M4A *tag, ST_M4A_AtomCode code,
                                    const char *lname, CFStringRef value) {
@@ -580,16 +1078,21 @@ ST_FUNC ST_Error ST_M4A_addAtomStr(ST_M4A *tag, ST_M4A_AtomCode code,
     if(!tag || !value || tag->base.type != ST_TagType_M4A)
         return ST_Error_InvalidArgument;
 
-    if(lname && !(ln = strdup(lname)))
+    if(lname && !(ln = ST_strdup(lname)))
         return ST_Error_errno;
 
     if(!(atom = create_atom_str(value, ln))) {
-        free(ln);
+        ST_free(ln);
         return ST_Error_errno;
     }
 
+    if(ln)
+        atom->mean_len = mean_length(ln);
+
     if((rv = ST_Dict_add(tag->atoms, &code, atom)) != ST_Error_None)
         free_atom(atom);
+    else
+        update_item(tag, code);
 
     return rv;
 }
@@ -603,16 +1106,23 @@ ST_FUNC ST_Error ST_M4A_addAtomData(ST_M4A *tag, ST_M4A_AtomCode code,
     if(!tag || !value || tag->base.type != ST_TagType_M4A)
         return ST_Error_InvalidArgument;
 
-    if(lname && !(ln = strdup(lname)))
+    if(lname && !(ln = ST_strdup(lname)))
         return ST_Error_errno;
 
     if(!(atom = create_atom_data(value, ln))) {
-        free(ln);
+        ST_free(ln);
         return ST_Error_errno;
     }
 
+    atom->type = data_type(code);
+
+    if(ln)
+        atom->mean_len = mean_length(ln);
+
     if((rv = ST_Dict_add(tag->atoms, &code, atom)) != ST_Error_None)
         free_atom(atom);
+    else
+        update_item(tag, code);
 
     return rv;
 }
@@ -620,10 +1130,15 @@ ST_FUNC ST_Error ST_M4A_addAtomData(ST_M4A *tag, ST_M4A_AtomCode code,
 
 ST_FUNC ST_Error ST_M4A_removeAtom(ST_M4A *tag, ST_M4A_AtomCode code,
                                    int index) {
+    ST_Error rv;
+
     if(!tag || index < -1 || tag->base.type != ST_TagType_M4A)
         return ST_Error_InvalidArgument;
 
-    return ST_Dict_remove(tag->atoms, &code, index);
+    if((rv = ST_Dict_remove(tag->atoms, &code, index)) == ST_Error_None)
+        update_item(tag, code);
+
+    return rv;
 }
 
 static ST_Error replace_tag(ST_M4A *tag, ST_M4A_AtomCode k, const uint8_t *v,
@@ -636,13 +1151,13 @@ static ST_Error replace_tag(ST_M4A *tag, ST_M4A_AtomCode k, const uint8_t *v,
        e != ST_TextEncoding_UTF8)
         return ST_Error_InvalidArgument;
 
-    if(!(tmp = (uint8_t *)malloc(len)))
+    if(!(tmp = (uint8_t *)ST_malloc(len)))
         return ST_Error_errno;
 
     memcpy(tmp, v, len);
 
     if(!(atom = create_atom(len, tmp, NULL))) {
-        free(tmp);
+        ST_free(tmp);
         return ST_Error_errno;
     }
 
@@ -653,6 +1168,8 @@ static ST_Error replace_tag(ST_M4A *tag, ST_M4A_AtomCode k, const uint8_t *v,
 
     if(rv != ST_Error_None)
         free_atom(atom);
+    else
+        update_item(tag, k);
 
     return rv;
 }
@@ -675,6 +1192,8 @@ static ST_Error replace_tag_str(ST_M4A *tag, ST_M4A_AtomCode k, CFStringRef v) {
 
     if(rv != ST_Error_None)
         free_atom(atom);
+    else
+        update_item(tag, k);
 
     return rv;
 }
@@ -721,27 +1240,28 @@ ST_FUNC ST_Error ST_M4A_setTrack(ST_M4A *tag, int v) {
     if(!tag || tag->base.type != ST_TagType_M4A)
         return ST_Error_InvalidArgument;
 
-    if(!(nv = (uint8_t *)malloc(8)))
+    if(!(nv = (uint8_t *)ST_malloc(8)))
         return ST_Error_errno;
 
     ST_M4A_atomForKey(tag, atom_type, 0, buf, 32);
     sz = ST_M4A_atomLengthForKey(tag, atom_type, 0);
 
-    /* Did we have something? If so, copy it. */
-    if(sz == 8) {
+    /* Did we have something? If so, copy it to keep the total. */
+    if(sz == 8)
         memcpy(nv, buf, 8);
-    }
-    else {
+    else
         memset(nv, 0, 8);
-        nv[2] = (uint8_t)(v >> 8);
-        nv[3] = (uint8_t)v;
-    }
+
+    nv[2] = (uint8_t)(v >> 8);
+    nv[3] = (uint8_t)v;
 
     if(!(atom = create_atom(8, nv, NULL))) {
-        free(nv);
+        ST_free(nv);
         return ST_Error_errno;
     }
 
+    atom->type = ST_M4A_DataType_Implicit;
+
     /* Replace the old one, if there is one. */
     rv = ST_Dict_replace(tag->atoms, &atom_type, 0, atom);
 
@@ -750,6 +1270,8 @@ ST_FUNC ST_Error ST_M4A_setTrack(ST_M4A *tag, int v) {
 
     if(rv != ST_Error_None)
         free_atom(atom);
+    else
+        update_item(tag, atom_type);
 
     return rv;
 }
@@ -765,27 +1287,28 @@ ST_FUNC ST_Error ST_M4A_setDisc(ST_M4A *tag, int v) {
     if(!tag || tag->base.type != ST_TagType_M4A)
         return ST_Error_InvalidArgument;
 
-    if(!(nv = (uint8_t *)malloc(6)))
+    if(!(nv = (uint8_t *)ST_malloc(6)))
         return ST_Error_errno;
 
     ST_M4A_atomForKey(tag, atom_type, 0, buf, 32);
     sz = ST_M4A_atomLengthForKey(tag, atom_type, 0);
 
-    /* Did we have something? If so, copy it. */
-    if(sz == 6) {
+    /* Did we have something? If so, copy it to keep the total. */
+    if(sz == 6)
         memcpy(nv, buf, 6);
-    }
-    else {
+    else
         memset(nv, 0, 6);
-        nv[2] = (uint8_t)(v >> 8);
-        nv[3] = (uint8_t)v;
-    }
+
+    nv[2] = (uint8_t)(v >> 8);
+    nv[3] = (uint8_t)v;
 
     if(!(atom = create_atom(6, nv, NULL))) {
-        free(nv);
+        ST_free(nv);
         return ST_Error_errno;
     }
 
+    atom->type = ST_M4A_DataType_Implicit;
+
     /* Replace the old one, if there is one. */
     rv = ST_Dict_replace(tag->atoms, &atom_type, 0, atom);
 
@@ -794,6 +1317,8 @@ ST_FUNC ST_Error ST_M4A_setDisc(ST_M4A *tag, int v) {
 
     if(rv != ST_Error_None)
         free_atom(atom);
+    else
+        update_item(tag, atom_type);
 
     return rv;
 }
@@ -824,23 +1349,25 @@ ST_FUNC ST_Error ST_M4A_setGenreStr(ST_M4A *tag, CFStringRef v) {
 }
 #endif
 
-static long find_atom(ST_M4A_AtomCode atom, FILE *fp, uint64_t container,
-                     uint64_t *atom_sz) {
+static off_t find_atom(ST_M4A_AtomCode atom, FILE *fp, uint64_t container,
+                       uint64_t *atom_sz) {
     uint32_t fourcc;
     uint32_t atomsz;
     uint64_t ratomsz;
     uint8_t buf[8];
-    long cur, tmp;
+    off_t cur, tmp;
 
     while(container) {
-        if((cur = ftell(fp)) < 0)
+        if((cur = ftello(fp)) < 0)
             return -1;
 
         if(fread(buf, 1, 8, fp) != 8)
             return -1;
 
-        atomsz = (buf[0] << 24) | (buf[1] << 16) | (buf[2] << 8) | buf[3];
-        fourcc = (buf[4] << 24) | (buf[5] << 16) | (buf[6] << 8) | buf[7];
+        atomsz = ((uint32_t)buf[0] << 24) | (buf[1] << 16) | (buf[2] << 8) |
+            buf[3];
+        fourcc = ((uint32_t)buf[4] << 24) | (buf[5] << 16) | (buf[6] << 8) |
+            buf[7];
 
         /* If the atom size is 1, the real atom size is stored in the next 8
            bytes. */
@@ -852,32 +1379,40 @@ static long find_atom(ST_M4A_AtomCode atom, FILE *fp, uint64_t container,
                 ((uint64_t)buf[2] << 40) | ((uint64_t)buf[3] << 32) |
                 ((uint64_t)buf[4] << 24) | ((uint64_t)buf[5] << 16) |
                 ((uint64_t)buf[6] << 8) | (uint64_t)buf[7];
+
+            if(ratomsz < 16)
+                return -1;
         }
         else if(atomsz == 0) {
-            fseek(fp, 0, SEEK_END);
-            tmp = ftell(fp);
+            if(fseeko(fp, 0, SEEK_END) || (tmp = ftello(fp)) < 0)
+                return -1;
+
             ratomsz = (uint64_t)(tmp - cur);
-            fseek(fp, cur, SEEK_SET);
+
+            if(fseeko(fp, cur + 8, SEEK_SET))
+                return -1;
+        }
+        else if(atomsz < 8) {
+            return -1;
         }
         else {
             ratomsz = (uint64_t)atomsz;
         }
 
+        /* An atom can't be bigger than what contains it. */
+        if(ratomsz > container)
+            return -1;
+
         if(fourcc != (uint32_t)atom) {
-            /* Check the size to see where to go next */
-            if(atomsz == 1) {
-                fseek(fp, (long)ratomsz - 16, SEEK_CUR);
-                container -= ratomsz;
-            }
-            else if(atomsz == 0) {
-                /* If the atom size is 0, it goes to the end of the file, so
-                   we're never going to find it. */
+            /* If the atom size is 0, it goes to the end of the file, so we're
+               never going to find it. */
+            if(atomsz == 0)
                 return -2;
-            }
-            else {
-                fseek(fp, (long)atomsz - 8, SEEK_CUR);
-                container -= atomsz;
-            }
+
+            if(fseeko(fp, cur + (off_t)ratomsz, SEEK_SET))
+                return -1;
+
+            container -= ratomsz;
         }
         else {
             *atom_sz = ratomsz;
@@ -888,192 +1423,1567 @@ static long find_atom(ST_M4A_AtomCode atom, FILE *fp, uint64_t container,
     return -2;
 }
 
-static int parse_file(ST_M4A *tag, FILE *fp) {
-    uint8_t buf[16];
-    uint32_t fourcc;
-    uint64_t atomsz, atomread, atomsz2;
-    uint64_t moovsz, udtasz, metasz, ilstsz, meansz, namesz;
-    long pos, meanp, namep;
-    uint8_t *tmp;
-    char *mean = NULL;
-    long size;
-    ST_Picture *pic;
+/* Read the size and type of an atom from a buffer of at least 16 bytes (or 8,
+   if the atom doesn't use a 64-bit size). Returns the length of the header, or
+   0 if the atom is obviously bogus. An atom size of 0 is returned as is. */
+static int atom_header(const uint8_t *buf, uint64_t len, uint64_t *sz,
+                       uint32_t *fourcc) {
+    uint32_t atomsz;
 
-    /* Figure out how long the file is */
-    fseek(fp, 0, SEEK_END);
-    size = ftell(fp);
-    fseek(fp, 0, SEEK_SET);
+    if(len < 8)
+        return 0;
 
-    /* Read in the first 8 bytes of the file, and make sure it is as we would
-       expect it to be */
-    if(fread(buf, 1, 8, fp) != 8)
-        goto out_close;
+    atomsz = ((uint32_t)buf[0] << 24) | (buf[1] << 16) | (buf[2] << 8) |
+        buf[3];
+    *fourcc = ((uint32_t)buf[4] << 24) | (buf[5] << 16) | (buf[6] << 8) |
+        buf[7];
 
-    atomsz = (buf[0] << 24) | (buf[1] << 16) | (buf[2] << 8) | buf[3];
-    fourcc = (buf[4] << 24) | (buf[5] << 16) | (buf[6] << 8) | buf[7];
+    if(atomsz == 1) {
+        if(len < 16)
+            return 0;
 
-    if(fourcc != ST_AtomFileType)
-        goto out_close;
+        *sz = ((uint64_t)buf[8] << 56) | ((uint64_t)buf[9] << 48) |
+            ((uint64_t)buf[10] << 40) | ((uint64_t)buf[11] << 32) |
+            ((uint64_t)buf[12] << 24) | ((uint64_t)buf[13] << 16) |
+            ((uint64_t)buf[14] << 8) | (uint64_t)buf[15];
 
-    /* Make sure we have at least one type of information in here */
-    if(atomsz < 12)
-        goto out_close;
+        return *sz < 16 ? 0 : 16;
+    }
 
-    /* Read in the type of data contained within */
-    if(fread(buf, 1, 4, fp) != 4)
-        goto out_close;
+    *sz = (uint64_t)atomsz;
+    return (atomsz && atomsz < 8) ? 0 : 8;
+}
 
-    if(buf[0] != 'M' || buf[1] != '4' || buf[2] != 'A' || buf[3] != ' ')
-        goto out_close;
+/* Find an atom within an in-memory container. Returns a pointer to the start
+   of the atom's contents and fills in their length, or NULL if not found. */
+static const uint8_t *find_atom_buf(ST_M4A_AtomCode atom, const uint8_t *buf,
+                                    uint64_t len, uint64_t *data_sz) {
+    uint64_t sz;
+    uint32_t fourcc;
+    int hdr;
 
-    /* We don't care about the rest of the ftyp */
-    fseek(fp, atomsz, SEEK_SET);
+    while(len) {
+        if(!(hdr = atom_header(buf, len, &sz, &fourcc)))
+            return NULL;
 
-    /* Next, find the "moov" atom, since its the toplevel container for what the
-       tags are in */
-    if(find_atom(ST_AtomMovieData, fp, size - atomsz, &moovsz) < 0)
-        goto out_close;
+        /* A size of 0 means the atom runs to the end of the container. */
+        if(!sz)
+            sz = len;
 
-    /* Now, we need the "udta" atom */
-    if(find_atom(ST_AtomUserData, fp, moovsz, &udtasz) < 0)
-        goto out_close;
+        if(sz > len || sz < (uint64_t)hdr)
+            return NULL;
 
-    /* Next up is the "meta" atom */
-    if(find_atom(ST_AtomMetadata, fp, udtasz, &metasz) < 0)
-        goto out_close;
+        if(fourcc == (uint32_t)atom) {
+            *data_sz = sz - hdr;
+            return buf + hdr;
+        }
 
-    /* The meta atom has an extra 4 bytes of version info in the header... */
-    fseek(fp, 4, SEEK_CUR);
+        buf += sz;
+        len -= sz;
+    }
 
-    /* Finally, the "ilst" atom */
-    if(find_atom(ST_AtomItemList, fp, metasz, &ilstsz) < 0)
-        goto out_close;
+    return NULL;
+}
 
-    /* Read in the entire ilst atom */
-    while(ilstsz > 8) {
-        pos = ftell(fp);
+/* See if there is a chain of top-level atoms starting at the given point in a
+   buffer that ends exactly at the end of the buffer. */
+static int atoms_fill_buf(const uint8_t *buf, uint64_t len) {
+    uint64_t sz;
+    uint32_t fourcc;
+    int i, hdr;
 
-        /* Read in the first 8 bytes of the next atom */
-        if(fread(buf, 1, 8, fp) != 8)
-            goto out_close;
+    while(len) {
+        if(!(hdr = atom_header(buf, len, &sz, &fourcc)) || sz > len)
+            return 0;
 
-        atomsz = (buf[0] << 24) | (buf[1] << 16) | (buf[2] << 8) | buf[3];
-        fourcc = (buf[4] << 24) | (buf[5] << 16) | (buf[6] << 8) | buf[7];
-        atomread = 8;
+        /* Atom types are always made up of printable characters. */
+        for(i = 4; i < 8; ++i) {
+            if(buf[i] < 0x20 || buf[i] > 0x7E)
+                return 0;
+        }
 
-        /* Figure out the real size of the atom */
-        if(atomsz == 1) {
-            if(fread(buf, 1, 8, fp) != 8)
-                goto out_close;
+        if(!sz)
+            return 1;
 
-            atomsz = ((uint64_t)buf[0] << 56) | ((uint64_t)buf[1] << 48) |
-                ((uint64_t)buf[2] << 40) | ((uint64_t)buf[3] << 32) |
-                ((uint64_t)buf[4] << 24) | ((uint64_t)buf[5] << 16) |
-                ((uint64_t)buf[6] << 8) | (uint64_t)buf[7];
-            atomread += 8;
+        buf += sz;
+        len -= sz;
+    }
+
+    return 1;
+}
+
+/* Look for the moov atom in the last part of the file. This is for files where
+   the media data comes before the moov, so that we don't have to go walking
+   past the media data to find it. */
+static uint8_t *read_moov_tail(FILE *fp, off_t size, off_t start,
+                               uint64_t *moov_sz, off_t *moov_pos,
+                               off_t *data_pos) {
+    uint8_t *buf;
+    void *tmp;
+    uint64_t wlen, i, sz;
+    uint32_t fourcc;
+    int hdr;
+
+    wlen = MIN((uint64_t)TAIL_WINDOW, (uint64_t)(size - start));
+
+    if(!(buf = (uint8_t *)ST_malloc((size_t)wlen)))
+        return NULL;
+
+    if(fseeko(fp, size - (off_t)wlen, SEEK_SET) ||
+       fread(buf, 1, (size_t)wlen, fp) != (size_t)wlen)
+        goto out_free;
+
+    /* The moov will be the first thing in the window that looks like an atom
+       header, and is followed by a chain of atoms to the end of the file. */
+    for(i = 0; i + 8 <= wlen; ++i) {
+        if(memcmp(buf + i + 4, "moov", 4))
+            continue;
+
+        if(!(hdr = atom_header(buf + i, wlen - i, &sz, &fourcc)) ||
+           !atoms_fill_buf(buf + i, wlen - i))
+            continue;
+
+        if(!sz)
+            sz = wlen - i;
+
+        *moov_sz = sz - hdr;
+        *moov_pos = size - (off_t)wlen + (off_t)i;
+        *data_pos = *moov_pos + hdr;
+
+        /* Move the contents to the front, and give back what we don't need. */
+        memmove(buf, buf + i + hdr, (size_t)*moov_sz);
+
+        if(*moov_sz && (tmp = ST_realloc(buf, (size_t)*moov_sz)))
+            buf = (uint8_t *)tmp;
+
+        return buf;
+    }
+
+out_free:
+    ST_free(buf);
+    return NULL;
+}
+
+/* Read the contents of the moov atom into memory in one go. The position of
+   the atom in the file is returned in moov_pos, and the position of its
+   contents (after the atom header) in data_pos. */
+static uint8_t *read_moov(FILE *fp, off_t size, off_t start, uint64_t *moov_sz,
+                          off_t *moov_pos, off_t *data_pos) {
+    uint8_t buf[16];
+    uint8_t *rv;
+    uint64_t sz;
+    uint32_t fourcc;
+    off_t pos = start;
+    size_t len;
+
+    /* Skip over any padding to see what the first real atom is. */
+    for(;;) {
+        if(fseeko(fp, pos, SEEK_SET))
+            return NULL;
+
+        len = fread(buf, 1, 16, fp);
+        if(!atom_header(buf, (uint64_t)len, &sz, &fourcc))
+            return NULL;
+
+        if(fourcc != ST_AtomFreeSpace && fourcc != ST_AtomSkip &&
+           fourcc != ST_AtomWide)
+            break;
+
+        if(!sz || sz > (uint64_t)(size - pos))
+            return NULL;
+
+        pos += (off_t)sz;
+    }
+
+    if(fourcc == ST_AtomMediaData &&
+       (rv = read_moov_tail(fp, size, pos, moov_sz, moov_pos, data_pos)))
+        return rv;
+
+    /* Otherwise, walk the top-level atoms from the front. */
+    if(fseeko(fp, pos, SEEK_SET))
+        return NULL;
+
+    if((*moov_pos = find_atom(ST_AtomMovieData, fp, (uint64_t)(size - pos),
+                              &sz)) < 0 || (*data_pos = ftello(fp)) < 0)
+        return NULL;
+
+    sz -= (uint64_t)(*data_pos - *moov_pos);
+
+    if(sz > (uint64_t)SIZE_MAX || !(rv = (uint8_t *)ST_malloc((size_t)sz)))
+        return NULL;
+
+    if(fread(rv, 1, (size_t)sz, fp) != (size_t)sz) {
+        ST_free(rv);
+        return NULL;
+    }
+
+    *moov_sz = sz;
+    return rv;
+}
+
+/* Build the long name of a '----' atom out of its mean and name atoms, and
+   note how much of it is the mean. */
+static char *long_name(const uint8_t *buf, uint64_t len, size_t *mlen) {
+    const uint8_t *mean, *name;
+    uint64_t meansz, namesz = 0;
+    char *rv;
+
+    /* Both of these have 4 bytes of version info before the actual string. */
+    if(!(mean = find_atom_buf(ST_AtomMeaning, buf, len, &meansz)) ||
+       meansz < 4)
+        return NULL;
+
+    if((name = find_atom_buf(ST_AtomName, buf, len, &namesz)) && namesz < 4)
+        name = NULL;
+
+    meansz -= 4;
+    namesz = name ? namesz - 4 : 0;
+
+    if(!(rv = (char *)ST_malloc((size_t)(meansz + namesz + 2))))
+        return NULL;
+
+    memcpy(rv, mean + 4, (size_t)meansz);
+    rv[meansz] = 0;
+    *mlen = (size_t)meansz;
+
+    if(name) {
+        rv[meansz] = '.';
+        memcpy(rv + meansz + 1, name + 4, (size_t)namesz);
+        rv[meansz + namesz + 1] = 0;
+    }
+
+    return rv;
+}
+
+/* Add one value out of a 'data' atom to the tag. */
+static uint32_t get_u32(const uint8_t *buf) {
+    return ((uint32_t)buf[0] << 24) | (buf[1] << 16) | (buf[2] << 8) | buf[3];
+}
+
+static uint64_t get_u64(const uint8_t *buf) {
+    return ((uint64_t)get_u32(buf) << 32) | get_u32(buf + 4);
+}
+
+static int add_data(ST_M4A *tag, uint32_t fourcc, const char *ln, size_t mlen,
+                    const uint8_t *buf, uint64_t len) {
+    ST_Picture *pic;
+    uint32_t type;
+
+    /* The first 8 bytes of any 'data' atom are the type of the data and the
+       locale. Empty ones don't get saved, since there's nothing to save. */
+    if(len <= 8)
+        return 0;
+
+    type = get_u32(buf) & 0x00FFFFFF;
+    buf += 8;
+    len -= 8;
+
+    if(fourcc != ST_AtomCoverArt) {
+        if(add_atom(tag, fourcc, ln, mlen, (uint8_t *)buf, (size_t)len, 0,
+                    type) != ST_Error_None)
+            return -1;
+    }
+    else {
+        if(len > UINT32_MAX || !(pic = ST_Picture_create()))
+            return -1;
+
+        if(ST_Picture_setData(pic, (uint8_t *)buf, (uint32_t)len,
+                              0) != ST_Error_None) {
+            ST_Picture_free(pic);
+            return -1;
         }
-        else if(atomsz == 0) {
-            atomsz = ilstsz;
+
+        if((type == ST_M4A_DataType_JPEG &&
+            ST_Picture_setMimeType(pic, "image/jpeg") != ST_Error_None) ||
+           (type == ST_M4A_DataType_PNG &&
+            ST_Picture_setMimeType(pic, "image/png") != ST_Error_None) ||
+           (type == ST_M4A_DataType_BMP &&
+            ST_Picture_setMimeType(pic, "image/bmp") != ST_Error_None)) {
+            ST_Picture_free(pic);
+            return -1;
+        }
+
+        if(ST_M4A_addPicture(tag, pic) != ST_Error_None) {
+            ST_Picture_free(pic);
+            return -1;
         }
+    }
+
+    return 0;
+}
+
+/* Walk the items in the ilst atom, which has already been read into memory. */
+static int parse_ilst(ST_M4A *tag, const uint8_t *buf, uint64_t len) {
+    uint64_t sz, itemsz, datasz;
+    uint32_t fourcc, dtype;
+    const uint8_t *item;
+    char *ln;
+    size_t mlen = 0;
+    int hdr, dhdr;
+
+    while(len >= 8) {
+        if(!(hdr = atom_header(buf, len, &sz, &fourcc)))
+            return -1;
+
+        /* A size of 0 means the atom runs to the end of the ilst. */
+        if(!sz)
+            sz = len;
+
+        /* Don't let a broken atom walk us out of the ilst. */
+        if(sz > len || sz < (uint64_t)hdr)
+            return -1;
+
+        item = buf + hdr;
+        itemsz = sz - hdr;
+        ln = NULL;
 
         /* Ignore free atoms, since they're just empty space... */
         if(fourcc == ST_AtomFreeSpace)
-            goto doneAtom;
-
-        /* Do we have a '----' atom? */
-        if(fourcc == ST_AtomLongName) {
-            /* Find the sizes of both the name and mean atom, if we have them
-               both. */
-            if((namep = find_atom(ST_AtomName, fp, atomsz - atomread,
-                                  &namesz)) < 0) {
-                namesz = 0;
-            }
-            else {
-                namesz -= 12;
+            goto next;
+
+        /* Do we have a '----' atom? If so, it needs its long name. */
+        if(fourcc == ST_AtomLongName &&
+           !(ln = long_name(item, itemsz, &mlen)))
+            goto next;
+
+        /* Now that we have that, fetch the data. There may be more than one
+           data atom (for instance, multiple pieces of cover art). */
+        while(itemsz >= 8) {
+            if(!(dhdr = atom_header(item, itemsz, &datasz, &dtype)))
+                break;
+
+            if(!datasz)
+                datasz = itemsz;
+
+            if(datasz > itemsz || datasz < (uint64_t)dhdr)
+                break;
+
+            if(dtype == ST_AtomData &&
+               add_data(tag, fourcc, ln, mlen, item + dhdr, datasz - dhdr)) {
+                ST_free(ln);
+                return -1;
             }
 
-            fseek(fp, pos + atomread, SEEK_SET);
+            item += datasz;
+            itemsz -= datasz;
+        }
 
-            if((meanp = find_atom(ST_AtomMeaning, fp, atomsz - atomread,
-                                  &meansz)) < 0)
-                goto doneAtom;
+        ST_free(ln);
 
-            meansz -= 12;
+    next:
+        buf += sz;
+        len -= sz;
+    }
 
-            /* Allocate space, and read them in */
-            if(!(mean = (char *)malloc(namesz + meansz + 2)))
-                goto doneAtom;
+    return 0;
+}
 
-            /* Read them in */
-            fseek(fp, 4, SEEK_CUR);
-            if(fread(mean, 1, meansz, fp) != meansz)
-                goto out_close;
+/* Read the timescale and duration out of a mvhd or mdhd atom. These have the
+   same layout for the parts we care about. */
+static void parse_time(const uint8_t *buf, uint64_t len, uint32_t *timescale,
+                       uint64_t *duration) {
+    if(len >= 32 && buf[0] == 1) {
+        *timescale = get_u32(buf + 20);
+        *duration = get_u64(buf + 24);
+    }
+    else if(len >= 20 && buf[0] == 0) {
+        *timescale = get_u32(buf + 12);
+        *duration = get_u32(buf + 16);
+    }
+}
 
-            if(namep >= 0) {
-                mean[meansz] = '.';
-                fseek(fp, namep + 12, SEEK_SET);
-                if(fread(mean + meansz + 1, 1, namesz, fp) != namesz)
-                    goto out_close;
-            }
+/* Read the length of an MPEG-4 descriptor. Returns the number of bytes the
+   length took up, or 0 on error. */
+static int desc_len(const uint8_t *buf, uint64_t len, uint32_t *sz) {
+    int i;
+
+    *sz = 0;
+
+    for(i = 0; i < 4 && (uint64_t)i < len; ++i) {
+        *sz = (*sz << 7) | (buf[i] & 0x7F);
+
+        if(!(buf[i] & 0x80))
+            return i + 1;
+    }
+
+    return 0;
+}
+
+/* Pull the average bitrate out of an esds atom. */
+static uint32_t parse_esds(const uint8_t *buf, uint64_t len) {
+    uint32_t sz;
+    uint8_t flags;
+    int n;
+
+    /* Skip the version/flags, and look for the ES_Descriptor. */
+    if(len < 6 || buf[4] != 0x03 || !(n = desc_len(buf + 5, len - 5, &sz)))
+        return 0;
+
+    buf += 5 + n;
+    len -= 5 + n;
+
+    if(len < 3)
+        return 0;
+
+    /* Skip the ES_ID and flags, plus whatever optional bits the flags say are
+       there. */
+    flags = buf[2];
+    buf += 3;
+    len -= 3;
+
+    if(flags & 0x80) {
+        if(len < 2)
+            return 0;
+
+        buf += 2;
+        len -= 2;
+    }
+
+    if(flags & 0x40) {
+        if(len < 1 || len < 1 + (uint64_t)buf[0])
+            return 0;
+
+        len -= 1 + buf[0];
+        buf += 1 + buf[0];
+    }
+
+    if(flags & 0x20) {
+        if(len < 2)
+            return 0;
+
+        buf += 2;
+        len -= 2;
+    }
+
+    /* Now the DecoderConfigDescriptor, which has the bitrate. */
+    if(len < 2 || buf[0] != 0x04 || !(n = desc_len(buf + 1, len - 1, &sz)))
+        return 0;
+
+    buf += 1 + n;
+    len -= 1 + n;
+
+    if(len < 13)
+        return 0;
+
+    return get_u32(buf + 9);
+}
+
+/* Pick out what we want from the sample description of a sound track. */
+static void parse_stsd(ST_M4A *tag, const uint8_t *buf, uint64_t len) {
+    const uint8_t *ent, *box;
+    uint64_t entsz, boxsz, skip;
+    uint32_t fourcc;
+    int hdr;
+
+    /* Skip the version/flags and entry count, then look at the first entry. */
+    if(len < 8 || !(hdr = atom_header(buf + 8, len - 8, &entsz, &fourcc)) ||
+       entsz > len - 8 || entsz < (uint64_t)hdr + 28)
+        return;
 
-            mean[meansz + namesz + 1] = 0;
+    ent = buf + 8 + hdr;
+    entsz -= hdr;
 
-            /* Go back to the normal flow of things... */
-            fseek(fp, pos + atomread, SEEK_SET);
+    /* This is the same for ISO and QuickTime (version 0 and 1) sound sample
+       descriptions. */
+    tag->channels = (ent[16] << 8) | ent[17];
+    tag->bits_per_sample = (ent[18] << 8) | ent[19];
+    tag->sample_rate = get_u32(ent + 24) >> 16;
+
+    /* QuickTime sound descriptions can have extra fields after that. */
+    skip = 28;
+
+    if(ent[9] == 1)
+        skip += 16;
+    else if(ent[9] == 2)
+        skip += 36;
+
+    if(entsz < skip)
+        return;
+
+    if(fourcc == ST_4CC('m', 'p', '4', 'a')) {
+        if((box = find_atom_buf(ST_4CC('e', 's', 'd', 's'), ent + skip,
+                                entsz - skip, &boxsz)))
+            tag->bitrate = parse_esds(box, boxsz);
+    }
+    else if(fourcc == ST_4CC('a', 'l', 'a', 'c')) {
+        /* ALAC keeps the real values in its magic cookie. */
+        if((box = find_atom_buf(ST_4CC('a', 'l', 'a', 'c'), ent + skip,
+                                entsz - skip, &boxsz)) && boxsz >= 28) {
+            tag->bits_per_sample = box[9];
+            tag->channels = box[13];
+            tag->bitrate = get_u32(box + 20);
+            tag->sample_rate = get_u32(box + 24);
         }
+    }
+}
+
+/* Add up the sizes of all the samples in a stsz atom. */
+static uint64_t sample_bytes(const uint8_t *buf, uint64_t len) {
+    uint64_t rv = 0;
+    uint32_t sz, cnt, i;
+
+    if(len < 12)
+        return 0;
+
+    sz = get_u32(buf + 4);
+    cnt = get_u32(buf + 8);
+
+    if(sz)
+        return (uint64_t)sz * cnt;
+
+    if(cnt > (len - 12) / 4)
+        return 0;
+
+    for(i = 0; i < cnt; ++i) {
+        rv += get_u32(buf + 12 + i * 4);
+    }
+
+    return rv;
+}
+
+/* Find the first trak in the moov with the given handler type and/or track ID
+   (either can be 0 to match anything). Returns a pointer to the mdia atom's
+   contents, since that's where everything interesting is. */
+static const uint8_t *find_trak(const uint8_t *moov, uint64_t len,
+                                uint32_t handler, uint32_t id,
+                                const uint8_t **trak, uint64_t *traksz,
+                                uint64_t *mdiasz) {
+    const uint8_t *mdia, *hdlr, *tkhd;
+    uint64_t sz, hdlrsz, tkhdsz;
+    uint32_t fourcc;
+    int hdr;
+
+    for(; len; moov += sz, len -= sz) {
+        if(!(hdr = atom_header(moov, len, &sz, &fourcc)))
+            return NULL;
+
+        if(!sz)
+            sz = len;
+
+        if(sz > len)
+            return NULL;
+
+        if(fourcc != ST_4CC('t', 'r', 'a', 'k'))
+            continue;
+
+        *trak = moov + hdr;
+        *traksz = sz - hdr;
+
+        if(!(mdia = find_atom_buf(ST_4CC('m', 'd', 'i', 'a'), *trak, *traksz,
+                                  mdiasz)))
+            continue;
+
+        if(handler &&
+           (!(hdlr = find_atom_buf(ST_4CC('h', 'd', 'l', 'r'), mdia, *mdiasz,
+                                   &hdlrsz)) || hdlrsz < 12 ||
+            get_u32(hdlr + 8) != handler))
+            continue;
+
+        /* The track ID is in the tkhd, after the creation and modification
+           times (which are 64-bit in version 1). */
+        if(id &&
+           (!(tkhd = find_atom_buf(ST_4CC('t', 'k', 'h', 'd'), *trak, *traksz,
+                                   &tkhdsz)) || tkhdsz < 24 ||
+            get_u32(tkhd + (tkhd[0] == 1 ? 20 : 12)) != id))
+            continue;
+
+        return mdia;
+    }
+
+    return NULL;
+}
+
+/* Find the sample table of a track, given its mdia atom. */
+static const uint8_t *find_stbl(const uint8_t *mdia, uint64_t mdiasz,
+                                uint64_t *stblsz) {
+    const uint8_t *minf;
+    uint64_t minfsz;
+
+    if(!(minf = find_atom_buf(ST_4CC('m', 'i', 'n', 'f'), mdia, mdiasz,
+                              &minfsz)))
+        return NULL;
+
+    return find_atom_buf(ST_4CC('s', 't', 'b', 'l'), minf, minfsz, stblsz);
+}
+
+/* Pick up the audio properties from the moov. The first sound track is the one
+   we report on. */
+static void parse_props(ST_M4A *tag, const uint8_t *moov, uint64_t len) {
+    const uint8_t *trak, *mdia, *mdhd, *stbl, *stsd, *stsz;
+    uint64_t traksz, mdiasz, mdhdsz, stblsz, stsdsz, stszsz;
+
+    if((mdhd = find_atom_buf(ST_4CC('m', 'v', 'h', 'd'), moov, len, &mdhdsz)))
+        parse_time(mdhd, mdhdsz, &tag->timescale, &tag->duration);
+
+    if(!(mdia = find_trak(moov, len, ST_4CC('s', 'o', 'u', 'n'), 0, &trak,
+                          &traksz, &mdiasz)))
+        return;
+
+    if((mdhd = find_atom_buf(ST_4CC('m', 'd', 'h', 'd'), mdia, mdiasz,
+                             &mdhdsz)))
+        parse_time(mdhd, mdhdsz, &tag->audio_timescale, &tag->audio_duration);
+
+    if(!(stbl = find_stbl(mdia, mdiasz, &stblsz)))
+        return;
 
-        /* Now that we have that, fetch the data */
-        if(find_atom(ST_AtomData, fp, atomsz - atomread, &atomsz2) < 0)
-            goto doneAtom;
+    if((stsd = find_atom_buf(ST_4CC('s', 't', 's', 'd'), stbl, stblsz,
+                             &stsdsz)))
+        parse_stsd(tag, stsd, stsdsz);
 
-        /* Skip the first 8 bytes of any 'data' atom */
-        fseek(fp, 8, SEEK_CUR);
-        atomsz2 -= 16;
+    /* If the file didn't say what the bitrate is, work it out from the size of
+       the samples. */
+    if(!tag->bitrate && tag->audio_timescale && tag->audio_duration &&
+       (stsz = find_atom_buf(ST_4CC('s', 't', 's', 'z'), stbl, stblsz,
+                             &stszsz)))
+        tag->bitrate = (uint32_t)(sample_bytes(stsz, stszsz) * 8 *
+                                  tag->audio_timescale / tag->audio_duration);
+}
+
+/* Read the chapter list out of a Nero chpl atom. The start times in there are
+   in units of 100ns. */
+static int parse_chpl(ST_M4A *tag, const uint8_t *buf, uint64_t len) {
+    uint64_t pos = 4;
+    int i, count;
+    uint8_t slen;
+
+    if(len < 6)
+        return -1;
+
+    /* Version 1 has an extra 4 bytes before the count. */
+    if(buf[0] == 1)
+        pos += 4;
+
+    if(pos >= len)
+        return -1;
+
+    count = buf[pos++];
+
+    if(!count)
+        return 0;
+
+    if(!(tag->chapters = (m4a_chapter_t *)ST_calloc(count,
+                                                    sizeof(m4a_chapter_t))))
+        return -1;
+
+    for(i = 0; i < count; ++i) {
+        if(len - pos < 9 || len - pos - 9 < buf[pos + 8])
+            break;
+
+        slen = buf[pos + 8];
+        tag->chapters[i].start = get_u64(buf + pos) / 10000;
+
+        if(!(tag->chapters[i].title = (char *)ST_malloc(slen + 1)))
+            break;
+
+        memcpy(tag->chapters[i].title, buf + pos + 9, slen);
+        tag->chapters[i].title[slen] = 0;
+        pos += 9 + slen;
+    }
 
-        if(atomsz2 & 0xFFFFFFFF00000000ULL)
-            atomsz2 -= 8;
+    tag->chapter_count = i;
+    return 0;
+}
+
+/* Work out the start time and the location of the title of each chapter in a
+   QuickTime chapter track. This only looks at the sample tables, the titles
+   themselves are read later on. */
+static int parse_chap_stbl(ST_M4A *tag, const uint8_t *stbl, uint64_t stblsz,
+                           uint32_t timescale, off_t size) {
+    const uint8_t *stts, *stsc, *stsz, *stco;
+    uint64_t sttssz, stscsz, stszsz, stcosz, t = 0, off, total = 0;
+    uint32_t count, sz, n, i, j, k, e, chunks, first, next, spc, ent, ochunks;
+    int co64 = 0;
+    m4a_chapter_t *ch;
+
+    if(!(stts = find_atom_buf(ST_4CC('s', 't', 't', 's'), stbl, stblsz,
+                              &sttssz)) ||
+       !(stsc = find_atom_buf(ST_4CC('s', 't', 's', 'c'), stbl, stblsz,
+                              &stscsz)) ||
+       !(stsz = find_atom_buf(ST_4CC('s', 't', 's', 'z'), stbl, stblsz,
+                              &stszsz)) ||
+       sttssz < 8 || stscsz < 8 || stszsz < 12)
+        return -1;
+
+    if(!(stco = find_atom_buf(ST_4CC('s', 't', 'c', 'o'), stbl, stblsz,
+                              &stcosz))) {
+        if(!(stco = find_atom_buf(ST_4CC('c', 'o', '6', '4'), stbl, stblsz,
+                                  &stcosz)))
+            return -1;
+
+        co64 = 1;
+    }
+
+    if(stcosz < 8)
+        return -1;
+
+    /* One chapter per sample. */
+    sz = get_u32(stsz + 4);
+    count = get_u32(stsz + 8);
+
+    if(!sz && count > (stszsz - 12) / 4)
+        count = (uint32_t)((stszsz - 12) / 4);
+
+    /* The count of a fixed sample size comes straight from the file, so don't
+       trust it any further than the time-to-sample table goes, or than that
+       many samples would fit in the file. */
+    ent = get_u32(stts + 4);
+
+    if((uint64_t)ent > (sttssz - 8) / 8)
+        ent = (uint32_t)((sttssz - 8) / 8);
+
+    for(e = 0; e < ent; ++e) {
+        total += get_u32(stts + 8 + e * 8);
+    }
 
-        /* Save the data in our dictionary */
-        if(!(tmp = (uint8_t *)malloc(atomsz2)))
-            goto out_close;
+    if(count > total)
+        count = (uint32_t)total;
 
-        if(fread(tmp, 1, atomsz2, fp) != atomsz2)
-            goto out_close;
+    if(sz && count > (uint64_t)size / sz)
+        count = (uint32_t)((uint64_t)size / sz);
 
-        if(fourcc != ST_AtomCoverArt) {
-            if(ST_M4A_addAtom(tag, fourcc, mean, tmp, atomsz2,
-                              1) != ST_Error_None)
-                goto out_close;
+    if(!count)
+        return 0;
+
+    if(!(ch = (m4a_chapter_t *)ST_calloc(count, sizeof(m4a_chapter_t))))
+        return -1;
+
+    /* Start times come from the time-to-sample table. */
+    for(i = 0, e = 0; e < ent && i < count; ++e) {
+        n = get_u32(stts + 8 + e * 8);
+
+        for(j = 0; j < n && i < count; ++j, ++i) {
+            ch[i].start = timescale ? t * 1000 / timescale : 0;
+            t += get_u32(stts + 12 + e * 8);
         }
-        else {
-            if(!(pic = ST_Picture_create()))
-                goto out_close;
+    }
+
+    /* Anything the table didn't cover can't be placed, so drop it. */
+    count = i;
+
+    /* Now, figure out where each sample is from the sample-to-chunk and chunk
+       offset tables. */
+    ent = get_u32(stsc + 4);
+    ochunks = get_u32(stco + 4);
+    chunks = (uint32_t)((stcosz - 8) / (co64 ? 8 : 4));
 
-            if(ST_Picture_setData(pic, tmp, (uint32_t)atomsz2,
-                                  1) != ST_Error_None)
-                goto out_close;
+    if(ochunks < chunks)
+        chunks = ochunks;
 
-            if(ST_M4A_addPicture(tag, pic) != ST_Error_None)
-                goto out_close;
+    if((uint64_t)ent > (stscsz - 8) / 12)
+        ent = (uint32_t)((stscsz - 8) / 12);
+
+    for(i = 0, e = 0; e < ent && i < count; ++e) {
+        first = get_u32(stsc + 8 + e * 12);
+        spc = get_u32(stsc + 12 + e * 12);
+        next = (e + 1 < ent) ? get_u32(stsc + 20 + e * 12) : chunks + 1;
+
+        for(j = first; j < next && j >= 1 && j <= chunks && i < count; ++j) {
+            off = co64 ? get_u64(stco + 8 + (j - 1) * 8) :
+                get_u32(stco + 8 + (j - 1) * 4);
+
+            for(k = 0; k < spc && i < count; ++k, ++i) {
+                ch[i].offset = (off_t)off;
+                ch[i].size = sz ? sz : get_u32(stsz + 12 + i * 4);
+                off += ch[i].size;
+            }
         }
+    }
+
+    tag->chapters = ch;
+    tag->chapter_count = i;
+    return 0;
+}
+
+/* Look for the chapter track referenced by the sound track, if there is
+   one. */
+static int parse_chap_trak(ST_M4A *tag, const uint8_t *moov, uint64_t len,
+                           off_t size) {
+    const uint8_t *trak, *mdia, *tref, *chap, *mdhd, *stbl;
+    uint64_t traksz, mdiasz, trefsz, chapsz, mdhdsz, stblsz, dur = 0;
+    uint32_t timescale = 0;
+
+    if(!find_trak(moov, len, ST_4CC('s', 'o', 'u', 'n'), 0, &trak, &traksz,
+                  &mdiasz))
+        return -1;
+
+    if(!(tref = find_atom_buf(ST_4CC('t', 'r', 'e', 'f'), trak, traksz,
+                              &trefsz)) ||
+       !(chap = find_atom_buf(ST_4CC('c', 'h', 'a', 'p'), tref, trefsz,
+                              &chapsz)) || chapsz < 4)
+        return -1;
+
+    /* Only the first chapter track is used. */
+    if(!(mdia = find_trak(moov, len, 0, get_u32(chap), &trak, &traksz,
+                          &mdiasz)))
+        return -1;
+
+    if((mdhd = find_atom_buf(ST_4CC('m', 'd', 'h', 'd'), mdia, mdiasz,
+                             &mdhdsz)))
+        parse_time(mdhd, mdhdsz, &timescale, &dur);
+
+    if(!(stbl = find_stbl(mdia, mdiasz, &stblsz)))
+        return -1;
+
+    return parse_chap_stbl(tag, stbl, stblsz, timescale, size);
+}
+
+/* Convert a UTF-16 string (with a BOM) to UTF-8. */
+static char *utf16_to_utf8(const uint8_t *buf, uint32_t len) {
+    char *rv, *p;
+    uint32_t c, c2, i;
+    int le = (buf[0] == 0xFF);
+
+    /* Each UTF-16 code unit turns into at most 3 bytes of UTF-8. */
+    if(!(p = rv = (char *)ST_malloc(len / 2 * 3 + 1)))
+        return NULL;
 
-    doneAtom:
-        fseek(fp, (long)(pos + atomsz), SEEK_SET);
-        ilstsz -= atomsz;
-        tmp = NULL;
+    for(i = 2; i + 1 < len; i += 2) {
+        c = le ? (buf[i] | (buf[i + 1] << 8)) : ((buf[i] << 8) | buf[i + 1]);
 
-        if(mean) {
-            free(mean);
-            mean = NULL;
+        if(c >= 0xD800 && c < 0xDC00 && i + 3 < len) {
+            c2 = le ? (buf[i + 2] | (buf[i + 3] << 8)) :
+                ((buf[i + 2] << 8) | buf[i + 3]);
+
+            if(c2 >= 0xDC00 && c2 < 0xE000) {
+                c = 0x10000 + ((c - 0xD800) << 10) + (c2 - 0xDC00);
+                i += 2;
+            }
+        }
+
+        if(c < 0x80) {
+            *p++ = (char)c;
+        }
+        else if(c < 0x800) {
+            *p++ = (char)(0xC0 | (c >> 6));
+            *p++ = (char)(0x80 | (c & 0x3F));
+        }
+        else if(c < 0x10000) {
+            *p++ = (char)(0xE0 | (c >> 12));
+            *p++ = (char)(0x80 | ((c >> 6) & 0x3F));
+            *p++ = (char)(0x80 | (c & 0x3F));
+        }
+        else {
+            *p++ = (char)(0xF0 | (c >> 18));
+            *p++ = (char)(0x80 | ((c >> 12) & 0x3F));
+            *p++ = (char)(0x80 | ((c >> 6) & 0x3F));
+            *p++ = (char)(0x80 | (c & 0x3F));
         }
     }
 
+    *p = 0;
+    return rv;
+}
+
+/* Read the title of a chapter out of a text sample in the file, if that hasn't
+   been tried yet. The sample starts with a 16-bit length, then the text (which
+   might be UTF-16 if it has a BOM on it). A sample that doesn't hold a title
+   just leaves the chapter without one. */
+static ST_Error read_title(const ST_M4A *tag, m4a_chapter_t *ch) {
+    const ST_Allocator *prev;
+    uint8_t *buf = NULL;
+    uint32_t size = ch->size, len;
+    char *title = NULL;
+    ST_Error rv;
+
+    /* There's no point in reading more than the length can cover. */
+    if(ch->title || size < 2)
+        return ST_Error_None;
+    else if(size > 65537)
+        size = 65537;
+
+    /* The title gets freed along with the tag, so allocate it the same way. */
+    prev = ST_useAllocator(tag->alloc);
+    rv = ST_Lazy_read(tag->filename, &tag->stamp, ch->offset, size, &buf);
+
+    if(rv != ST_Error_None)
+        goto out;
+
+    len = (buf[0] << 8) | buf[1];
+
+    if(len > size - 2)
+        goto out;
+
+    if(len >= 2 && ((buf[2] == 0xFE && buf[3] == 0xFF) ||
+                    (buf[2] == 0xFF && buf[3] == 0xFE))) {
+        title = utf16_to_utf8(buf + 2, len);
+    }
+    else if((title = (char *)ST_malloc(len + 1))) {
+        memcpy(title, buf + 2, len);
+        title[len] = 0;
+    }
+
+    if(!title)
+        rv = ST_Error_errno;
+
+out:
+    ST_free(buf);
+    ST_useAllocator(prev);
+
+    /* Don't bother trying again, whether or not it worked. */
+    ch->title = title;
+    ch->size = 0;
+    return rv;
+}
+
+/* ISO base media file format brands that we know how to deal with. */
+static const uint32_t brands[] = {
+    ST_4CC('M', '4', 'A', ' '), ST_4CC('M', '4', 'B', ' '),
+    ST_4CC('M', '4', 'P', ' '), ST_4CC('M', '4', 'V', ' '),
+    ST_4CC('M', '4', 'V', 'H'), ST_4CC('M', '4', 'V', 'P'),
+    ST_4CC('i', 's', 'o', 'm'), ST_4CC('i', 's', 'o', '2'),
+    ST_4CC('i', 's', 'o', '3'), ST_4CC('i', 's', 'o', '4'),
+    ST_4CC('i', 's', 'o', '5'), ST_4CC('i', 's', 'o', '6'),
+    ST_4CC('m', 'p', '4', '1'), ST_4CC('m', 'p', '4', '2'),
+    ST_4CC('d', 'a', 's', 'h'), ST_4CC('a', 'v', 'c', '1'),
+    ST_4CC('f', '4', 'v', ' '), ST_4CC('q', 't', ' ', ' ')
+};
+
+static int known_brand(const uint8_t *buf) {
+    uint32_t brand = ((uint32_t)buf[0] << 24) | (buf[1] << 16) |
+        (buf[2] << 8) | buf[3];
+    size_t i;
+
+    for(i = 0; i < sizeof(brands) / sizeof(brands[0]); ++i) {
+        if(brands[i] == brand)
+            return 1;
+    }
+
+    return 0;
+}
+
+/* Check that the file is one we can deal with, and read in its moov atom. */
+static uint8_t *load_moov(FILE *fp, off_t *size, uint64_t *moov_sz,
+                          off_t *moov_pos, off_t *data_pos) {
+    uint8_t buf[256];
+    uint32_t fourcc;
+    uint64_t atomsz, i, len;
+    int ok = 0;
+
+    /* Figure out how long the file is */
+    if(fseeko(fp, 0, SEEK_END) || (*size = ftello(fp)) < 0 ||
+       fseeko(fp, 0, SEEK_SET))
+        return NULL;
+
+    /* Read in the first 8 bytes of the file, and make sure it is as we would
+       expect it to be */
+    if(fread(buf, 1, 8, fp) != 8)
+        return NULL;
+
+    atomsz = ((uint32_t)buf[0] << 24) | (buf[1] << 16) | (buf[2] << 8) |
+        buf[3];
+    fourcc = ((uint32_t)buf[4] << 24) | (buf[5] << 16) | (buf[6] << 8) |
+        buf[7];
+
+    if(fourcc != ST_AtomFileType)
+        return NULL;
+
+    /* Make sure we have at least one type of information in here */
+    if(atomsz < 12 || atomsz > (uint64_t)*size)
+        return NULL;
+
+    /* Read in the major brand, the minor version, and as many of the
+       compatible brands as will fit in the buffer. */
+    len = MIN(atomsz - 8, (uint64_t)sizeof(buf));
+
+    if(fread(buf, 1, (size_t)len, fp) != (size_t)len)
+        return NULL;
+
+    /* Any brand we know about, major or compatible, is good enough. */
+    ok = known_brand(buf);
+
+    for(i = 8; !ok && i + 4 <= len; i += 4) {
+        ok = known_brand(buf + i);
+    }
+
+    if(!ok)
+        return NULL;
+
+    /* Next, read in the "moov" atom, since its the toplevel container for what
+       the tags are in. We don't care about the rest of the ftyp. If there isn't
+       one, then this isn't really a file we can handle. */
+    return read_moov(fp, *size, (off_t)atomsz, moov_sz, moov_pos, data_pos);
+}
+
+static int parse_file(ST_M4A *tag, FILE *fp) {
+    uint64_t moovsz, udtasz, metasz, ilstsz, chplsz;
+    off_t size, moovp, datap;
+    uint8_t *moov;
+    const uint8_t *udta, *meta, *ilst, *chpl;
+
+    if(!(moov = load_moov(fp, &size, &moovsz, &moovp, &datap)))
+        goto out_close;
+
+    /* Grab the audio properties and chapters while we have the moov handy.
+       Prefer a chapter track over a Nero chapter list if there's both. */
+    parse_props(tag, moov, moovsz);
+    parse_chap_trak(tag, moov, moovsz, size);
+
+    /* Now, we need the "udta" atom. A file without one (or without the meta or
+       ilst inside of it) just isn't tagged, which is the same as having an
+       empty tag. */
+    if(!(udta = find_atom_buf(ST_AtomUserData, moov, moovsz, &udtasz)))
+        goto out;
+
+    if(!tag->chapters &&
+       (chpl = find_atom_buf(ST_4CC('c', 'h', 'p', 'l'), udta, udtasz,
+                             &chplsz)))
+        parse_chpl(tag, chpl, chplsz);
+
+    /* Next up is the "meta" atom */
+    if(!(meta = find_atom_buf(ST_AtomMetadata, udta, udtasz, &metasz)) ||
+       metasz < 4)
+        goto out;
+
+    /* Finally, the "ilst" atom. The meta atom has an extra 4 bytes of version
+       info in the header... */
+    if(!(ilst = find_atom_buf(ST_AtomItemList, meta + 4, metasz - 4, &ilstsz)))
+        goto out;
+
+    /* Everything we need is in memory now, so parse the items out of it. */
+    if(parse_ilst(tag, ilst, ilstsz))
+        goto out_close;
+
+out:
+    ST_free(moov);
     fclose(fp);
     return 0;
 
 out_close:
-    free(mean);
-    free(tmp);
+    ST_free(moov);
     fclose(fp);
     return -1;
 }
+
+/* Buffer used to build up atoms before writing them out. */
+typedef struct wbuf_s {
+    uint8_t *data;
+    size_t len;
+    size_t alloc;
+    int err;
+} wbuf_t;
+
+static void put_u32(uint8_t *buf, uint32_t v) {
+    buf[0] = (uint8_t)(v >> 24);
+    buf[1] = (uint8_t)(v >> 16);
+    buf[2] = (uint8_t)(v >> 8);
+    buf[3] = (uint8_t)v;
+}
+
+static void wbuf_append(wbuf_t *b, const void *d, size_t len) {
+    void *tmp;
+    size_t na;
+
+    if(b->err)
+        return;
+
+    if(b->len + len > b->alloc) {
+        na = b->alloc ? b->alloc : 1024;
+
+        while(na < b->len + len) {
+            na <<= 1;
+        }
+
+        if(!(tmp = ST_realloc(b->data, na))) {
+            b->err = 1;
+            return;
+        }
+
+        b->data = (uint8_t *)tmp;
+        b->alloc = na;
+    }
+
+    if(len)
+        memcpy(b->data + b->len, d, len);
+
+    b->len += len;
+}
+
+static void wbuf_u32(wbuf_t *b, uint32_t v) {
+    uint8_t tmp[4];
+
+    put_u32(tmp, v);
+    wbuf_append(b, tmp, 4);
+}
+
+/* Start a new atom. The size gets filled in by wbuf_end. */
+static size_t wbuf_begin(wbuf_t *b, uint32_t fourcc) {
+    size_t rv = b->len;
+
+    wbuf_u32(b, 0);
+    wbuf_u32(b, fourcc);
+    return rv;
+}
+
+static void wbuf_end(wbuf_t *b, size_t start) {
+    if(b->err)
+        return;
+
+    if(b->len - start > UINT32_MAX) {
+        b->err = 1;
+        return;
+    }
+
+    put_u32(b->data + start, (uint32_t)(b->len - start));
+}
+
+/* Write a data atom with the given type indicator. */
+static void write_data(wbuf_t *b, uint32_t type, const uint8_t *d,
+                       size_t len) {
+    size_t start = wbuf_begin(b, ST_AtomData);
+
+    wbuf_u32(b, type);
+    wbuf_u32(b, 0);
+    wbuf_append(b, d, len);
+    wbuf_end(b, start);
+}
+
+/* Write out the mean and name atoms of a '----' item. The long name is the
+   two joined with a dot (or just the mean, if there was no name), split where
+   the atom says the mean ends. */
+static void write_long_name(wbuf_t *b, const ST_M4A_Atom *atom) {
+    const char *ln = atom->long_name;
+    size_t start;
+
+    start = wbuf_begin(b, ST_AtomMeaning);
+    wbuf_u32(b, 0);
+    wbuf_append(b, ln, atom->mean_len);
+    wbuf_end(b, start);
+
+    if(ln[atom->mean_len]) {
+        start = wbuf_begin(b, ST_AtomName);
+        wbuf_u32(b, 0);
+        wbuf_append(b, ln + atom->mean_len + 1,
+                    strlen(ln + atom->mean_len + 1));
+        wbuf_end(b, start);
+    }
+}
+
+static void write_item(const ST_Dict *d, void *data, const void *key,
+                       const void *v) {
+    wbuf_t *b = (wbuf_t *)data;
+    uint32_t fourcc = *((const uint32_t *)key);
+    const ST_M4A_Atom *atom = (const ST_M4A_Atom *)v;
+    const void **values;
+    int count, i;
+    size_t start;
+
+    /* Each '----' value gets its own item, since they each have their own long
+       name. Everything else gets all of its values written in one item, when we
+       come across the first one. */
+    if(fourcc == ST_AtomLongName) {
+        if(!atom->long_name)
+            return;
+
+        start = wbuf_begin(b, fourcc);
+        write_long_name(b, atom);
+        write_data(b, atom->type, atom->data, atom->data_sz);
+        wbuf_end(b, start);
+        return;
+    }
+
+    if(!(values = ST_Dict_find(d, key, &count)) || values[0] != v)
+        return;
+
+    start = wbuf_begin(b, fourcc);
+
+    for(i = 0; i < count; ++i) {
+        atom = (const ST_M4A_Atom *)values[i];
+        write_data(b, atom->type, atom->data, atom->data_sz);
+    }
+
+    wbuf_end(b, start);
+}
+
+/* Serialize the tag into a new ilst atom. */
+static void build_ilst(const ST_M4A *tag, wbuf_t *b) {
+    size_t start, covr;
+    const uint8_t *d;
+    uint32_t i, type;
+
+    start = wbuf_begin(b, ST_AtomItemList);
+    ST_Dict_foreach(tag->atoms, b, &write_item);
+
+    if(tag->picture_count) {
+        covr = wbuf_begin(b, ST_AtomCoverArt);
+
+        for(i = 0; i < tag->picture_count; ++i) {
+            d = ST_Picture_data(tag->pictures[i]);
+
+            /* Mark JPEG and PNG images as such, and anything else as
+               implicit. */
+            if(ST_Picture_dataLength(tag->pictures[i]) >= 4 && d[0] == 0xFF &&
+               d[1] == 0xD8)
+                type = 13;
+            else if(ST_Picture_dataLength(tag->pictures[i]) >= 4 &&
+                    !memcmp(d, "\211PNG", 4))
+                type = 14;
+            else
+                type = 0;
+
+            write_data(b, type, d, ST_Picture_dataLength(tag->pictures[i]));
+        }
+
+        wbuf_end(b, covr);
+    }
+
+    wbuf_end(b, start);
+}
+
+/* Copy the atoms in a container, replacing the first child of the given type
+   with the atom in repl (or adding it to the end, if there is no such child).
+   Any free atoms that directly follow the replaced atom are dropped, since the
+   space they took up gets accounted for when the file is written. */
+static int splice_atom(wbuf_t *b, const uint8_t *buf, uint64_t len,
+                       ST_M4A_AtomCode code, const wbuf_t *repl) {
+    uint64_t sz;
+    uint32_t fourcc;
+    int done = 0, after = 0;
+
+    while(len) {
+        if(!atom_header(buf, len, &sz, &fourcc))
+            return -1;
+
+        if(!sz)
+            sz = len;
+
+        if(sz > len)
+            return -1;
+
+        if(!done && fourcc == (uint32_t)code) {
+            wbuf_append(b, repl->data, repl->len);
+            done = after = 1;
+        }
+        else if(after && fourcc == ST_AtomFreeSpace) {
+            /* Drop it. */
+        }
+        else {
+            wbuf_append(b, buf, (size_t)sz);
+            after = 0;
+        }
+
+        buf += sz;
+        len -= sz;
+    }
+
+    if(!done)
+        wbuf_append(b, repl->data, repl->len);
+
+    return 0;
+}
+
+/* Build a new moov atom with the ilst in it replaced, creating the udta and
+   meta atoms if need be. */
+static int build_moov(const uint8_t *moov, uint64_t moovsz, const wbuf_t *ilst,
+                      wbuf_t *out) {
+    static const uint8_t hdlr[] = {
+        0x00, 0x00, 0x00, 0x21, 'h', 'd', 'l', 'r', 0x00, 0x00, 0x00, 0x00,
+        0x00, 0x00, 0x00, 0x00, 'm', 'd', 'i', 'r', 'a', 'p', 'p', 'l',
+        0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00
+    };
+    wbuf_t meta = { NULL, 0, 0, 0 }, udta = { NULL, 0, 0, 0 };
+    const uint8_t *oudta, *ometa = NULL;
+    uint64_t udtasz, metasz;
+    size_t start;
+    int rv = -1;
+
+    if((oudta = find_atom_buf(ST_AtomUserData, moov, moovsz, &udtasz)))
+        ometa = find_atom_buf(ST_AtomMetadata, oudta, udtasz, &metasz);
+
+    /* Build the meta atom, with its 4 bytes of version info up front. */
+    start = wbuf_begin(&meta, ST_AtomMetadata);
+
+    if(ometa && metasz >= 4) {
+        wbuf_append(&meta, ometa, 4);
+
+        if(splice_atom(&meta, ometa + 4, metasz - 4, ST_AtomItemList, ilst))
+            goto out;
+    }
+    else {
+        wbuf_u32(&meta, 0);
+        wbuf_append(&meta, hdlr, sizeof(hdlr));
+        wbuf_append(&meta, ilst->data, ilst->len);
+    }
+
+    wbuf_end(&meta, start);
+
+    /* Then the udta around it. */
+    start = wbuf_begin(&udta, ST_AtomUserData);
+
+    if(oudta) {
+        if(splice_atom(&udta, oudta, udtasz, ST_AtomMetadata, &meta))
+            goto out;
+    }
+    else {
+        wbuf_append(&udta, meta.data, meta.len);
+    }
+
+    wbuf_end(&udta, start);
+
+    /* And finally the moov itself. */
+    start = wbuf_begin(out, ST_AtomMovieData);
+
+    if(splice_atom(out, moov, moovsz, ST_AtomUserData, &udta))
+        goto out;
+
+    wbuf_end(out, start);
+
+    if(!meta.err && !udta.err && !out->err)
+        rv = 0;
+
+out:
+    ST_free(meta.data);
+    ST_free(udta.data);
+    return rv;
+}
+
+/* Add delta to every chunk offset in the stco and co64 atoms of the given moov
+   contents that points at or past the given position. Returns
+   ST_Error_TooLarge if an offset in a stco atom would no longer fit in 32 bits,
+   or ST_Error_Unknown if the atoms are broken. */
+static ST_Error patch_offsets(uint8_t *buf, uint64_t len, uint64_t from,
+                              uint64_t delta) {
+    static const ST_M4A_AtomCode path[] = {
+        ST_4CC('m', 'd', 'i', 'a'), ST_4CC('m', 'i', 'n', 'f'),
+        ST_4CC('s', 't', 'b', 'l')
+    };
+    uint64_t sz, csz, tsz, cnt, i, off;
+    uint32_t fourcc, ctype;
+    uint8_t *trak, *c, *e;
+    int hdr, chdr, j;
+
+    /* Look at each of the trak atoms in the moov. */
+    for(; len; buf += sz, len -= sz) {
+        if(!(hdr = atom_header(buf, len, &sz, &fourcc)))
+            return ST_Error_Unknown;
+
+        if(!sz)
+            sz = len;
+
+        if(sz > len)
+            return ST_Error_Unknown;
+
+        if(fourcc != ST_4CC('t', 'r', 'a', 'k'))
+            continue;
+
+        trak = buf + hdr;
+        tsz = sz - hdr;
+
+        for(j = 0; j < 3 && trak; ++j) {
+            trak = (uint8_t *)find_atom_buf(path[j], trak, tsz, &tsz);
+        }
+
+        if(!trak)
+            continue;
+
+        /* Now, go through the sample table, looking for the chunk offsets. */
+        for(c = trak; tsz; c += csz, tsz -= csz) {
+            if(!(chdr = atom_header(c, tsz, &csz, &ctype)))
+                return ST_Error_Unknown;
+
+            if(!csz)
+                csz = tsz;
+
+            if(csz > tsz)
+                return ST_Error_Unknown;
+
+            if(ctype != ST_4CC('s', 't', 'c', 'o') &&
+               ctype != ST_4CC('c', 'o', '6', '4'))
+                continue;
+
+            if(csz < (uint64_t)chdr + 8)
+                return ST_Error_Unknown;
+
+            e = c + chdr + 4;
+            cnt = ((uint64_t)e[0] << 24) | (e[1] << 16) | (e[2] << 8) | e[3];
+            e += 4;
+
+            if(ctype == ST_4CC('s', 't', 'c', 'o')) {
+                if(cnt > (csz - chdr - 8) / 4)
+                    return ST_Error_Unknown;
+
+                for(i = 0; i < cnt; ++i, e += 4) {
+                    off = ((uint64_t)e[0] << 24) | (e[1] << 16) | (e[2] << 8) |
+                        e[3];
+
+                    if(off >= from) {
+                        if(off + delta > UINT32_MAX)
+                            return ST_Error_TooLarge;
+
+                        put_u32(e, (uint32_t)(off + delta));
+                    }
+                }
+            }
+            else {
+                if(cnt > (csz - chdr - 8) / 8)
+                    return ST_Error_Unknown;
+
+                for(i = 0; i < cnt; ++i, e += 8) {
+                    off = ((uint64_t)e[0] << 56) | ((uint64_t)e[1] << 48) |
+                        ((uint64_t)e[2] << 40) | ((uint64_t)e[3] << 32) |
+                        ((uint64_t)e[4] << 24) | ((uint64_t)e[5] << 16) |
+                        ((uint64_t)e[6] << 8) | (uint64_t)e[7];
+
+                    if(off >= from) {
+                        off += delta;
+                        put_u32(e, (uint32_t)(off >> 32));
+                        put_u32(e + 4, (uint32_t)off);
+                    }
+                }
+            }
+        }
+    }
+
+    return ST_Error_None;
+}
+
+/* Write a free atom of the given size (which must be at least 8). */
+static int write_free(FILE *fp, uint64_t sz) {
+    uint8_t buf[4096];
+    size_t n;
+
+    memset(buf, 0, sizeof(buf));
+    put_u32(buf, (uint32_t)sz);
+    put_u32(buf + 4, ST_AtomFreeSpace);
+
+    while(sz) {
+        n = (size_t)MIN(sz, (uint64_t)sizeof(buf));
+
+        if(fwrite(buf, 1, n, fp) != n)
+            return -1;
+
+        memset(buf, 0, 8);
+        sz -= n;
+    }
+
+    return 0;
+}
+
+/* Move everything from start to the end of the file by delta bytes, working
+   backwards from the end so nothing gets overwritten before it is moved. */
+static int shift_tail(FILE *fp, off_t start, off_t end, off_t delta) {
+    uint8_t *buf;
+    size_t n;
+    int rv = -1;
+
+    if(!(buf = (uint8_t *)ST_malloc(SHIFT_BUFSZ)))
+        return -1;
+
+    while(end > start) {
+        n = (size_t)MIN((off_t)SHIFT_BUFSZ, end - start);
+        end -= (off_t)n;
+
+        if(fseeko(fp, end, SEEK_SET) || fread(buf, 1, n, fp) != n)
+            goto out;
+
+        if(fseeko(fp, end + delta, SEEK_SET) || fwrite(buf, 1, n, fp) != n)
+            goto out;
+    }
+
+    rv = 0;
+
+out:
+    ST_free(buf);
+    return rv;
+}
+
+ST_FUNC ST_Error ST_M4A_writeToFile(const ST_M4A *tag, const char *fn) {
+    FILE *fp;
+    uint8_t *moov = NULL;
+    uint8_t buf[16];
+    wbuf_t ilst = { NULL, 0, 0, 0 }, nmoov = { NULL, 0, 0, 0 };
+    uint64_t moovsz, sz, region, pad, delta;
+    uint32_t fourcc;
+    off_t size, moovp, datap, end;
+    ST_Error rv = ST_Error_Unknown;
+    int hdr;
+
+    if(!tag || !fn || tag->base.type != ST_TagType_M4A)
+        return ST_Error_InvalidArgument;
+
+    if(!(fp = fopen(fn, "r+b")))
+        return ST_Error_errno;
+
+    if(!(moov = load_moov(fp, &size, &moovsz, &moovp, &datap)))
+        goto out;
+
+    /* Build the new moov atom in memory. */
+    build_ilst(tag, &ilst);
+
+    if(ilst.err || build_moov(moov, moovsz, &ilst, &nmoov))
+        goto out;
+
+    /* Figure out how much room we have to work with: the old moov atom, plus
+       any free atoms directly following it. */
+    end = datap + (off_t)moovsz;
+
+    while(end < size) {
+        if(fseeko(fp, end, SEEK_SET))
+            goto out_errno;
+
+        hdr = (int)fread(buf, 1, 16, fp);
+        if(!(hdr = atom_header(buf, (uint64_t)hdr, &sz, &fourcc)) ||
+           (fourcc != ST_AtomFreeSpace && fourcc != ST_AtomSkip))
+            break;
+
+        if(!sz)
+            sz = (uint64_t)(size - end);
+
+        if(sz > (uint64_t)(size - end))
+            break;
+
+        end += (off_t)sz;
+    }
+
+    region = (uint64_t)(end - moovp);
+
+    if(nmoov.len == region || nmoov.len + 8 <= region) {
+        pad = region - nmoov.len;
+    }
+    else {
+        /* It doesn't fit, so everything after it has to move. Leave a bit of
+           padding so that next time it will fit. Anything the chunk offsets
+           point to after the moov moves too, so fix them up first. */
+        pad = PADDING_SIZE;
+        delta = nmoov.len + pad - region;
+
+        /* Fragmented files have absolute offsets in their movie fragments
+           (and the random access table at the end) too, which aren't fixed
+           up here. */
+        if(find_atom_buf(ST_4CC('m', 'v', 'e', 'x'), nmoov.data + 8,
+                         nmoov.len - 8, &sz)) {
+            rv = ST_Error_Unsupported;
+            goto out;
+        }
+
+        rv = patch_offsets(nmoov.data + 8, nmoov.len - 8, (uint64_t)end, delta);
+
+        if(rv != ST_Error_None)
+            goto out;
+
+        if(shift_tail(fp, end, size, (off_t)delta))
+            goto out_errno;
+    }
+
+    /* Write the new moov, and fill any leftover space with a free atom. */
+    if(fseeko(fp, moovp, SEEK_SET) ||
+       fwrite(nmoov.data, 1, nmoov.len, fp) != nmoov.len)
+        goto out_errno;
+
+    if(pad && write_free(fp, pad))
+        goto out_errno;
+
+    rv = ST_Error_None;
+    goto out;
+
+out_errno:
+    rv = ST_Error_errno;
+out:
+    ST_free(ilst.data);
+    ST_free(nmoov.data);
+    ST_free(moov);
+
+    if(fclose(fp) && rv == ST_Error_None)
+        rv = ST_Error_errno;
+
+    return rv;
+}
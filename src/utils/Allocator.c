@@ -0,0 +1,460 @@
+/*
+    SonatinaTag
+    Copyright (C) 2026 Lawrence Sebald
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License version 2.1 as published by the Free Software Foundation.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+*/
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+
+#include "SonatinaTag/Allocator.h"
+
+#if defined(__STDC_VERSION__) && __STDC_VERSION__ >= 201112L && \
+    !defined(__STDC_NO_THREADS__)
+#define THREAD_LOCAL _Thread_local
+#elif defined(__GNUC__)
+#define THREAD_LOCAL __thread
+#else
+/* No thread-local storage, so the override applies to every thread. */
+#define THREAD_LOCAL
+#endif
+
+static void *std_alloc(void *ctx, size_t size) {
+    (void)ctx;
+    return malloc(size);
+}
+
+static void *std_resize(void *ctx, void *ptr, size_t size) {
+    (void)ctx;
+    return realloc(ptr, size);
+}
+
+static void std_release(void *ctx, void *ptr) {
+    (void)ctx;
+    free(ptr);
+}
+
+static const ST_Allocator std_allocator = {
+    std_alloc, std_resize, std_release, NULL
+};
+
+static ST_Allocator global_allocator = {
+    std_alloc, std_resize, std_release, NULL
+};
+
+static THREAD_LOCAL const ST_Allocator *thread_allocator = NULL;
+
+ST_FUNC ST_Error ST_setAllocator(const ST_Allocator *a) {
+    if(!a) {
+        global_allocator = std_allocator;
+        return ST_Error_None;
+    }
+
+    if(!a->alloc || !a->resize || !a->release)
+        return ST_Error_InvalidArgument;
+
+    global_allocator = *a;
+    return ST_Error_None;
+}
+
+ST_FUNC const ST_Allocator *ST_useAllocator(const ST_Allocator *a) {
+    const ST_Allocator *rv = thread_allocator;
+
+    thread_allocator = a;
+    return rv;
+}
+
+ST_FUNC const ST_Allocator *ST_currentAllocator(void) {
+    return thread_allocator ? thread_allocator : &global_allocator;
+}
+
+ST_FUNC void *ST_malloc(size_t size) {
+    const ST_Allocator *a = ST_currentAllocator();
+
+    return a->alloc(a->ctx, size);
+}
+
+ST_FUNC void *ST_calloc(size_t count, size_t size) {
+    void *rv;
+
+    if(size && count > SIZE_MAX / size) {
+        errno = ENOMEM;
+        return NULL;
+    }
+
+    if((rv = ST_malloc(count * size)))
+        memset(rv, 0, count * size);
+
+    return rv;
+}
+
+ST_FUNC void *ST_realloc(void *ptr, size_t size) {
+    const ST_Allocator *a = ST_currentAllocator();
+
+    return a->resize(a->ctx, ptr, size);
+}
+
+ST_FUNC void ST_free(void *ptr) {
+    const ST_Allocator *a = ST_currentAllocator();
+
+    a->release(a->ctx, ptr);
+}
+
+ST_FUNC char *ST_strdup(const char *s) {
+    size_t len = strlen(s) + 1;
+    char *rv;
+
+    if((rv = (char *)ST_malloc(len)))
+        memcpy(rv, s, len);
+
+    return rv;
+}
+
+/* The counting allocator puts the size of each block in front of it, padded
+   out so that the block itself stays aligned. */
+typedef union count_hdr_u {
+    size_t size;
+    long double ld;
+    void *ptr;
+    uint64_t u64;
+} count_hdr_t;
+
+static void *count_alloc(void *ctx, size_t size) {
+    ST_AllocStats *s = (ST_AllocStats *)ctx;
+    count_hdr_t *h;
+
+    if(size > SIZE_MAX - sizeof(count_hdr_t) ||
+       !(h = (count_hdr_t *)malloc(sizeof(count_hdr_t) + size))) {
+        ++s->failures;
+        return NULL;
+    }
+
+    h->size = size;
+    ++s->allocs;
+    s->total += size;
+    s->in_use += size;
+
+    if(s->in_use > s->peak)
+        s->peak = s->in_use;
+
+    return h + 1;
+}
+
+static void *count_resize(void *ctx, void *ptr, size_t size) {
+    ST_AllocStats *s = (ST_AllocStats *)ctx;
+    count_hdr_t *h, *tmp;
+    size_t old;
+
+    if(!ptr)
+        return count_alloc(ctx, size);
+
+    h = (count_hdr_t *)ptr - 1;
+    old = h->size;
+
+    if(size > SIZE_MAX - sizeof(count_hdr_t) ||
+       !(tmp = (count_hdr_t *)realloc(h, sizeof(count_hdr_t) + size))) {
+        ++s->failures;
+        return NULL;
+    }
+
+    tmp->size = size;
+    ++s->reallocs;
+    s->in_use = s->in_use - old + size;
+
+    if(size > old)
+        s->total += size - old;
+
+    if(s->in_use > s->peak)
+        s->peak = s->in_use;
+
+    return tmp + 1;
+}
+
+static void count_release(void *ctx, void *ptr) {
+    ST_AllocStats *s = (ST_AllocStats *)ctx;
+    count_hdr_t *h;
+
+    if(!ptr)
+        return;
+
+    h = (count_hdr_t *)ptr - 1;
+    ++s->frees;
+    s->in_use -= h->size;
+    free(h);
+}
+
+ST_FUNC void ST_AllocStats_allocator(ST_AllocStats *stats, ST_Allocator *a) {
+    if(!stats || !a)
+        return;
+
+    memset(stats, 0, sizeof(ST_AllocStats));
+    a->alloc = count_alloc;
+    a->resize = count_resize;
+    a->release = count_release;
+    a->ctx = stats;
+}
+
+/* Arena chunks are kept in a list, with the one being allocated from first.
+   Blocks too big to share a chunk get one to themselves, which is given back
+   as soon as the block is freed. */
+#define ARENA_ALIGN         16
+#define ARENA_ROUND(x)      (((x) + 15) & ~(size_t)15)
+#define ARENA_CHUNK_SIZE    65536
+
+typedef struct arena_chunk_s {
+    struct arena_chunk_s *next;
+    struct arena_chunk_s *prev;
+    size_t size;
+    size_t used;
+} arena_chunk_t;
+
+/* In front of every block, so it can be resized. own is set if the block has a
+   chunk to itself. */
+typedef struct arena_block_s {
+    size_t size;
+    arena_chunk_t *own;
+} arena_block_t;
+
+#define CHUNK_HDR           ARENA_ROUND(sizeof(arena_chunk_t))
+#define BLOCK_HDR           ARENA_ROUND(sizeof(arena_block_t))
+#define CHUNK_DATA(c)       ((uint8_t *)(c) + CHUNK_HDR)
+
+struct ST_Arena_struct {
+    ST_Allocator alloc;
+    ST_Allocator parent;
+    arena_chunk_t *chunks;
+    arena_block_t *last;            /* The last block in the first chunk */
+    size_t chunk_size;
+    size_t footprint;
+};
+
+static arena_chunk_t *arena_chunk(ST_Arena *a, size_t size) {
+    arena_chunk_t *c;
+
+    if(size > SIZE_MAX - CHUNK_HDR ||
+       !(c = (arena_chunk_t *)a->parent.alloc(a->parent.ctx, CHUNK_HDR + size)))
+        return NULL;
+
+    c->size = size;
+    c->used = 0;
+    a->footprint += CHUNK_HDR + size;
+    return c;
+}
+
+static void arena_link(ST_Arena *a, arena_chunk_t *c, arena_chunk_t *after) {
+    c->prev = after;
+    c->next = after ? after->next : a->chunks;
+
+    if(c->next)
+        c->next->prev = c;
+
+    if(after)
+        after->next = c;
+    else
+        a->chunks = c;
+}
+
+static void arena_unlink(ST_Arena *a, arena_chunk_t *c) {
+    if(c->prev)
+        c->prev->next = c->next;
+    else
+        a->chunks = c->next;
+
+    if(c->next)
+        c->next->prev = c->prev;
+
+    a->footprint -= CHUNK_HDR + c->size;
+    a->parent.release(a->parent.ctx, c);
+}
+
+static void *arena_alloc(void *ctx, size_t size) {
+    ST_Arena *a = (ST_Arena *)ctx;
+    arena_chunk_t *c = a->chunks;
+    arena_block_t *b;
+    size_t need;
+
+    if(size > SIZE_MAX - BLOCK_HDR - ARENA_ALIGN)
+        return NULL;
+
+    need = BLOCK_HDR + ARENA_ROUND(size);
+
+    /* Big blocks get a chunk of their own, behind the one in use. */
+    if(need > a->chunk_size / 2) {
+        if(!(c = arena_chunk(a, need)))
+            return NULL;
+
+        arena_link(a, c, a->chunks);
+        c->used = need;
+        b = (arena_block_t *)CHUNK_DATA(c);
+        b->own = c;
+        b->size = size;
+        return (uint8_t *)b + BLOCK_HDR;
+    }
+
+    if(!c || c->size - c->used < need) {
+        if(!(c = arena_chunk(a, a->chunk_size)))
+            return NULL;
+
+        arena_link(a, c, NULL);
+    }
+
+    b = (arena_block_t *)(CHUNK_DATA(c) + c->used);
+    b->own = NULL;
+    b->size = size;
+    c->used += need;
+    a->last = b;
+    return (uint8_t *)b + BLOCK_HDR;
+}
+
+static void arena_release(void *ctx, void *ptr) {
+    ST_Arena *a = (ST_Arena *)ctx;
+    arena_block_t *b;
+
+    if(!ptr)
+        return;
+
+    b = (arena_block_t *)((uint8_t *)ptr - BLOCK_HDR);
+
+    if(b->own) {
+        arena_unlink(a, b->own);
+    }
+    else if(b == a->last) {
+        a->chunks->used = (uint8_t *)b - CHUNK_DATA(a->chunks);
+        a->last = NULL;
+    }
+}
+
+static void *arena_resize(void *ctx, void *ptr, size_t size) {
+    ST_Arena *a = (ST_Arena *)ctx;
+    arena_block_t *b;
+    size_t off;
+    void *rv;
+
+    if(!ptr)
+        return arena_alloc(ctx, size);
+
+    b = (arena_block_t *)((uint8_t *)ptr - BLOCK_HDR);
+
+    /* The last block can grow or shrink in place, if there's room. */
+    if(b == a->last && size <= SIZE_MAX - BLOCK_HDR - ARENA_ALIGN) {
+        off = (uint8_t *)b - CHUNK_DATA(a->chunks);
+
+        if(a->chunks->size - off >= BLOCK_HDR + ARENA_ROUND(size) &&
+           BLOCK_HDR + ARENA_ROUND(size) <= a->chunk_size / 2) {
+            a->chunks->used = off + BLOCK_HDR + ARENA_ROUND(size);
+            b->size = size;
+            return ptr;
+        }
+    }
+
+    if(!(rv = arena_alloc(ctx, size)))
+        return NULL;
+
+    memcpy(rv, ptr, b->size < size ? b->size : size);
+    arena_release(ctx, ptr);
+    return rv;
+}
+
+ST_FUNC ST_Arena *ST_Arena_create(size_t chunk_size) {
+    const ST_Allocator *parent = ST_currentAllocator();
+    ST_Arena *rv;
+
+    if(!chunk_size)
+        chunk_size = ARENA_CHUNK_SIZE;
+
+    if(!(rv = (ST_Arena *)parent->alloc(parent->ctx, sizeof(ST_Arena))))
+        return NULL;
+
+    rv->alloc.alloc = arena_alloc;
+    rv->alloc.resize = arena_resize;
+    rv->alloc.release = arena_release;
+    rv->alloc.ctx = rv;
+    rv->parent = *parent;
+    rv->chunks = NULL;
+    rv->last = NULL;
+    rv->chunk_size = ARENA_ROUND(chunk_size);
+    rv->footprint = 0;
+
+    return rv;
+}
+
+ST_FUNC void ST_Arena_free(ST_Arena *a) {
+    if(!a)
+        return;
+
+    while(a->chunks) {
+        arena_unlink(a, a->chunks);
+    }
+
+    a->parent.release(a->parent.ctx, a);
+}
+
+ST_FUNC void ST_Arena_reset(ST_Arena *a) {
+    arena_chunk_t *c, *keep = NULL;
+
+    if(!a)
+        return;
+
+    /* Hang onto one normal sized chunk, so the next use of the arena doesn't
+       have to go get one. */
+    for(c = a->chunks; c; c = c->next) {
+        if(c->size == a->chunk_size) {
+            keep = c;
+            break;
+        }
+    }
+
+    if(keep) {
+        if(keep->prev)
+            keep->prev->next = keep->next;
+        else
+            a->chunks = keep->next;
+
+        if(keep->next)
+            keep->next->prev = keep->prev;
+    }
+
+    while(a->chunks) {
+        arena_unlink(a, a->chunks);
+    }
+
+    if(keep) {
+        keep->used = 0;
+        keep->prev = keep->next = NULL;
+        a->chunks = keep;
+    }
+
+    a->last = NULL;
+}
+
+ST_FUNC const ST_Allocator *ST_Arena_allocator(ST_Arena *a) {
+    if(!a)
+        return NULL;
+
+    return &a->alloc;
+}
+
+ST_FUNC size_t ST_Arena_footprint(const ST_Arena *a) {
+    if(!a)
+        return 0;
+
+    return a->footprint;
+}
@@ -27,6 +27,7 @@
 
 #include "SonatinaTag/Dictionary.h"
 #include "SonatinaTag/queue.h"
+#include "SonatinaTag/Allocator.h"
 
 typedef struct dict_kv_s {
     TAILQ_ENTRY(dict_kv_s) qentry;
@@ -60,15 +61,16 @@ ST_FUNC ST_Dict *ST_Dict_create(int nb, unsigned long (*hash)(const void *),
         return NULL;
     }
 
-    rv = (ST_Dict *)malloc(sizeof(ST_Dict));
+    rv = (ST_Dict *)ST_malloc(sizeof(ST_Dict));
     if(!rv) {
         return NULL;
     }
 
     /* Allocate space for the buckets */
-    rv->buckets = (struct dict_bucket *)malloc(sizeof(struct dict_bucket) * nb);
+    rv->buckets = (struct dict_bucket *)ST_malloc(sizeof(struct dict_bucket) *
+                                                  nb);
     if(!rv->buckets) {
-        free(rv);
+        ST_free(rv);
         return NULL;
     }
 
@@ -123,7 +125,7 @@ static int ic(const void *k1, const void *k2) {
 
 static void *id(const void *k) {
     uint32_t *a = (uint32_t *)k;
-    uint32_t *tmp = (uint32_t *)malloc(sizeof(uint32_t));
+    uint32_t *tmp = (uint32_t *)ST_malloc(sizeof(uint32_t));
 
     if(tmp) {
         *tmp = *a;
@@ -134,11 +136,12 @@ static void *id(const void *k) {
 
 ST_FUNC ST_Dict *ST_Dict_createString(int nb, void (*dtor_val)(void *)) {
     return ST_Dict_create(nb, sh, (int (*)(const void *, const void *))strcmp,
-                          (void *(*)(const void *))strdup, free, dtor_val);
+                          (void *(*)(const void *))ST_strdup, ST_free,
+                          dtor_val);
 }
 
 ST_FUNC ST_Dict *ST_Dict_createUint32(int nb, void (*dtor_val)(void *)) {
-    return ST_Dict_create(nb, ih, ic, id, free, dtor_val);
+    return ST_Dict_create(nb, ih, ic, id, ST_free, dtor_val);
 }
 
 ST_FUNC void ST_Dict_free(ST_Dict *d) {
@@ -159,14 +162,14 @@ ST_FUNC void ST_Dict_free(ST_Dict *d) {
             }
 
             kd(j->key);
-            free(j->values);
-            free(j);
+            ST_free(j->values);
+            ST_free(j);
             j = tmp;
         }
     }
 
-    free(d->buckets);
-    free(d);
+    ST_free(d->buckets);
+    ST_free(d);
 }
 
 ST_FUNC void ST_Dict_foreach(const ST_Dict *d, void *data,
@@ -207,13 +210,14 @@ static dict_kv_t *find_kv(const ST_Dict *d, const void *key, int *rb) {
     int bucket = hash % d->num_buckets;
     dict_kv_t *i;
 
+    *rb = bucket;
+
     TAILQ_FOREACH(i, &d->buckets[bucket], qentry) {
         if(!d->compare(key, i->key)) {
             return i;
         }
     }
 
-    *rb = bucket;
     return NULL;
 }
 
@@ -249,7 +253,8 @@ ST_FUNC ST_Error ST_Dict_add(ST_Dict *d, const void *key, void *value) {
     /* Find the <key, value> pair, if there is one already. */
     if((kv = find_kv(d, key, &rb))) {
         /* Make space for the new value */
-        if(!(t = realloc(kv->values, (kv->num_values + 1) * sizeof(void *)))) {
+        if(!(t = ST_realloc(kv->values,
+                            (kv->num_values + 1) * sizeof(void *)))) {
             return ST_Error_errno;
         }
 
@@ -259,20 +264,20 @@ ST_FUNC ST_Error ST_Dict_add(ST_Dict *d, const void *key, void *value) {
     }
 
     /* We don't have an old entry, we have to add a new one */
-    if(!(kv = (dict_kv_t *)malloc(sizeof(dict_kv_t)))) {
+    if(!(kv = (dict_kv_t *)ST_malloc(sizeof(dict_kv_t)))) {
         return ST_Error_errno;
     }
 
     memset(kv, 0, sizeof(dict_kv_t));
 
-    if(!(kv->values = (void **)malloc(sizeof(void *)))) {
-        free(kv);
+    if(!(kv->values = (void **)ST_malloc(sizeof(void *)))) {
+        ST_free(kv);
         return ST_Error_errno;
     }
 
     if(!(kv->key = d->copy_key(key))) {
-        free(kv->values);
-        free(kv);
+        ST_free(kv->values);
+        ST_free(kv);
         return ST_Error_Unknown;
     }
 
@@ -338,7 +343,8 @@ ST_FUNC ST_Error ST_Dict_remove(ST_Dict *d, const void *key, int index) {
         }
 
         /* Resize the values array */
-        if((tmp = realloc(kv->values, (kv->num_values - 1) * sizeof(void *)))) {
+        if((tmp = ST_realloc(kv->values,
+                             (kv->num_values - 1) * sizeof(void *)))) {
             kv->values = (void **)tmp;
         }
 
@@ -347,10 +353,10 @@ ST_FUNC ST_Error ST_Dict_remove(ST_Dict *d, const void *key, int index) {
 
     /* Free the key, if we're supposed to */
     if(free_key) {
-        free(kv->values);
+        ST_free(kv->values);
         dk(kv->key);
         TAILQ_REMOVE(&d->buckets[rb], kv, qentry);
-        free(kv);
+        ST_free(kv);
     }
 
     return ST_Error_None;
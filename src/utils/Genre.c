@@ -0,0 +1,181 @@
+/*
+    SonatinaTag
+    Copyright (C) 2026 Lawrence Sebald
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License version 2.1 as published by the Free Software Foundation.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+*/
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <stdio.h>
+#include <string.h>
+#include <stdint.h>
+
+#include "SonatinaTag/Genre.h"
+#include "SonatinaTag/Tags/ID3v1.h"
+#include "Text.h"
+#include "GenreHash.h"
+
+static uint32_t fnv(const uint8_t *key, size_t len, uint32_t seed) {
+    uint32_t h = 2166136261U ^ seed;
+    size_t i;
+
+    for(i = 0; i < len; ++i) {
+        h ^= key[i];
+        h *= 16777619U;
+    }
+
+    return h;
+}
+
+static int is_space(uint8_t c) {
+    return c == ' ' || c == '\t' || c == '\r' || c == '\n';
+}
+
+static int is_digit(uint8_t c) {
+    return c >= '0' && c <= '9';
+}
+
+ST_FUNC int ST_Genre_lookup(const uint8_t *s, size_t s_len) {
+    uint8_t key[GENRE_KEY_MAX];
+    size_t i, len = 0;
+    uint32_t h;
+    const struct genre_slot *slot;
+    uint8_t c;
+
+    if(!s)
+        return ST_Genre_None;
+
+    /* Build the key the same way genre_hash.py does: lowercase the letters and
+       throw away spaces and punctuation. */
+    for(i = 0; i < s_len; ++i) {
+        c = s[i];
+
+        if(c >= 'A' && c <= 'Z')
+            c += 'a' - 'A';
+        else if(!(c >= 'a' && c <= 'z') && !is_digit(c) && c < 0x80)
+            continue;
+
+        /* Anything this long can't be one of ours. */
+        if(len == GENRE_KEY_MAX)
+            return ST_Genre_Other;
+
+        key[len++] = c;
+    }
+
+    h = fnv(key, len, 0);
+    h = fnv(key, len, genre_seeds[h % GENRE_HASH_BUCKETS]);
+    slot = &genre_slots[h % GENRE_HASH_SLOTS];
+
+    if(slot->key && strlen(slot->key) == len && !memcmp(slot->key, key, len))
+        return slot->id;
+
+    return ST_Genre_Other;
+}
+
+ST_FUNC const char *ST_Genre_name(int id) {
+    return ST_ID3v1_stringForGenre((ST_ID3v1_GenreCode)id);
+}
+
+/* Parse an ID3v1 genre code. Returns -1 if it isn't one. */
+static int parse_code(const uint8_t *s, size_t len) {
+    int rv = 0;
+    size_t i;
+
+    if(!len || len > 3)
+        return -1;
+
+    for(i = 0; i < len; ++i) {
+        if(!is_digit(s[i]))
+            return -1;
+
+        rv = rv * 10 + (s[i] - '0');
+    }
+
+    return rv <= ID3v1GenreMax ? rv : -1;
+}
+
+static int put_text(int id, const uint8_t *s, size_t len, uint8_t *buf,
+                    size_t buf_len) {
+    const char *name;
+
+    if(buf) {
+        if(id >= 0 && (name = ST_Genre_name(id)))
+            ST_Text_copyUTF8((const uint8_t *)name, strlen(name), buf,
+                             buf_len);
+        else
+            ST_Text_copyUTF8(s, len, buf, buf_len);
+    }
+
+    return id;
+}
+
+ST_FUNC int ST_Genre_normalize(const uint8_t *s, size_t s_len, uint8_t *buf,
+                               size_t len) {
+    const uint8_t *end;
+    int id;
+
+    if(buf && len)
+        buf[0] = 0;
+
+    if(!s)
+        return ST_Genre_None;
+
+    /* Only look at the first value, and trim off any whitespace. */
+    if((end = (const uint8_t *)memchr(s, 0, s_len)))
+        s_len = end - s;
+
+    while(s_len && is_space(*s)) {
+        ++s;
+        --s_len;
+    }
+
+    while(s_len && is_space(s[s_len - 1]))
+        --s_len;
+
+    if(!s_len)
+        return ST_Genre_None;
+
+    /* ID3v2.3 references come first in parentheses, possibly followed by a
+       refinement. A doubled opening parenthesis is just a parenthesis. */
+    if(s[0] == '(' && s_len > 1 && s[1] != '(' &&
+       (end = (const uint8_t *)memchr(s, ')', s_len))) {
+        if((id = parse_code(s + 1, end - s - 1)) >= 0)
+            return put_text(id, NULL, 0, buf, len);
+        else if(end - s == 3 && !memcmp(s + 1, "RX", 2))
+            return put_text(ST_Genre_Other, (const uint8_t *)"Remix", 5, buf,
+                            len);
+        else if(end - s == 3 && !memcmp(s + 1, "CR", 2))
+            return put_text(ST_Genre_Other, (const uint8_t *)"Cover", 5, buf,
+                            len);
+
+        /* Not something we know about, so go with the text after it, if
+           there is any. */
+        if(end + 1 < s + s_len) {
+            s_len -= end + 1 - s;
+            s = end + 1;
+        }
+    }
+    else if(s[0] == '(' && s_len > 1) {
+        ++s;
+        --s_len;
+    }
+
+    if((id = parse_code(s, s_len)) >= 0)
+        return put_text(id, NULL, 0, buf, len);
+
+    return put_text(ST_Genre_lookup(s, s_len), s, s_len, buf, len);
+}
@@ -0,0 +1,278 @@
+/* Generated by genre_hash.py -- do not edit. */
+
+#define GENRE_HASH_BUCKETS  64
+#define GENRE_HASH_SLOTS    256
+#define GENRE_KEY_MAX       16
+
+static const uint16_t genre_seeds[GENRE_HASH_BUCKETS] = {
+        2,     1,     2,     0,     3,     1,     3,     1,
+        2,     7,     1,     2,     0,     1,    16,     1,
+        6,     4,     2,     1,     1,     2,     0,     3,
+        7,     6,     3,     7,     1,     1,     1,     5,
+        6,     1,     5,     0,     1,     2,     2,     2,
+        1,     3,     2,     2,     2,     3,     1,     4,
+        1,     1,     1,     6,     6,     3,     1,     4,
+        1,     3,    10,     0,     2,     5,     1,     0,
+};
+
+static const struct genre_slot {
+    const char *key;
+    int id;
+} genre_slots[GENRE_HASH_SLOTS] = {
+    { NULL, -1 },
+    { "heavymetal", 137 },
+    { NULL, -1 },
+    { "acoustic", 99 },
+    { "drumsolo", 122 },
+    { "showtunes", 69 },
+    { "merengue", 142 },
+    { NULL, -1 },
+    { NULL, -1 },
+    { "satire", 110 },
+    { "folk", 80 },
+    { NULL, -1 },
+    { NULL, -1 },
+    { "terror", 130 },
+    { "rockroll", 78 },
+    { "dream", 55 },
+    { NULL, -1 },
+    { "jazz", 8 },
+    { "newage", 10 },
+    { "contemporary", 140 },
+    { NULL, -1 },
+    { "christianrap", 61 },
+    { NULL, -1 },
+    { "slowjam", 111 },
+    { "britpop", 132 },
+    { "goa", 126 },
+    { "bebop", 85 },
+    { NULL, -1 },
+    { NULL, -1 },
+    { NULL, -1 },
+    { "duet", 120 },
+    { NULL, -1 },
+    { "hardcore", 129 },
+    { NULL, -1 },
+    { "trailer", 70 },
+    { "opera", 103 },
+    { "grunge", 6 },
+    { "jungle", 63 },
+    { "alternativerock", 40 },
+    { NULL, -1 },
+    { "bootybass", 107 },
+    { NULL, -1 },
+    { "acidpunk", 73 },
+    { "classicrock", 1 },
+    { "crossover", 139 },
+    { "clubhouse", 128 },
+    { NULL, -1 },
+    { "acappella", 123 },
+    { NULL, -1 },
+    { "negerpunk", 133 },
+    { "primus", 108 },
+    { "meditative", 45 },
+    { "oldies", 11 },
+    { "rhythmandblues", 14 },
+    { NULL, -1 },
+    { "blues", 0 },
+    { "gothicrock", 91 },
+    { "avantgarde", 90 },
+    { "fastfusion", 84 },
+    { "anime", 145 },
+    { "comedy", 57 },
+    { "slowrock", 95 },
+    { "thrashmetal", 144 },
+    { NULL, -1 },
+    { "industrial", 19 },
+    { "southernrock", 56 },
+    { "triphop", 27 },
+    { NULL, -1 },
+    { "polskpunk", 134 },
+    { "vocal", 28 },
+    { NULL, -1 },
+    { "psychadelic", 67 },
+    { "rave", 68 },
+    { "darkwave", 50 },
+    { "celtic", 88 },
+    { NULL, -1 },
+    { "sonata", 105 },
+    { "noise", 39 },
+    { NULL, -1 },
+    { NULL, -1 },
+    { "tango", 113 },
+    { NULL, -1 },
+    { "indie", 131 },
+    { NULL, -1 },
+    { NULL, -1 },
+    { "rap", 15 },
+    { NULL, -1 },
+    { "alternative", 20 },
+    { "gospel", 38 },
+    { "jpop", 146 },
+    { "christianrock", 141 },
+    { "salsa", 143 },
+    { "fusion", 30 },
+    { "gothic", 49 },
+    { NULL, -1 },
+    { NULL, -1 },
+    { "cult", 58 },
+    { "ambient", 26 },
+    { NULL, -1 },
+    { NULL, -1 },
+    { "retro", 76 },
+    { "newwave", 66 },
+    { NULL, -1 },
+    { "polka", 75 },
+    { NULL, -1 },
+    { "reggae", 16 },
+    { "eurohouse", 124 },
+    { NULL, -1 },
+    { "speech", 101 },
+    { "punkrock", 121 },
+    { NULL, -1 },
+    { "revival", 87 },
+    { "bigband", 96 },
+    { NULL, -1 },
+    { NULL, -1 },
+    { "eurodance", 54 },
+    { "other", 12 },
+    { NULL, -1 },
+    { "instrumentalrock", 47 },
+    { "disco", 4 },
+    { NULL, -1 },
+    { "chorus", 97 },
+    { NULL, -1 },
+    { NULL, -1 },
+    { "punk", 43 },
+    { NULL, -1 },
+    { NULL, -1 },
+    { NULL, -1 },
+    { "chanson", 102 },
+    { NULL, -1 },
+    { "lofi", 71 },
+    { "acapella", 123 },
+    { NULL, -1 },
+    { "country", 2 },
+    { "pop", 13 },
+    { NULL, -1 },
+    { "soundclip", 37 },
+    { "bebob", 85 },
+    { "trance", 31 },
+    { "symphonicrock", 94 },
+    { NULL, -1 },
+    { NULL, -1 },
+    { "chambermusic", 104 },
+    { "psychedelicrock", 93 },
+    { NULL, -1 },
+    { "techno", 18 },
+    { "house", 35 },
+    { NULL, -1 },
+    { "pranks", 23 },
+    { "deathmetal", 22 },
+    { NULL, -1 },
+    { "metal", 9 },
+    { NULL, -1 },
+    { "rockandroll", 78 },
+    { "nationalfolk", 82 },
+    { "top40", 60 },
+    { NULL, -1 },
+    { NULL, -1 },
+    { NULL, -1 },
+    { "tribal", 72 },
+    { "humour", 100 },
+    { NULL, -1 },
+    { NULL, -1 },
+    { "electronic", 52 },
+    { "psychadelicrock", 93 },
+    { NULL, -1 },
+    { NULL, -1 },
+    { NULL, -1 },
+    { "folklore", 115 },
+    { "humor", 100 },
+    { NULL, -1 },
+    { "blackmetal", 138 },
+    { NULL, -1 },
+    { NULL, -1 },
+    { "nativeamerican", 64 },
+    { "freestyle", 119 },
+    { "bass", 41 },
+    { "folkrock", 81 },
+    { "gangsta", 59 },
+    { "jazzfunk", 29 },
+    { "instrumental", 33 },
+    { "eurotechno", 25 },
+    { NULL, -1 },
+    { "soul", 42 },
+    { "beat", 135 },
+    { "classical", 32 },
+    { NULL, -1 },
+    { "cabaret", 65 },
+    { "rnb", 14 },
+    { NULL, -1 },
+    { "acidjazz", 74 },
+    { NULL, -1 },
+    { "hardrock", 79 },
+    { NULL, -1 },
+    { "christiangangsta", 136 },
+    { "funk", 5 },
+    { "technoindustrial", 51 },
+    { NULL, -1 },
+    { NULL, -1 },
+    { NULL, -1 },
+    { "club", 112 },
+    { NULL, -1 },
+    { NULL, -1 },
+    { NULL, -1 },
+    { "rhythmicsoul", 118 },
+    { "soundtrack", 24 },
+    { "game", 36 },
+    { "instrumentalpop", 46 },
+    { "powerballad", 117 },
+    { NULL, -1 },
+    { "progressiverock", 92 },
+    { NULL, -1 },
+    { "drumbass", 127 },
+    { "popfolk", 53 },
+    { "latin", 86 },
+    { NULL, -1 },
+    { NULL, -1 },
+    { "acid", 34 },
+    { "space", 44 },
+    { NULL, -1 },
+    { NULL, -1 },
+    { "drumnbass", 127 },
+    { NULL, -1 },
+    { NULL, -1 },
+    { NULL, -1 },
+    { "ska", 21 },
+    { "rocknroll", 78 },
+    { "porngroove", 109 },
+    { NULL, -1 },
+    { "easylistening", 98 },
+    { NULL, -1 },
+    { "drumandbass", 127 },
+    { "musical", 77 },
+    { NULL, -1 },
+    { "rock", 17 },
+    { "dance", 3 },
+    { "bluegrass", 89 },
+    { "psychedelic", 67 },
+    { "symphony", 106 },
+    { "ethnic", 48 },
+    { NULL, -1 },
+    { "synthpop", 147 },
+    { NULL, -1 },
+    { "hiphop", 7 },
+    { "ballad", 116 },
+    { NULL, -1 },
+    { "samba", 114 },
+    { "rb", 14 },
+    { NULL, -1 },
+    { "popfunk", 62 },
+    { NULL, -1 },
+    { NULL, -1 },
+    { "swing", 83 },
+    { "dancehall", 125 },
+    { "alternrock", 40 },
+    { NULL, -1 },
+};
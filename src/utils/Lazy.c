@@ -0,0 +1,104 @@
+/*
+    SonatinaTag
+    Copyright (C) 2026 Lawrence Sebald
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License version 2.1 as published by the Free Software Foundation.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+*/
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <stdio.h>
+#include <stdint.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+
+/* The Xcode project doesn't use config.h, but Apple platforms always have
+   POSIX threads. */
+#if defined(HAVE_PTHREAD_H) || defined(__APPLE__)
+#define LAZY_PTHREADS
+#include <pthread.h>
+#endif
+
+#include "SonatinaTag/Allocator.h"
+#include "Lazy.h"
+
+#ifdef LAZY_PTHREADS
+static pthread_mutex_t lazy_lock = PTHREAD_MUTEX_INITIALIZER;
+#endif
+
+ST_LOCAL ST_Error ST_FileStamp_take(ST_FileStamp *st, FILE *fp) {
+    struct stat s;
+
+    if(fstat(fileno(fp), &s))
+        return ST_Error_errno;
+
+    st->dev = s.st_dev;
+    st->ino = s.st_ino;
+    st->size = s.st_size;
+    st->mtime = s.st_mtime;
+    return ST_Error_None;
+}
+
+ST_LOCAL ST_Error ST_Lazy_read(const char *fn, const ST_FileStamp *st,
+                               off_t offset, size_t len, uint8_t **out) {
+    ST_FileStamp now;
+    ST_Error rv;
+    uint8_t *tmp = NULL;
+    FILE *fp;
+
+    if(!(fp = fopen(fn, "rb")))
+        return ST_Error_errno;
+
+    /* The offset is only any good if this is the same file, with the same
+       contents, as when it was parsed. */
+    if((rv = ST_FileStamp_take(&now, fp)) != ST_Error_None)
+        goto out;
+
+    if(now.dev != st->dev || now.ino != st->ino || now.size != st->size ||
+       now.mtime != st->mtime) {
+        rv = ST_Error_FileChanged;
+        goto out;
+    }
+
+    if(!(tmp = (uint8_t *)ST_malloc(len ? len : 1))) {
+        rv = ST_Error_errno;
+        goto out;
+    }
+
+    if(fseeko(fp, offset, SEEK_SET) || fread(tmp, 1, len, fp) != len) {
+        rv = ferror(fp) ? ST_Error_errno : ST_Error_FileChanged;
+        ST_free(tmp);
+        goto out;
+    }
+
+    *out = tmp;
+
+out:
+    fclose(fp);
+    return rv;
+}
+
+ST_LOCAL void ST_Lazy_lock(void) {
+#ifdef LAZY_PTHREADS
+    pthread_mutex_lock(&lazy_lock);
+#endif
+}
+
+ST_LOCAL void ST_Lazy_unlock(void) {
+#ifdef LAZY_PTHREADS
+    pthread_mutex_unlock(&lazy_lock);
+#endif
+}
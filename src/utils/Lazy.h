@@ -0,0 +1,59 @@
+/*
+    SonatinaTag
+    Copyright (C) 2026 Lawrence Sebald
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License version 2.1 as published by the Free Software Foundation.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+*/
+
+#ifndef ST_INTERNAL__utils__Lazy_h
+#define ST_INTERNAL__utils__Lazy_h
+
+#include <stdio.h>
+#include <stdint.h>
+#include <time.h>
+#include <sys/types.h>
+
+#include "SonatinaTag/cdefs.h"
+
+ST_BEGIN_DECLS
+
+#include "SonatinaTag/Error.h"
+
+/* Enough about a file to tell if it has been changed or replaced since parts of
+   it were left there to be read later. */
+typedef struct ST_FileStamp_struct {
+    dev_t dev;
+    ino_t ino;
+    off_t size;
+    time_t mtime;
+} ST_FileStamp;
+
+/* Fill in a stamp for an open file. */
+ST_LOCAL ST_Error ST_FileStamp_take(ST_FileStamp *st, FILE *fp);
+
+/* Read len bytes at offset out of the named file into a buffer allocated with
+   the current allocator, as long as the file still matches the stamp. Returns
+   ST_Error_FileChanged if it doesn't. */
+ST_LOCAL ST_Error ST_Lazy_read(const char *fn, const ST_FileStamp *st,
+                               off_t offset, size_t len, uint8_t **out);
+
+/* Getters that read something in the first time they're called on a const
+   object hold this lock from checking whether it's there until it's been
+   stored, so that two threads can't both do it. */
+ST_LOCAL void ST_Lazy_lock(void);
+ST_LOCAL void ST_Lazy_unlock(void);
+
+ST_END_DECLS
+
+#endif /* !ST_INTERNAL__utils__Lazy_h */
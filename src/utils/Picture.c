@@ -24,8 +24,12 @@
 #include <stdlib.h>
 #include <string.h>
 #include <stdint.h>
+#include <sys/types.h>
 
 #include "SonatinaTag/Picture.h"
+#include "SonatinaTag/Allocator.h"
+#include "Picture.h"
+#include "Lazy.h"
 
 struct ST_Picture_struct {
     ST_PictureType picture_type;
@@ -39,13 +43,21 @@ struct ST_Picture_struct {
     uint32_t index_used;
     uint8_t *data;
     uint32_t data_len;
+
+    /* Where to read the data from, if it hasn't been read yet, and what to
+       allocate space for it with. */
+    char *src_fn;
+    off_t src_offset;
+    ST_FileStamp src_stamp;
+    const ST_Allocator *alloc;
 };
 
 ST_FUNC ST_Picture *ST_Picture_create(void) {
-    ST_Picture *rv = (ST_Picture *)malloc(sizeof(ST_Picture));
+    ST_Picture *rv = (ST_Picture *)ST_malloc(sizeof(ST_Picture));
 
     if(rv) {
         memset(rv, 0, sizeof(ST_Picture));
+        rv->alloc = ST_currentAllocator();
     }
 
     return rv;
@@ -55,10 +67,11 @@ ST_FUNC void ST_Picture_free(ST_Picture *p) {
     if(!p)
         return;
 
-    free(p->mime_type);
-    free(p->description);
-    free(p->data);
-    free(p);
+    ST_free(p->mime_type);
+    ST_free(p->description);
+    ST_free(p->data);
+    ST_free(p->src_fn);
+    ST_free(p);
 }
 
 ST_FUNC uint32_t ST_Picture_width(const ST_Picture *p) {
@@ -103,10 +116,56 @@ ST_FUNC ST_PictureType ST_Picture_type(const ST_Picture *p) {
     return p->picture_type;
 }
 
+/* Read in the data of a picture that was set up with
+   ST_Picture_setDataSource. The source is left alone, since other threads may
+   be looking at it. */
+static ST_Error load_data(ST_Picture *p) {
+    const ST_Allocator *prev;
+    ST_Error rv;
+
+    if(p->data)
+        return ST_Error_None;
+
+    /* Use the allocator the picture was made with, since the filename came
+       from it and the data will be freed with it. */
+    prev = ST_useAllocator(p->alloc);
+    rv = ST_Lazy_read(p->src_fn, &p->src_stamp, p->src_offset, p->data_len,
+                      &p->data);
+    ST_useAllocator(prev);
+
+    return rv;
+}
+
+ST_FUNC ST_Error ST_Picture_load(ST_Picture *p) {
+    ST_Error rv;
+
+    if(!p)
+        return ST_Error_InvalidArgument;
+
+    if(!p->src_fn)
+        return ST_Error_None;
+
+    if((rv = load_data(p)) != ST_Error_None)
+        return rv;
+
+    ST_free(p->src_fn);
+    p->src_fn = NULL;
+    return ST_Error_None;
+}
+
 ST_FUNC const uint8_t *ST_Picture_data(const ST_Picture *p) {
     if(!p)
         return NULL;
 
+    /* The picture is still const as far as the caller is concerned, even if
+       we have to go read the data in now. The source doesn't change until the
+       picture does, so it's safe to check without the lock. */
+    if(p->src_fn) {
+        ST_Lazy_lock();
+        load_data((ST_Picture *)p);
+        ST_Lazy_unlock();
+    }
+
     return p->data;
 }
 
@@ -185,12 +244,12 @@ ST_FUNC ST_Error ST_Picture_setMimeType(ST_Picture *p, const char *mt) {
         return ST_Error_InvalidArgument;
 
     if(mt) {
-        if(!(tmp = strdup(mt))) {
+        if(!(tmp = ST_strdup(mt))) {
             return ST_Error_errno;
         }
     }
 
-    free(p->mime_type);
+    ST_free(p->mime_type);
     p->mime_type = tmp;
     return ST_Error_None;
 }
@@ -204,14 +263,14 @@ ST_FUNC ST_Error ST_Picture_setDescription(ST_Picture *p, const uint8_t *d,
         return ST_Error_InvalidArgument;
 
     if(d) {
-        if(!(tmp = malloc(desc_len))) {
+        if(!(tmp = ST_malloc(desc_len))) {
             return ST_Error_errno;
         }
 
         memcpy(tmp, d, desc_len);
     }
 
-    free(p->description);
+    ST_free(p->description);
     p->description = tmp;
     p->desc_length = desc_len;
     p->desc_enc = enc;
@@ -225,18 +284,21 @@ ST_FUNC ST_Error ST_Picture_setData(ST_Picture *p, uint8_t *d, uint32_t len,
     if(!p || !d || !len)
         return ST_Error_InvalidArgument;
 
+    ST_free(p->src_fn);
+    p->src_fn = NULL;
+
     if(own_buf) {
-        free(p->data);
+        ST_free(p->data);
         p->data = d;
         p->data_len = len;
     }
     else {
-        if(!(tmp = (uint8_t *)malloc(len))) {
+        if(!(tmp = (uint8_t *)ST_malloc(len))) {
             return ST_Error_errno;
         }
 
         memcpy(tmp, d, len);
-        free(p->data);
+        ST_free(p->data);
         p->data = tmp;
         p->data_len = len;
     }
@@ -244,6 +306,27 @@ ST_FUNC ST_Error ST_Picture_setData(ST_Picture *p, uint8_t *d, uint32_t len,
     return ST_Error_None;
 }
 
+ST_LOCAL ST_Error ST_Picture_setDataSource(ST_Picture *p, const char *fn,
+                                           const ST_FileStamp *st,
+                                           off_t offset, uint32_t len) {
+    char *tmp;
+
+    if(!p || !fn || !st || !len)
+        return ST_Error_InvalidArgument;
+
+    if(!(tmp = ST_strdup(fn)))
+        return ST_Error_errno;
+
+    ST_free(p->src_fn);
+    ST_free(p->data);
+    p->src_fn = tmp;
+    p->src_offset = offset;
+    p->src_stamp = *st;
+    p->data = NULL;
+    p->data_len = len;
+    return ST_Error_None;
+}
+
 #ifdef ST_HAVE_COREFOUNDATION
 ST_FUNC CFStringRef ST_Picture_copyDesc(const ST_Picture *p, ST_Error *err) {
     CFStringEncoding enc;
@@ -297,7 +380,7 @@ ST_FUNC ST_Error ST_Picture_setDescStr(ST_Picture *p, CFStringRef s) {
         return ST_Error_InvalidArgument;
 
     if(!s) {
-        free(p->description);
+        ST_free(p->description);
         p->description = NULL;
         p->desc_length = 0;
         return ST_Error_None;
@@ -306,17 +389,17 @@ ST_FUNC ST_Error ST_Picture_setDescStr(ST_Picture *p, CFStringRef s) {
     /* Get the length and allocate space */
     len = CFStringGetMaximumSizeForEncoding(CFStringGetLength(s),
                                             kCFStringEncodingUTF8);
-    if(!(tmp = (char *)malloc(len + 1)))
+    if(!(tmp = (char *)ST_malloc(len + 1)))
         return ST_Error_errno;
 
     /* Copy data in */
     if(!CFStringGetCString(s, tmp, len + 1, kCFStringEncodingUTF8)) {
-        free(tmp);
+        ST_free(tmp);
         return ST_Error_InvalidEncoding;
     }
 
-    if(!(tmp2 = strdup(tmp))) {
-        free(tmp);
+    if(!(tmp2 = ST_strdup(tmp))) {
+        ST_free(tmp);
         return ST_Error_errno;
     }
 
@@ -324,7 +407,7 @@ ST_FUNC ST_Error ST_Picture_setDescStr(ST_Picture *p, CFStringRef s) {
     p->description = (uint8_t *)tmp2;
     p->desc_length = strlen(tmp2);
     p->desc_enc = ST_TextEncoding_UTF8;
-    free(tmp);
+    ST_free(tmp);
 
     return ST_Error_None;
 }
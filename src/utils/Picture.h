@@ -0,0 +1,39 @@
+/*
+    SonatinaTag
+    Copyright (C) 2026 Lawrence Sebald
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License version 2.1 as published by the Free Software Foundation.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+*/
+
+#ifndef ST_INTERNAL__utils__Picture_h
+#define ST_INTERNAL__utils__Picture_h
+
+#include "SonatinaTag/cdefs.h"
+
+ST_BEGIN_DECLS
+
+#include <sys/types.h>
+#include "SonatinaTag/Picture.h"
+#include "Lazy.h"
+
+/* Set up a picture to have its data read from the given place in a file the
+   first time ST_Picture_data or ST_Picture_load is called on it, rather than
+   right away. The stamp is of the file as it was when it was parsed. */
+ST_LOCAL ST_Error ST_Picture_setDataSource(ST_Picture *p, const char *fn,
+                                           const ST_FileStamp *st,
+                                           off_t offset, uint32_t len);
+
+ST_END_DECLS
+
+#endif /* !ST_INTERNAL__utils__Picture_h */
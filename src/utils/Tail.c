@@ -0,0 +1,172 @@
+/*
+    SonatinaTag
+    Copyright (C) 2026 Lawrence Sebald
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License version 2.1 as published by the Free Software Foundation.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+*/
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <sys/types.h>
+
+#include "SonatinaTag/Allocator.h"
+#include "Tail.h"
+
+#define APE_FLAG_HAS_HEADER     0x80000000
+#define APE_FLAG_IS_HEADER      0x20000000
+
+static uint32_t get_u32(const uint8_t *buf) {
+    return buf[0] | (buf[1] << 8) | (buf[2] << 16) | ((uint32_t)buf[3] << 24);
+}
+
+ST_LOCAL const uint8_t *ST_Tail_bytes(const ST_Tail *t, off_t offset,
+                                      size_t len) {
+    off_t start = t->file_size - (off_t)t->len;
+
+    if(offset < start || offset + (off_t)len > t->file_size)
+        return NULL;
+
+    return t->buf + (offset - start);
+}
+
+ST_LOCAL int ST_Tail_read(const ST_Tail *t, FILE *fp, off_t offset,
+                          uint8_t *buf, size_t len) {
+    const uint8_t *p;
+
+    if((p = ST_Tail_bytes(t, offset, len))) {
+        memcpy(buf, p, len);
+        return 0;
+    }
+
+    if(fseeko(fp, offset, SEEK_SET) || fread(buf, 1, len, fp) != len)
+        return -1;
+
+    return 0;
+}
+
+/* Look for an APE Tag footer ending at the given offset. */
+static int find_ape(ST_Tail *t, FILE *fp, off_t end) {
+    uint8_t ftr[32];
+    uint32_t sz, flags;
+    off_t total;
+
+    if(end < 32 || ST_Tail_read(t, fp, end - 32, ftr, 32) ||
+       memcmp(ftr, "APETAGEX", 8))
+        return 0;
+
+    /* The size covers the items and the footer, but not the header. */
+    sz = get_u32(ftr + 12);
+    flags = get_u32(ftr + 20);
+    total = (off_t)sz + ((flags & APE_FLAG_HAS_HEADER) ? 32 : 0);
+
+    if((flags & APE_FLAG_IS_HEADER) || sz < 32 || total > end)
+        return 0;
+
+    t->ape = end - total;
+    t->ape_size = total;
+    t->ape_items = end - sz;
+    memcpy(t->ape_footer, ftr, 32);
+    return 1;
+}
+
+/* Look for a Lyrics3v2 block ending at the given offset. The block ends with
+   six ASCII digits giving its size (not counting the digits or the
+   "LYRICS200" after them) and starts with "LYRICSBEGIN". */
+static int find_lyrics3(ST_Tail *t, FILE *fp, off_t end) {
+    uint8_t buf[15];
+    off_t sz = 0;
+    int i;
+
+    if(end < 15 + 11 || ST_Tail_read(t, fp, end - 15, buf, 15) ||
+       memcmp(buf + 6, "LYRICS200", 9))
+        return 0;
+
+    for(i = 0; i < 6; ++i) {
+        if(buf[i] < '0' || buf[i] > '9')
+            return 0;
+
+        sz = sz * 10 + (buf[i] - '0');
+    }
+
+    if(sz < 11 || sz + 15 > end ||
+       ST_Tail_read(t, fp, end - 15 - sz, buf, 11) ||
+       memcmp(buf, "LYRICSBEGIN", 11))
+        return 0;
+
+    t->lyrics3 = end - 15 - sz;
+    t->lyrics3_size = sz + 15;
+    return 1;
+}
+
+ST_LOCAL int ST_Tail_probe(FILE *fp, ST_Tail *t) {
+    const uint8_t *p;
+    off_t end;
+
+    memset(t, 0, sizeof(ST_Tail));
+    t->id3v1 = t->tag_plus = t->lyrics3 = t->ape = -1;
+
+    if(fseeko(fp, 0, SEEK_END) || (t->file_size = ftello(fp)) < 0)
+        return -1;
+
+    /* Everything at the end of the file comes from this one read, unless
+       there's a big Lyrics3v2 block or APE tag in the way. */
+    t->len = (t->file_size < ST_TAIL_WINDOW) ? (size_t)t->file_size :
+        ST_TAIL_WINDOW;
+
+    if(!(t->buf = (uint8_t *)ST_malloc(t->len ? t->len : 1)))
+        return -1;
+
+    if(fseeko(fp, -(off_t)t->len, SEEK_END) ||
+       fread(t->buf, 1, t->len, fp) != t->len) {
+        ST_Tail_release(t);
+        return -1;
+    }
+
+    end = t->file_size;
+
+    /* The ID3v1 tag (and any Enhanced TAG+ block) are always at the very end,
+       and both are entirely within what was read in. */
+    if(end >= 128 && !memcmp(t->buf + t->len - 128, "TAG", 3)) {
+        end = t->id3v1 = end - 128;
+
+        if(end >= 227 && (p = ST_Tail_bytes(t, end - 227, 4)) &&
+           !memcmp(p, "TAG+", 4))
+            end = t->tag_plus = end - 227;
+    }
+
+    /* The other two can come in either order. */
+    for(;;) {
+        if(t->ape == -1 && find_ape(t, fp, end))
+            end = t->ape;
+        else if(t->lyrics3 == -1 && find_lyrics3(t, fp, end))
+            end = t->lyrics3;
+        else
+            break;
+    }
+
+    t->audio_end = end;
+    return 0;
+}
+
+ST_LOCAL void ST_Tail_release(ST_Tail *t) {
+    ST_free(t->buf);
+    t->buf = NULL;
+    t->len = 0;
+}
@@ -0,0 +1,87 @@
+/*
+    SonatinaTag
+    Copyright (C) 2026 Lawrence Sebald
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License version 2.1 as published by the Free Software Foundation.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+*/
+
+#ifndef ST_INTERNAL__utils__Tail_h
+#define ST_INTERNAL__utils__Tail_h
+
+#include <stdio.h>
+#include <stdint.h>
+#include <sys/types.h>
+
+#include "SonatinaTag/cdefs.h"
+
+ST_BEGIN_DECLS
+
+#include "SonatinaTag/Tags/APE.h"
+#include "SonatinaTag/Tags/ID3v1.h"
+
+/* How much of the end of the file gets read in by ST_Tail_probe. This is enough
+   for an ID3v1 tag, an Enhanced TAG+ block, and the footers of the other tags
+   along with most (small) APE tags in their entirety. */
+#define ST_TAIL_WINDOW  16384
+
+/* Everything found tacked onto the end of a file. All offsets are from the
+   start of the file, and are -1 for things that aren't there. From the end of
+   the file backwards, the ID3v1 tag is always last with any Enhanced TAG+ block
+   right before it. The APE tag and Lyrics3v2 block can be in either order in
+   front of those. */
+typedef struct ST_Tail_struct {
+    off_t file_size;
+    off_t audio_end;            /* Where the first trailing structure starts */
+
+    off_t id3v1;                /* The 128 byte ID3v1 tag */
+    off_t tag_plus;             /* The 227 byte Enhanced TAG+ block */
+
+    off_t lyrics3;              /* Start of the Lyrics3v2 block */
+    off_t lyrics3_size;         /* Including its size and "LYRICS200" */
+
+    off_t ape;                  /* Start of the APE tag, including any header */
+    off_t ape_size;             /* Including the header (if any) and footer */
+    off_t ape_items;            /* Start of the items in the APE tag */
+    uint8_t ape_footer[32];
+
+    /* The last len bytes of the file. */
+    uint8_t *buf;
+    size_t len;
+} ST_Tail;
+
+/* Read in the end of the file and find everything that's there. Returns 0 on
+   success or -1 on failure (with errno set). Call ST_Tail_release when done
+   with the result. */
+ST_LOCAL int ST_Tail_probe(FILE *fp, ST_Tail *t);
+ST_LOCAL void ST_Tail_release(ST_Tail *t);
+
+/* Get a pointer to len bytes of the file, starting at offset, if they're in
+   what ST_Tail_probe read in. Returns NULL if not. */
+ST_LOCAL const uint8_t *ST_Tail_bytes(const ST_Tail *t, off_t offset,
+                                      size_t len);
+
+/* Copy len bytes of the file starting at offset into buf, from the probe if
+   it has them or from the file if not. Returns 0 on success. */
+ST_LOCAL int ST_Tail_read(const ST_Tail *t, FILE *fp, off_t offset,
+                          uint8_t *buf, size_t len);
+
+/* Parse the tags found by ST_Tail_probe. These return NULL if the tag isn't
+   there, just like their createFromFile counterparts. */
+ST_LOCAL ST_APE *ST_APE_createFromTail(const char *fn, FILE *fp,
+                                       const ST_Tail *t);
+ST_LOCAL ST_ID3v1 *ST_ID3v1_createFromTail(const ST_Tail *t);
+
+ST_END_DECLS
+
+#endif /* !ST_INTERNAL__utils__Tail_h */
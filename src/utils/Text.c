@@ -0,0 +1,201 @@
+/*
+    SonatinaTag
+    Copyright (C) 2026 Lawrence Sebald
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License version 2.1 as published by the Free Software Foundation.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+*/
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <string.h>
+#include <stdint.h>
+
+#include "Text.h"
+
+/* Append one character to the output, if there's room for all of it. */
+static int put_char(uint32_t c, uint8_t *buf, size_t len, size_t *pos) {
+    uint8_t tmp[4];
+    size_t n;
+
+    if(c < 0x80) {
+        tmp[0] = (uint8_t)c;
+        n = 1;
+    }
+    else if(c < 0x800) {
+        tmp[0] = 0xC0 | (c >> 6);
+        tmp[1] = 0x80 | (c & 0x3F);
+        n = 2;
+    }
+    else if(c < 0x10000) {
+        tmp[0] = 0xE0 | (c >> 12);
+        tmp[1] = 0x80 | ((c >> 6) & 0x3F);
+        tmp[2] = 0x80 | (c & 0x3F);
+        n = 3;
+    }
+    else {
+        tmp[0] = 0xF0 | (c >> 18);
+        tmp[1] = 0x80 | ((c >> 12) & 0x3F);
+        tmp[2] = 0x80 | ((c >> 6) & 0x3F);
+        tmp[3] = 0x80 | (c & 0x3F);
+        n = 4;
+    }
+
+    if(*pos + n >= len)
+        return -1;
+
+    memcpy(buf + *pos, tmp, n);
+    *pos += n;
+    return 0;
+}
+
+static size_t utf16_to_utf8(const uint8_t *in, size_t in_len, int be,
+                            uint8_t *buf, size_t len, int *cut) {
+    size_t i, pos = 0;
+    uint32_t c, c2;
+
+    for(i = 0; i + 1 < in_len; i += 2) {
+        c = be ? (in[i] << 8) | in[i + 1] : in[i] | (in[i + 1] << 8);
+
+        /* Put surrogate pairs back together. */
+        if(c >= 0xD800 && c <= 0xDBFF && i + 3 < in_len) {
+            c2 = be ? (in[i + 2] << 8) | in[i + 3] : in[i + 2] |
+                (in[i + 3] << 8);
+
+            if(c2 >= 0xDC00 && c2 <= 0xDFFF) {
+                c = 0x10000 + ((c - 0xD800) << 10) + (c2 - 0xDC00);
+                i += 2;
+            }
+        }
+
+        if(c >= 0xD800 && c <= 0xDFFF)
+            c = 0xFFFD;
+
+        if(put_char(c, buf, len, &pos)) {
+            *cut = 1;
+            break;
+        }
+    }
+
+    buf[pos] = 0;
+    return pos;
+}
+
+static size_t copy_utf8(const uint8_t *in, size_t in_len, uint8_t *buf,
+                        size_t len, int *cut) {
+    size_t n;
+
+    if((n = in_len) > len - 1) {
+        n = len - 1;
+        *cut = 1;
+
+        /* Don't leave part of a character at the end. */
+        while(n && (in[n] & 0xC0) == 0x80)
+            --n;
+    }
+
+    memcpy(buf, in, n);
+    buf[n] = 0;
+    return n;
+}
+
+/* Do the conversion, setting *cut if not all of the string fit. */
+static size_t convert(const uint8_t *in, size_t in_len, ST_TextEncoding enc,
+                      uint8_t *buf, size_t len, int *cut) {
+    size_t i, pos = 0;
+
+    switch(enc) {
+        case ST_TextEncoding_ISO8859_1:
+            for(i = 0; i < in_len; ++i) {
+                if(put_char(in[i], buf, len, &pos)) {
+                    *cut = 1;
+                    break;
+                }
+            }
+
+            buf[pos] = 0;
+            return pos;
+
+        case ST_TextEncoding_UTF16:
+            if(in_len >= 2 && in[0] == 0xFE && in[1] == 0xFF)
+                return utf16_to_utf8(in + 2, in_len - 2, 1, buf, len, cut);
+            else if(in_len >= 2 && in[0] == 0xFF && in[1] == 0xFE)
+                return utf16_to_utf8(in + 2, in_len - 2, 0, buf, len, cut);
+
+            return utf16_to_utf8(in, in_len, 0, buf, len, cut);
+
+        case ST_TextEncoding_UTF16BE:
+            return utf16_to_utf8(in, in_len, 1, buf, len, cut);
+
+        case ST_TextEncoding_UTF8:
+            return copy_utf8(in, in_len, buf, len, cut);
+
+        default:
+            buf[0] = 0;
+            return 0;
+    }
+}
+
+ST_LOCAL size_t ST_Text_copyUTF8(const uint8_t *in, size_t in_len,
+                                 uint8_t *buf, size_t len) {
+    int cut = 0;
+
+    if(!len)
+        return 0;
+
+    return copy_utf8(in, in_len, buf, len, &cut);
+}
+
+ST_LOCAL size_t ST_Text_toUTF8(const uint8_t *in, size_t in_len,
+                               ST_TextEncoding enc, uint8_t *buf, size_t len) {
+    int cut = 0;
+
+    if(!len)
+        return 0;
+
+    return convert(in, in_len, enc, buf, len, &cut);
+}
+
+ST_LOCAL ST_Error ST_Text_getUTF8(const uint8_t *in, size_t in_len,
+                                  ST_TextEncoding enc, uint8_t *buf,
+                                  size_t len) {
+    int cut = 0;
+
+    if(!len)
+        return ST_Error_InvalidArgument;
+
+    convert(in, in_len, enc, buf, len, &cut);
+    return cut ? ST_Error_TooLarge : ST_Error_None;
+}
+
+ST_LOCAL size_t ST_Text_firstLength(const uint8_t *in, size_t in_len,
+                                    ST_TextEncoding enc) {
+    const uint8_t *nul;
+    size_t i;
+
+    if(enc == ST_TextEncoding_UTF16 || enc == ST_TextEncoding_UTF16BE) {
+        for(i = 0; i + 1 < in_len; i += 2) {
+            if(!in[i] && !in[i + 1])
+                return i;
+        }
+
+        return in_len;
+    }
+
+    if((nul = (const uint8_t *)memchr(in, 0, in_len)))
+        return (size_t)(nul - in);
+
+    return in_len;
+}
@@ -0,0 +1,59 @@
+/*
+    SonatinaTag
+    Copyright (C) 2026 Lawrence Sebald
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License version 2.1 as published by the Free Software Foundation.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+*/
+
+#ifndef ST_INTERNAL__utils__Text_h
+#define ST_INTERNAL__utils__Text_h
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "SonatinaTag/cdefs.h"
+
+ST_BEGIN_DECLS
+
+#include "SonatinaTag/basedefs.h"
+#include "SonatinaTag/Error.h"
+
+/* Convert a string in one of the ID3v2 encodings to UTF-8. At most len - 1
+   bytes are written to buf, never cutting a character in half, and the result
+   is always NUL terminated (as long as len isn't 0). UTF-16 without a byte
+   order mark is taken to be little endian, and anything that can't be decoded
+   comes out as U+FFFD. Returns the number of bytes written, not counting the
+   NUL terminator. */
+ST_LOCAL size_t ST_Text_toUTF8(const uint8_t *in, size_t in_len,
+                               ST_TextEncoding enc, uint8_t *buf, size_t len);
+
+/* Copy a UTF-8 string into buf, like ST_Text_toUTF8 does. */
+ST_LOCAL size_t ST_Text_copyUTF8(const uint8_t *in, size_t in_len,
+                                 uint8_t *buf, size_t len);
+
+/* Convert a string as ST_Text_toUTF8 does, for the field getters. Returns
+   ST_Error_TooLarge if it had to be cut short to fit in buf. */
+ST_LOCAL ST_Error ST_Text_getUTF8(const uint8_t *in, size_t in_len,
+                                  ST_TextEncoding enc, uint8_t *buf,
+                                  size_t len);
+
+/* Get the length of the first value in a string in one of the ID3v2
+   encodings, where several values are separated by NUL characters. This is
+   the whole string if it doesn't have any NULs in it. */
+ST_LOCAL size_t ST_Text_firstLength(const uint8_t *in, size_t in_len,
+                                    ST_TextEncoding enc);
+
+ST_END_DECLS
+
+#endif /* !ST_INTERNAL__utils__Text_h */
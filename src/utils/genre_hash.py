@@ -0,0 +1,118 @@
+#!/usr/bin/env python3
+#
+# SonatinaTag
+# Copyright (C) 2026 Lawrence Sebald
+#
+# Generate GenreHash.h, the perfect hash table used by ST_Genre_lookup to map
+# genre names back to their IDs. The names are pulled out of the ID3v1 genre
+# list, so run this again whenever that changes:
+#
+#     python3 genre_hash.py ../id3v1/ID3v1.c > GenreHash.h
+#
+# Keys are normalized the same way as in Genre.c: ASCII letters are lowercased,
+# anything else that isn't a letter or digit below 0x80 is dropped.
+
+import re
+import sys
+
+# Other common spellings that should map onto one of the standard names.
+ALIASES = {
+    "Alternative Rock": "AlternRock",
+    "A Cappella": "Acapella",
+    "Bebop": "Bebob",
+    "Drum and Bass": "Drum & Bass",
+    "Drum 'n' Bass": "Drum & Bass",
+    "Humor": "Humour",
+    "Psychedelic": "Psychadelic",
+    "Psychedelic Rock": "Psychadelic Rock",
+    "Rhythm and Blues": "R&B",
+    "RnB": "R&B",
+    "Rock and Roll": "Rock & Roll",
+    "Rock 'n' Roll": "Rock & Roll",
+}
+
+BUCKETS = 64
+SLOTS = 256
+
+
+def normalize(name):
+    out = bytearray()
+    for c in name.encode("utf-8"):
+        if c >= 0x80 or chr(c).isalnum():
+            out.append(ord(chr(c).lower()) if c < 0x80 else c)
+    return bytes(out)
+
+
+def fnv(key, seed):
+    h = (2166136261 ^ seed) & 0xFFFFFFFF
+    for c in key:
+        h ^= c
+        h = (h * 16777619) & 0xFFFFFFFF
+    return h
+
+
+def main():
+    src = open(sys.argv[1], encoding="latin-1").read()
+    start = src.index("id3_genres[ID3v1GenreMax + 1] = {")
+    names = re.findall(r'"([^"]*)"', src[start:src.index("};", start)])
+
+    keys = {}
+    for i, n in enumerate(names):
+        k = normalize(n)
+        assert k not in keys, n
+        keys[k] = i
+
+    for a, n in ALIASES.items():
+        k = normalize(a)
+        assert k not in keys, a
+        keys[k] = names.index(n)
+
+    # Hash and displace: put the keys into buckets, then find a seed for each
+    # bucket (biggest first) that puts all of its keys in empty slots.
+    buckets = [[] for i in range(BUCKETS)]
+    for k in keys:
+        buckets[fnv(k, 0) % BUCKETS].append(k)
+
+    seeds = [0] * BUCKETS
+    slots = [None] * SLOTS
+    for b in sorted(range(BUCKETS), key=lambda b: -len(buckets[b])):
+        if not buckets[b]:
+            continue
+
+        seed = 1
+        while True:
+            pos = [fnv(k, seed) % SLOTS for k in buckets[b]]
+            if len(set(pos)) == len(pos) and all(slots[p] is None for p in pos):
+                break
+            seed += 1
+
+        seeds[b] = seed
+        for k, p in zip(buckets[b], pos):
+            slots[p] = k
+
+    out = sys.stdout
+    out.write("/* Generated by genre_hash.py -- do not edit. */\n\n")
+    out.write("#define GENRE_HASH_BUCKETS  %d\n" % BUCKETS)
+    out.write("#define GENRE_HASH_SLOTS    %d\n" % SLOTS)
+    out.write("#define GENRE_KEY_MAX       %d\n\n" % max(len(k) for k in keys))
+
+    out.write("static const uint16_t genre_seeds[GENRE_HASH_BUCKETS] = {\n")
+    for i in range(0, BUCKETS, 8):
+        out.write("    " + ", ".join("%5d" % s for s in seeds[i:i + 8]) +
+                  ",\n")
+    out.write("};\n\n")
+
+    out.write("static const struct genre_slot {\n")
+    out.write("    const char *key;\n")
+    out.write("    int id;\n")
+    out.write("} genre_slots[GENRE_HASH_SLOTS] = {\n")
+    for k in slots:
+        if k is None:
+            out.write("    { NULL, -1 },\n")
+        else:
+            out.write('    { "%s", %d },\n' % (k.decode("ascii"), keys[k]))
+    out.write("};\n")
+
+
+if __name__ == "__main__":
+    main()